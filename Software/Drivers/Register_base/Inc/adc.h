@@ -102,6 +102,38 @@ typedef struct {
 #define ADC_EXTERNALTRIGCONV_BOTH     0x30000000U /**< Trigger detection on both edges */
 /** @} */
 
+/**
+ * @name ADC External Trigger Sources for Injected Channels
+ * @{
+ */
+#define ADC_INJECTEDTRIG_T1_CC4   0x00000000U /**< Timer 1 CC4 event  (JEXTSEL=0000) */
+#define ADC_INJECTEDTRIG_T1_TRGO  0x00010000U /**< Timer 1 TRGO event (JEXTSEL=0001) */
+#define ADC_INJECTEDTRIG_T2_CC1   0x00020000U /**< Timer 2 CC1 event  (JEXTSEL=0010) */
+#define ADC_INJECTEDTRIG_T2_TRGO  0x00030000U /**< Timer 2 TRGO event (JEXTSEL=0011) */
+#define ADC_INJECTEDTRIG_T3_CC2   0x00040000U /**< Timer 3 CC2 event  (JEXTSEL=0100) */
+#define ADC_INJECTEDTRIG_T3_CC4   0x00050000U /**< Timer 3 CC4 event  (JEXTSEL=0101) */
+#define ADC_INJECTEDTRIG_T4_CC1   0x00060000U /**< Timer 4 CC1 event  (JEXTSEL=0110) */
+#define ADC_INJECTEDTRIG_T4_CC2   0x00070000U /**< Timer 4 CC2 event  (JEXTSEL=0111) */
+#define ADC_INJECTEDTRIG_T4_CC3   0x00080000U /**< Timer 4 CC3 event  (JEXTSEL=1000) */
+#define ADC_INJECTEDTRIG_T4_TRGO  0x00090000U /**< Timer 4 TRGO event (JEXTSEL=1001) */
+#define ADC_INJECTEDTRIG_T5_CC4   0x000A0000U /**< Timer 5 CC4 event  (JEXTSEL=1010) */
+#define ADC_INJECTEDTRIG_T5_TRGO  0x000B0000U /**< Timer 5 TRGO event (JEXTSEL=1011) */
+#define ADC_INJECTEDTRIG_T8_CC2   0x000C0000U /**< Timer 8 CC2 event  (JEXTSEL=1100) */
+#define ADC_INJECTEDTRIG_T8_CC3   0x000D0000U /**< Timer 8 CC3 event  (JEXTSEL=1101) */
+#define ADC_INJECTEDTRIG_T8_CC4   0x000E0000U /**< Timer 8 CC4 event  (JEXTSEL=1110) */
+#define ADC_INJECTEDTRIG_EXTI_15  0x000F0000U /**< EXTI line 15        (JEXTSEL=1111) */
+/** @} */
+
+/**
+ * @name ADC External Trigger Edge for Injected Channels
+ * @{
+ */
+#define ADC_INJECTEDTRIGCONV_NONE     0x00000000U /**< Trigger detection disabled */
+#define ADC_INJECTEDTRIGCONV_RISING   0x00100000U /**< Trigger detection on rising edge */
+#define ADC_INJECTEDTRIGCONV_FALLING  0x00200000U /**< Trigger detection on falling edge */
+#define ADC_INJECTEDTRIGCONV_BOTH     0x00300000U /**< Trigger detection on both edges */
+/** @} */
+
 /**
  * @name ADC DMA Mode
  * @{
@@ -111,6 +143,25 @@ typedef struct {
 #define ADC_DMA_CIRCULAR      0x00000500U /**< DMA circular mode */
 /** @} */
 
+/**
+ * @name ADC Multi-mode Selection (common CCR MULTI field)
+ * @{
+ */
+#define ADC_MODE_INDEPENDENT          0x00000000U /**< All ADCs independent */
+#define ADC_MODE_DUAL_INTERLEAVED     0x00000007U /**< ADC1 + ADC2 interleaved, regular only */
+#define ADC_MODE_TRIPLE_INTERLEAVED   0x00000017U /**< ADC1 + ADC2 + ADC3 interleaved, regular only */
+/** @} */
+
+/**
+ * @name ADC Multi-mode DMA Access (common CCR DMA field)
+ * @{
+ */
+#define ADC_MULTI_DMA_DISABLE   0x00000000U /**< Each ADC uses its own DR and DMA request */
+#define ADC_MULTI_DMA_MODE1     0x00004000U /**< One halfword per request from CDR */
+#define ADC_MULTI_DMA_MODE2     0x00008000U /**< Two halfwords per request from CDR */
+#define ADC_MULTI_DMA_MODE3     0x0000C000U /**< Two bytes per request from CDR (6/8-bit) */
+/** @} */
+
 /**
  * @name ADC Channels
  * @{
@@ -192,6 +243,95 @@ void adc_init(ADC_TypeDef *ADCx, ADC_InitTypeDef *init);
  */
 void adc_config_channel(ADC_TypeDef *ADCx, ADC_ChannelConfTypeDef *config);
 
+/**
+ * @brief Configure the complete regular sequence from a channel table
+ * 
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ * @param table Channel table, entry i is converted at rank i + 1 (Rank field is ignored)
+ * @param count Number of entries (1-16)
+ * @return uint8_t 0 if successful, 1 if count is out of range
+ * 
+ * @note Scan mode must be enabled in adc_init() when count is greater than 1
+ */
+uint8_t adc_config_sequence(ADC_TypeDef *ADCx, const ADC_ChannelConfTypeDef *table, uint8_t count);
+
+/**
+ * @brief Configure the common multi-ADC mode
+ * 
+ * @param mode Multi-mode selection (ADC_MODE_xxx)
+ * @param dma_mode Common data register DMA access (ADC_MULTI_DMA_xxx)
+ * @param delay_cycles ADCCLK cycles between two interleaved sampling phases (5-20)
+ * @return uint8_t 0 if successful, 1 if the delay is out of range
+ * 
+ * @note All ADCs must be disabled (ADON = 0) while the mode is changed. In
+ *       interleaved modes only the master ADC1 is started or triggered, and
+ *       DMA reads ADC->CDR through the ADC1 stream.
+ */
+uint8_t adc_config_multimode(uint32_t mode, uint32_t dma_mode, uint32_t delay_cycles);
+
+/**
+ * @brief Configure the analog watchdog on a single regular channel
+ * 
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ * @param channel Guarded channel (ADC_CHANNEL_x)
+ * @param low Low threshold, conversions below it set the AWD flag
+ * @param high High threshold, conversions above it set the AWD flag
+ * 
+ * @note Thresholds are compared with the right-aligned 12-bit result. The
+ *       interrupt is enabled separately with adc_watchdog_enable_interrupt().
+ */
+void adc_config_watchdog(ADC_TypeDef *ADCx, uint32_t channel, uint16_t low, uint16_t high);
+
+/**
+ * @brief Enable the analog watchdog interrupt
+ * 
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ */
+void adc_watchdog_enable_interrupt(ADC_TypeDef *ADCx);
+
+/**
+ * @brief Disable the analog watchdog interrupt
+ * 
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ */
+void adc_watchdog_disable_interrupt(ADC_TypeDef *ADCx);
+
+/**
+ * @brief Configure a single-conversion injected group
+ * 
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ * @param channel Injected channel (ADC_CHANNEL_x)
+ * @param sampling_time Sample time selection (ADC_SAMPLETIME_xxx), shared with regular use of the channel
+ * @param trigger Injected trigger source (ADC_INJECTEDTRIG_xxx)
+ * @param edge Trigger edge (ADC_INJECTEDTRIGCONV_xxx)
+ * 
+ * @note Call after adc_init(), which clears the injected trigger. The result is read from JDR1.
+ */
+void adc_config_injected(ADC_TypeDef *ADCx, uint32_t channel, uint32_t sampling_time,
+                         uint32_t trigger, uint32_t edge);
+
+/**
+ * @brief Enable the injected end-of-conversion interrupt
+ * 
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ */
+void adc_injected_enable_interrupt(ADC_TypeDef *ADCx);
+
+/**
+ * @brief Disable the injected end-of-conversion interrupt
+ * 
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ */
+void adc_injected_disable_interrupt(ADC_TypeDef *ADCx);
+
+/**
+ * @brief Get the result of the first injected conversion
+ * 
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ * @return uint16_t Converted value from JDR1
+ */
+uint16_t adc_get_injected_value(ADC_TypeDef *ADCx);
+
 /**
  * @brief Enable the ADC
  * 
@@ -213,6 +353,15 @@ void adc_disable(ADC_TypeDef *ADCx);
  */
 void adc_start_conversion(ADC_TypeDef *ADCx);
 
+/**
+ * @brief Start ADC injected conversion
+ * 
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ * 
+ * @note The injected trigger must be disabled (ADC_INJECTEDTRIGCONV_NONE)
+ */
+void adc_start_injected_conversion(ADC_TypeDef *ADCx);
+
 /**
  * @brief Check if ADC conversion is complete
  * 
@@ -253,6 +402,22 @@ void adc_enable_temp_vref(void);
  */
 void adc_disable_temp_vref(void);
 
+/**
+ * @brief Get ADC kernel clock frequency
+ * 
+ * @return uint32_t ADCCLK in Hz (PCLK2 divided by the common ADCPRE setting)
+ */
+uint32_t adc_get_clock_freq(void);
+
+/**
+ * @brief Get total ADCCLK cycles needed for one conversion
+ * 
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ * @param sampling_time Sample time selection (ADC_SAMPLETIME_xxx)
+ * @return uint32_t Sampling cycles plus successive-approximation cycles for the current resolution
+ */
+uint32_t adc_get_conversion_cycles(ADC_TypeDef *ADCx, uint32_t sampling_time);
+
 /**
  * @brief Initialize GPIO pin for ADC input
  * 
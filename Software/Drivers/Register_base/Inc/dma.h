@@ -184,6 +184,44 @@ void dma_init(DMA_TypeDef *DMAx, uint32_t stream, DMA_InitTypeDef *init);
  */
 void dma_config_transfer(DMA_TypeDef *DMAx, uint32_t stream, uint32_t SrcAddress, uint32_t DstAddress, uint16_t DataLength);
 
+/**
+ * @brief Configure a peripheral-to-memory transfer in double-buffer mode
+ * 
+ * @param DMAx DMA instance (DMA1 or DMA2)
+ * @param stream Stream number (0-7)
+ * @param PeriphAddress Peripheral data register address
+ * @param Memory0Address First target buffer (M0AR), filled first
+ * @param Memory1Address Second target buffer (M1AR)
+ * @param DataLength Number of data items per buffer
+ * 
+ * @note Sets DBM and CIRC and starts with CT = 0. Call after dma_init() with the
+ *       stream disabled. TCIF is raised every time one buffer is full.
+ */
+void dma_config_double_buffer(DMA_TypeDef *DMAx, uint32_t stream, uint32_t PeriphAddress,
+                              uint32_t Memory0Address, uint32_t Memory1Address, uint16_t DataLength);
+
+/**
+ * @brief Get the memory target the stream is currently writing
+ * 
+ * @param DMAx DMA instance (DMA1 or DMA2)
+ * @param stream Stream number (0-7)
+ * @return uint8_t 0 if M0AR is in use, 1 if M1AR is in use
+ */
+uint8_t dma_get_current_target(DMA_TypeDef *DMAx, uint32_t stream);
+
+/**
+ * @brief Replace the address of one double-buffer target
+ * 
+ * @param DMAx DMA instance (DMA1 or DMA2)
+ * @param stream Stream number (0-7)
+ * @param target 0 for M0AR, 1 for M1AR
+ * @param address New buffer address
+ * 
+ * @note Only the target that is not currently in use may be changed while
+ *       the stream is running, i.e. target != dma_get_current_target()
+ */
+void dma_set_memory_address(DMA_TypeDef *DMAx, uint32_t stream, uint8_t target, uint32_t address);
+
 /**
  * @brief Enable DMA stream
  * 
@@ -14,6 +14,7 @@
 #include "stm32f407xx.h"
 #include "tim.h"
 #include "gpio.h"
+#include "dma.h"
 
 /**
  * @brief Encoder configuration structure
@@ -23,9 +24,34 @@ typedef struct {
     uint16_t CountsPerRevolution; /**< Encoder counts per full revolution (CPR) */
     uint8_t IC1Polarity;         /**< Input capture 1 polarity */
     uint8_t IC2Polarity;         /**< Input capture 2 polarity */
-    uint16_t MaxCount;           /**< Maximum count value (ARR) */
+    uint16_t MaxCount;           /**< Maximum count value (ARR + 1), 16-bit timers only */
+    TIM_TypeDef *TimestampTIMx;  /**< Free-running timer for M/T edge timestamps, NULL for the M method only */
+    uint8_t TimestampITR;        /**< Trigger input (ITR0-3) of TimestampTIMx wired to TIMx TRGO */
+    uint8_t IndexChannel;        /**< Capture channel wired to Z (ENCODER_INDEX_CHx), ENCODER_INDEX_NONE without index */
+    uint8_t IndexPolarity;       /**< Z edge that is captured */
 } Encoder_InitTypeDef;
 
+/**
+ * @brief Coherent observer state, published once per observer update
+ */
+typedef struct {
+    uint32_t Updates;            /**< Observer updates since encoder_observer_init() */
+    uint32_t Timestamp;          /**< Timestamp timer ticks at the update, 0 without one */
+    int32_t Count;               /**< Total count at the update */
+    int32_t Position;            /**< Observer position estimate in counts */
+    int32_t SpeedMilliRpm;       /**< Observer speed estimate in 0.001 RPM */
+    int32_t AccelRpmPerS;        /**< Observer acceleration estimate in RPM/s */
+} Encoder_SnapshotTypeDef;
+
+/**
+ * @brief One timed edge from the DMA edge ring
+ */
+typedef struct {
+    uint32_t Time;               /**< Timestamp of the edge, timestamp timer ticks */
+    uint32_t Interval;           /**< Ticks since the previous timed edge */
+    int32_t SpeedMilliRpm;       /**< Speed over that interval in 0.001 RPM, signed by the counting direction */
+} Encoder_EdgeTypeDef;
+
 /**
  * @brief Encoder data structure
  */
@@ -34,11 +60,44 @@ typedef struct {
     uint16_t CountsPerRevolution; /**< CPR value */
     int32_t TotalCount;          /**< Total accumulated count */
     int32_t LastCount;           /**< Last total count for speed calculation */
-    uint16_t LastHwCount;        /**< Last hardware count for overflow detection */
+    volatile int32_t WrapCount;  /**< Counter wraps, counted by the update interrupt (16-bit timers) */
+    uint8_t Wide;                /**< 1 on TIM2/TIM5: CNT is the 32-bit total count */
     int32_t Speed;               /**< Current speed in RPM */
     uint32_t LastTimeMs;         /**< Last time measurement in ms */
     uint8_t LastPhaseA;          /**< Last A phase state for software decoding */
     uint8_t LastPhaseB;          /**< Last B phase state for software decoding */
+    TIM_TypeDef *TimestampTIMx;  /**< Timestamp timer, NULL in M mode */
+    uint32_t TimestampFreq;      /**< Timestamp timer clock in Hz */
+    uint32_t LastEdgeCount;      /**< Counter value captured at the last timed edge */
+    uint32_t LastEdgeTime;       /**< Timestamp of the last timed edge */
+    int32_t SpeedMilliRpm;       /**< Current speed in 0.001 RPM */
+    int64_t ObsPosition;         /**< Observer position, counts in Q32 */
+    int64_t ObsVelocity;         /**< Observer velocity, counts per update in Q32 */
+    int64_t ObsAccel;            /**< Observer acceleration, counts per update squared in Q32 */
+    uint32_t ObsGain[3];         /**< Observer gains for position, velocity and acceleration, Q32 */
+    uint32_t ObsSpeedScale;      /**< mRPM per count per update, times 2^-20 after a >> 12 */
+    uint32_t ObsAccelScale;      /**< RPM/s per count per update squared, same scaling */
+    int32_t ObsCount;            /**< Unwrapped count seen by the observer */
+    uint32_t ObsLastHwCount;     /**< Hardware count at the last observer update */
+    volatile uint32_t SnapshotSequence; /**< Odd while Snapshot is being written */
+    Encoder_SnapshotTypeDef Snapshot;   /**< Latest observer state, read with encoder_get_snapshot() */
+    uint8_t IndexChannel;        /**< Z capture channel, ENCODER_INDEX_NONE without index */
+    volatile int32_t HomeOffset; /**< Raw count subtracted from all published counts, set by homing */
+    volatile uint8_t HomeState;  /**< ENCODER_HOME_xxx */
+    volatile int32_t HomeRaw;    /**< Raw count at the homing index, until encoder_update() applies it */
+    volatile int32_t IndexRaw;   /**< Raw count captured at the last index pulse */
+    volatile uint32_t IndexPulses; /**< Index pulses since init or encoder_reset_count() */
+    volatile int32_t Revolutions;  /**< Signed revolutions counted index to index, 0 at home */
+    volatile int32_t IndexDeviation; /**< Last index-to-index spacing minus CPR, in counts */
+    volatile uint32_t IndexErrors; /**< Index spacings off by more than ENCODER_INDEX_TOLERANCE, or missed pulses */
+    DMA_TypeDef *EdgeDMAx;       /**< DMA controller filling the edge ring, NULL while off */
+    uint32_t EdgeStream;         /**< DMA stream filling the edge ring */
+    const volatile uint32_t *EdgeBuffer; /**< Edge ring, one timestamp per timed edge */
+    uint16_t EdgeLength;         /**< Edge ring length in timestamps */
+    uint16_t EdgeRead;           /**< Next ring entry to read */
+    uint8_t EdgeValid;           /**< EdgeLastTime holds a consumed edge */
+    uint32_t EdgeLastTime;       /**< Timestamp of the last consumed edge */
+    uint32_t EdgeOverruns;       /**< Times the DMA lapped the reader */
 } Encoder_HandleTypeDef;
 
 /**
@@ -49,6 +108,48 @@ typedef struct {
 #define ENCODER_IC_POLARITY_FALLING    0x02  /**< Falling edge polarity */
 /** @} */
 
+/**
+ * @name Encoder M/T Velocity
+ * @{
+ */
+#define ENCODER_MT_COUNTS_PER_EDGE     4     /**< Counts between two timed edges (TI1 rising, 4x decoding) */
+#define ENCODER_MT_TIMEOUT_MS          500   /**< No timed edge for this long reads as standstill */
+/** @} */
+
+/**
+ * @name Encoder Tracking Observer
+ * @{
+ */
+#define ENCODER_OBS_MAX_ERROR          32767 /**< Tracking error clamp in counts, keeps the error in Q16 */
+/** @} */
+
+/**
+ * @name Encoder Index (Z)
+ * @{
+ */
+#define ENCODER_INDEX_NONE             0     /**< No index channel */
+#define ENCODER_INDEX_CH3              3     /**< Z captured on channel 3 */
+#define ENCODER_INDEX_CH4              4     /**< Z captured on channel 4 */
+#define ENCODER_INDEX_TOLERANCE        2     /**< Index spacing error in counts accepted as gating jitter */
+/** @} */
+
+/**
+ * @name Encoder Homing State
+ * @{
+ */
+#define ENCODER_HOME_IDLE              0     /**< Not homed, HomeOffset is 0 */
+#define ENCODER_HOME_ARMED             1     /**< Waiting for the next index pulse */
+#define ENCODER_HOME_LATCHED           2     /**< Index captured, applied by the next encoder_update() */
+#define ENCODER_HOME_DONE              3     /**< Counts are relative to the homing index */
+/** @} */
+
+/**
+ * @name Encoder Registry
+ * @{
+ */
+#define ENCODER_MAX_INSTANCES          4     /**< Encoders that can be registered at the same time */
+/** @} */
+
 /**
  * @name Encoder Mode
  * @{
@@ -64,12 +165,21 @@ typedef struct {
  * 
  * @details Configures the specified timer in hardware encoder mode with GPIO pins
  *          as encoder inputs. Sets up quadrature decoding using TI1 and TI2.
+ *          On the 32-bit timers (TIM2, TIM5) the counter spans the full 32-bit
+ *          range and MaxCount is ignored; no interrupt is needed. On 16-bit
+ *          timers the update interrupt counts wraps of MaxCount.
+ *          The handle is registered for encoder_irq_dispatch() and
+ *          encoder_update_all(), replacing any handle on the same timer.
+ *          With an index channel, the Z edge latches the counter in hardware
+ *          and its capture interrupt counts revolutions.
  * 
  * @param handle Pointer to encoder handle structure
  * @param init Pointer to encoder initialization structure
- * @return uint8_t 0 if successful, 1 if error
+ * @return uint8_t 0 if successful, 1 if error (no encoder timer, or
+ *         ENCODER_MAX_INSTANCES handles already registered)
  * 
  * @note GPIO pins must be configured separately before calling this function
+ * @note Supported timers: TIM1, TIM2, TIM3, TIM4, TIM5 and TIM8
  */
 uint8_t encoder_init(Encoder_HandleTypeDef *handle, Encoder_InitTypeDef *init);
 
@@ -115,14 +225,15 @@ void encoder_stop(Encoder_HandleTypeDef *handle);
  * @details Reads the current timer counter value representing encoder position.
  * 
  * @param handle Pointer to encoder handle structure
- * @return uint16_t Current encoder count (0 to MaxCount)
+ * @return uint32_t Current encoder count (0 to MaxCount - 1, full 32 bits on TIM2/TIM5)
  */
-uint16_t encoder_get_count(Encoder_HandleTypeDef *handle);
+uint32_t encoder_get_count(Encoder_HandleTypeDef *handle);
 
 /**
  * @brief Reset encoder count to zero
  * 
- * @details Resets both the timer counter and accumulated count to zero.
+ * @details Resets both the timer counter and accumulated count to zero. The
+ *          homing and the index reference are dropped.
  * 
  * @param handle Pointer to encoder handle structure
  */
@@ -140,19 +251,83 @@ void encoder_reset_count(Encoder_HandleTypeDef *handle);
 int8_t encoder_get_direction(Encoder_HandleTypeDef *handle);
 
 /**
- * @brief Update encoder total count and detect direction
+ * @brief Update encoder total count
  * 
- * @details Updates accumulated count considering counter overflow/underflow.
- *          Should be called periodically or in timer interrupt.
+ * @details 32-bit timers: TotalCount is CNT itself. 16-bit timers: TotalCount is
+ *          wraps * MaxCount + CNT, so no polling rate is required. Once homed,
+ *          the count at the homing index is subtracted.
  * 
  * @param handle Pointer to encoder handle structure
+ * 
+ * @note Call at a lower priority than the encoder timer interrupt
  */
 void encoder_update(Encoder_HandleTypeDef *handle);
 
+/**
+ * @brief Zero the count on the next index pulse
+ * 
+ * @details The index interrupt latches the raw count at the Z edge, and the
+ *          next encoder_update() makes that count the origin of TotalCount,
+ *          the observer and the revolution counter.
+ * 
+ * @param handle Pointer to encoder handle structure
+ * @return uint8_t 0 if successful, 1 if the encoder has no index channel
+ */
+uint8_t encoder_home_start(Encoder_HandleTypeDef *handle);
+
+/**
+ * @brief Check whether the count is referenced to the index
+ * 
+ * @param handle Pointer to encoder handle structure
+ * @return uint8_t 1 once homing completed, 0 otherwise
+ */
+uint8_t encoder_is_homed(Encoder_HandleTypeDef *handle);
+
+/**
+ * @brief Get the absolute shaft angle
+ * 
+ * @details Counts from the last index pulse, read from the live counter, so it
+ *          can be used for commutation.
+ * 
+ * @param handle Pointer to encoder handle structure
+ * @param angle Receives the angle, 0 to CountsPerRevolution - 1 counts
+ * @return uint8_t 1 if successful, 0 if no index pulse has been seen yet
+ */
+uint8_t encoder_get_angle(Encoder_HandleTypeDef *handle, uint16_t *angle);
+
+/**
+ * @brief Update the total count of every registered encoder
+ * 
+ * @details All counters are latched back to back first and folded into
+ *          TotalCount afterwards, so the counts of all axes are taken within
+ *          a few bus cycles of each other.
+ * 
+ * @note Call at a lower priority than the encoder timer interrupts
+ */
+void encoder_update_all(void);
+
+/**
+ * @brief Get a registered encoder
+ * 
+ * @param index Registration index, 0 to encoder_get_instance_count() - 1
+ * @return Encoder_HandleTypeDef* Handle, NULL if the index is not in use
+ */
+Encoder_HandleTypeDef *encoder_get_instance(uint8_t index);
+
+/**
+ * @brief Get the number of registered encoders
+ * 
+ * @return uint8_t Number of handles, at most ENCODER_MAX_INSTANCES
+ */
+uint8_t encoder_get_instance_count(void);
+
 /**
  * @brief Calculate encoder speed in RPM
  * 
  * @details Calculates rotational speed based on count changes and time elapsed.
+ *          With a timestamp timer (M/T mode) the time is the exact interval
+ *          between the last timed edges of this call and the previous one, in
+ *          timestamp ticks. Otherwise it is the millisecond interval between calls.
  * 
  * @param handle Pointer to encoder handle structure
  * @param current_time_ms Current system time in milliseconds
@@ -160,14 +335,131 @@ void encoder_update(Encoder_HandleTypeDef *handle);
  */
 int32_t encoder_calculate_speed_rpm(Encoder_HandleTypeDef *handle, uint32_t current_time_ms);
 
+/**
+ * @brief Calculate encoder speed in RPM without reading the counter
+ * 
+ * @details Same as encoder_calculate_speed_rpm(), but uses the TotalCount left
+ *          by the last encoder_update() or encoder_update_all(), so all axes
+ *          can be latched together and their speeds computed afterwards.
+ * 
+ * @param handle Pointer to encoder handle structure
+ * @param current_time_ms Time of the latch in milliseconds
+ * @return int32_t Speed in RPM (positive or negative)
+ */
+int32_t encoder_calculate_speed_latched(Encoder_HandleTypeDef *handle, uint32_t current_time_ms);
+
+/**
+ * @brief Get the speed of the last calculation with sub-RPM resolution
+ * 
+ * @param handle Pointer to encoder handle structure
+ * @return int32_t Speed in 0.001 RPM (positive or negative)
+ * 
+ * @note Updated by encoder_calculate_speed_rpm() and encoder_calculate_speed_latched()
+ */
+int32_t encoder_get_speed_mrpm(Encoder_HandleTypeDef *handle);
+
+/**
+ * @brief Stream the timestamp of every timed edge into a ring by DMA
+ * 
+ * @details The timestamp timer capture that M/T mode uses requests one DMA
+ *          transfer per edge, in circular mode and without interrupts. The ring
+ *          is drained with encoder_edge_read().
+ * 
+ * @param handle Pointer to encoder handle structure, with a timestamp timer
+ * @param DMAx DMA controller serving the CC1 request of the timestamp timer
+ * @param stream DMA stream (DMA_STREAMx) of that request
+ * @param channel DMA channel (DMA_CHANNEL_x) of that request
+ * @param buffer Ring storage in SRAM, not CCM RAM
+ * @param length Ring length in timestamps, at least 2
+ * @return uint8_t 0 if successful, 1 if error
+ * 
+ * @note The DMA controller clock must be enabled before calling this function
+ */
+uint8_t encoder_edge_start(Encoder_HandleTypeDef *handle, DMA_TypeDef *DMAx, uint32_t stream,
+                           uint32_t channel, volatile uint32_t *buffer, uint16_t length);
+
+/**
+ * @brief Take new edges out of the ring as instantaneous speeds
+ * 
+ * @details Each edge is ENCODER_MT_COUNTS_PER_EDGE counts after the previous
+ *          one, so its interval gives the speed over those counts. If the DMA
+ *          lapped the reader, the backlog is dropped, EdgeOverruns is
+ *          incremented and reading restarts at the newest edge.
+ * 
+ * @param handle Pointer to encoder handle structure
+ * @param edges Destination
+ * @param max Capacity of edges
+ * @return uint16_t Edges written to edges
+ * 
+ * @note Read at least once per ring length of edges to avoid an overrun
+ */
+uint16_t encoder_edge_read(Encoder_HandleTypeDef *handle, Encoder_EdgeTypeDef *edges, uint16_t max);
+
+/**
+ * @brief Start the angle-tracking observer
+ * 
+ * @details Third-order tracking loop with all three poles at -2*pi*bandwidth.
+ *          It follows constant acceleration without steady-state error. The
+ *          estimates are published in Snapshot on every update.
+ * 
+ * @param handle Pointer to encoder handle structure, after encoder_init()
+ * @param rate_hz Rate at which encoder_observer_update() will be called
+ * @param bandwidth_hz Loop bandwidth, at most rate_hz / 20
+ * @return uint8_t 0 if successful, 1 if error
+ * 
+ * @note The observer starts at TotalCount and then unwraps the counter itself,
+ *       encoder_reset_count() does not move it
+ */
+uint8_t encoder_observer_init(Encoder_HandleTypeDef *handle, uint32_t rate_hz, uint32_t bandwidth_hz);
+
+/**
+ * @brief Advance the observer by one update period
+ * 
+ * @details Integer-only, meant for a fixed-rate timer interrupt.
+ * 
+ * @param handle Pointer to encoder handle structure
+ */
+void encoder_observer_update(Encoder_HandleTypeDef *handle);
+
+/**
+ * @brief Advance the observer of every registered encoder
+ * 
+ * @details Encoders without a started observer are skipped, so one fixed-rate
+ *          interrupt serves all axes without knowing their handles.
+ */
+void encoder_observer_update_all(void);
+
+/**
+ * @brief Copy the latest observer state as one consistent tuple
+ * 
+ * @details Sequence-counter read: the copy is repeated if an observer update
+ *          ran in between. Interrupts stay enabled and the writer never waits.
+ * 
+ * @param handle Pointer to encoder handle structure
+ * @param snapshot Destination
+ * @return uint8_t 1 if successful, 0 if called from a context that interrupted
+ *         the update itself (the state is then half written)
+ */
+uint8_t encoder_get_snapshot(Encoder_HandleTypeDef *handle, Encoder_SnapshotTypeDef *snapshot);
+
 /**
  * @brief Generic timer IRQ handler for encoder overflow/underflow
  * 
- * @details Handles overflow/underflow interrupts for extending count beyond 16-bit.
+ * @details Counts wraps of a 16-bit encoder timer and processes index captures.
  *          Should be called from the appropriate timer IRQ handler.
  * 
  * @param handle Pointer to encoder handle structure
  */
 void encoder_timer_irq_handler(Encoder_HandleTypeDef *handle);
 
+/**
+ * @brief Route a timer interrupt to the encoder registered on that timer
+ * 
+ * @details One call per timer IRQ handler replaces a global handle per vector.
+ *          Does nothing if no encoder is registered on the timer.
+ * 
+ * @param TIMx Timer whose interrupt fired
+ */
+void encoder_irq_dispatch(TIM_TypeDef *TIMx);
+
 #endif /* ENCODER_H */
@@ -0,0 +1,59 @@
+/**
+ * @file flash.h
+ * @author Haoyi Chen
+ * @date 2025-08-30
+ * @brief STM32F4 embedded flash register-level driver header
+ *
+ * @details This file contains flash erase/program function declarations and macro
+ * definitions for STM32F407 series microcontrollers. Programming uses 32-bit
+ * parallelism, which requires VDD between 2.7 V and 3.6 V.
+ *
+ * @note The F407 has a single flash bank. Code fetches stall while an erase or
+ * program operation runs, for up to about 2 s for a 128 KB sector, and so does
+ * every interrupt whose vector or handler lives in flash.
+ */
+
+#ifndef FLASH_H
+#define FLASH_H
+
+#include "stm32f407xx.h"
+
+/**
+ * @name Flash Sectors
+ * @{
+ */
+#define FLASH_SECTOR_COUNT      12              /**< Sectors 0-3: 16 KB, 4: 64 KB, 5-11: 128 KB */
+#define FLASH_SECTOR_11_BASE    0x080E0000U     /**< Last 128 KB sector */
+/** @} */
+
+/**
+ * @brief Unlock the flash control register
+ * 
+ * @return uint8_t 0 if successful, 1 if the key sequence was rejected
+ */
+uint8_t flash_unlock(void);
+
+/**
+ * @brief Lock the flash control register
+ */
+void flash_lock(void);
+
+/**
+ * @brief Erase one sector
+ * 
+ * @param sector Sector number (0 to FLASH_SECTOR_COUNT - 1)
+ * @return uint8_t 0 if successful, 1 on error
+ */
+uint8_t flash_erase_sector(uint8_t sector);
+
+/**
+ * @brief Program words into erased flash
+ * 
+ * @param address Destination, word aligned
+ * @param data Source words
+ * @param count Number of words
+ * @return uint8_t 0 if successful, 1 on error
+ */
+uint8_t flash_program(uint32_t address, const uint32_t *data, uint32_t count);
+
+#endif /* FLASH_H */
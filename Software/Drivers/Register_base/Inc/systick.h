@@ -81,6 +81,19 @@ uint8_t systick_init(uint32_t system_clock_hz);
  */
 uint32_t systick_get_ms(void);
 
+/**
+ * @brief Get current system time in microseconds
+ * 
+ * @details Combines the millisecond counter with the elapsed part of the
+ *          current SysTick reload period for sub-millisecond timestamps.
+ *          Rolls over approximately every 71.6 minutes.
+ * 
+ * @return uint32_t Current system time in microseconds
+ * 
+ * @note Safe in interrupt context, including handlers that preempt SysTick
+ */
+uint32_t systick_get_us(void);
+
 /**
  * @brief Calculate elapsed time since a reference point
  * 
@@ -83,6 +83,20 @@ typedef struct {
 #define TIM_CHANNEL_4               0x03  
 /** @} */
 
+/**
+ * @name Trigger Output (TRGO) Sources
+ * @{
+ */
+#define TIM_TRGO_RESET              0x00  /**< UG bit used as TRGO */
+#define TIM_TRGO_ENABLE             0x01  /**< Counter enable used as TRGO */
+#define TIM_TRGO_UPDATE             0x02  /**< Update event used as TRGO */
+#define TIM_TRGO_OC1                0x03  /**< Compare pulse (CC1IF) used as TRGO */
+#define TIM_TRGO_OC1REF             0x04  /**< OC1REF used as TRGO */
+#define TIM_TRGO_OC2REF             0x05  /**< OC2REF used as TRGO */
+#define TIM_TRGO_OC3REF             0x06  /**< OC3REF used as TRGO */
+#define TIM_TRGO_OC4REF             0x07  /**< OC4REF used as TRGO */
+/** @} */
+
 /**
  * @brief Initialize a timer with basic parameters
  * 
@@ -159,4 +173,34 @@ uint8_t tim_get_update_flag(TIM_TypeDef *TIMx);
  */
 void tim_clear_update_flag(TIM_TypeDef *TIMx);
 
+/**
+ * @brief Get timer kernel clock frequency
+ * 
+ * @param TIMx Timer instance
+ * @return uint32_t Counter clock before prescaler in Hz
+ * 
+ * @note APB timer clocks run at twice PCLK when the APB prescaler is not 1
+ */
+uint32_t tim_get_clock_freq(TIM_TypeDef *TIMx);
+
+/**
+ * @brief Program PSC/ARR for the closest achievable update frequency
+ * 
+ * @param TIMx Timer instance
+ * @param freq_hz Requested update frequency in Hz
+ * @return uint32_t Achieved update frequency in Hz, 0 if the request is invalid
+ * 
+ * @note Counter is not started. A stopped counter is loaded at once by a UG
+ *       event that does not reach TRGO; a running one switches at its next update
+ */
+uint32_t tim_set_frequency(TIM_TypeDef *TIMx, uint32_t freq_hz);
+
+/**
+ * @brief Select the trigger output (TRGO) source
+ * 
+ * @param TIMx Timer instance
+ * @param source TRGO source (TIM_TRGO_xxx)
+ */
+void tim_set_trgo(TIM_TypeDef *TIMx, uint8_t source);
+
 #endif /* TIM_H */
@@ -113,7 +113,7 @@ typedef struct {
     uint8_t *pRxBuffer;         /**< Pointer to RX buffer */
     uint16_t RxSize;            /**< RX buffer size */
     uint16_t RxCount;           /**< RX counter */
-    uint8_t TxBusy;             /**< Transmission ongoing flag */
+    volatile uint8_t TxBusy;    /**< Transmission ongoing flag, cleared by uart_irq_handler() */
     uint8_t RxBusy;             /**< Reception ongoing flag */
 } UART_HandleTypeDef;
 
@@ -185,6 +185,33 @@ int16_t uart_receive_char(UART_HandleTypeDef *huart);
  */
 uint8_t uart_transmit_string(UART_HandleTypeDef *huart, const char *str);
 
+/**
+ * @brief Start sending data through UART (interrupt mode)
+ * 
+ * @param huart Pointer to UART handle structure
+ * @param data Pointer to data buffer, must stay valid until uart_tx_busy() returns 0
+ * @param size Buffer size
+ * @return uint8_t 0 if started, 1 if error or a transmission is still running
+ * 
+ * @note The UART interrupt must call uart_irq_handler()
+ */
+uint8_t uart_transmit_it(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size);
+
+/**
+ * @brief Check whether an interrupt-mode transmission is still running
+ * 
+ * @param huart Pointer to UART handle structure
+ * @return uint8_t 1 while bytes are left to hand to the UART, 0 otherwise
+ */
+uint8_t uart_tx_busy(UART_HandleTypeDef *huart);
+
+/**
+ * @brief UART interrupt handler, feeds interrupt-mode transmissions
+ * 
+ * @param huart Pointer to UART handle structure
+ */
+void uart_irq_handler(UART_HandleTypeDef *huart);
+
 /**
  * @brief Check if UART flag is set
  * 
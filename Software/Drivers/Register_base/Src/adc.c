@@ -13,6 +13,7 @@
 
 #include "../Inc/adc.h"
 #include "gpio.h"
+#include "rcc.h"
 
 /**
  * @brief Initialize ADC with the specified parameters
@@ -120,6 +121,175 @@ void adc_config_channel(ADC_TypeDef *ADCx, ADC_ChannelConfTypeDef *config) {
     }
 }
 
+/**
+ * @brief Configure the complete regular sequence from a channel table
+ * 
+ * @details Programs every rank through adc_config_channel() in order, then sets
+ *          the sequence length once so intermediate calls cannot shorten it.
+ *
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ * @param table Channel table, entry i is converted at rank i + 1 (Rank field is ignored)
+ * @param count Number of entries (1-16)
+ * @return uint8_t 0 if successful, 1 if count is out of range
+ */
+uint8_t adc_config_sequence(ADC_TypeDef *ADCx, const ADC_ChannelConfTypeDef *table, uint8_t count) {
+    ADC_ChannelConfTypeDef config;
+    
+    if (!table || count == 0 || count > 16) {
+        return 1;
+    }
+    
+    for (uint8_t i = 0; i < count; i++) {
+        config.Channel = table[i].Channel;
+        config.Rank = i + 1;
+        config.SamplingTime = table[i].SamplingTime;
+        adc_config_channel(ADCx, &config);
+    }
+    
+    /* Sequence length L = count - 1 */
+    ADCx->SQR1 &= ~ADC_SQR1_L;
+    ADCx->SQR1 |= ((uint32_t)(count - 1) << 20);
+    
+    return 0;
+}
+
+/**
+ * @brief Configure the common multi-ADC mode
+ * 
+ * @details Programs MULTI, DMA and DELAY in the common CCR. DDS is left cleared,
+ *          so common DMA requests stop once the stream reaches its end.
+ *
+ * @param mode Multi-mode selection (ADC_MODE_xxx)
+ * @param dma_mode Common data register DMA access (ADC_MULTI_DMA_xxx)
+ * @param delay_cycles ADCCLK cycles between two interleaved sampling phases (5-20)
+ * @return uint8_t 0 if successful, 1 if the delay is out of range
+ */
+uint8_t adc_config_multimode(uint32_t mode, uint32_t dma_mode, uint32_t delay_cycles) {
+    if (delay_cycles < 5 || delay_cycles > 20) {
+        return 1;
+    }
+    
+    ADC->CCR &= ~(ADC_CCR_MULTI | ADC_CCR_DMA | ADC_CCR_DDS | ADC_CCR_DELAY);
+    ADC->CCR |= mode | dma_mode | ((delay_cycles - 5) << ADC_CCR_DELAY_Pos);
+    
+    return 0;
+}
+
+/**
+ * @brief Configure the analog watchdog on a single regular channel
+ * 
+ * @details Writes HTR/LTR, selects the channel with AWDSGL and enables the
+ *          watchdog on regular conversions. Injected conversions are not guarded.
+ *
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ * @param channel Guarded channel (ADC_CHANNEL_x)
+ * @param low Low threshold, conversions below it set the AWD flag
+ * @param high High threshold, conversions above it set the AWD flag
+ */
+void adc_config_watchdog(ADC_TypeDef *ADCx, uint32_t channel, uint16_t low, uint16_t high) {
+    ADCx->HTR = high & 0x0FFF;
+    ADCx->LTR = low & 0x0FFF;
+    
+    ADCx->CR1 &= ~(ADC_CR1_AWDCH | ADC_CR1_JAWDEN);
+    ADCx->CR1 |= (channel << ADC_CR1_AWDCH_Pos) | ADC_CR1_AWDSGL | ADC_CR1_AWDEN;
+    
+    /* Drop a stale flag so the first interrupt belongs to a new conversion */
+    ADCx->SR = (uint32_t)~ADC_SR_AWD;  /* rc_w0: writing 1 leaves the other flags untouched */
+}
+
+/**
+ * @brief Enable the analog watchdog interrupt
+ * 
+ * @details Sets the AWDIE bit in CR1. The shared ADC_IRQn must be enabled in NVIC.
+ *
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ */
+void adc_watchdog_enable_interrupt(ADC_TypeDef *ADCx) {
+    ADCx->CR1 |= ADC_CR1_AWDIE;
+}
+
+/**
+ * @brief Disable the analog watchdog interrupt
+ * 
+ * @details Clears the AWDIE bit in CR1. The AWD flag keeps being set.
+ *
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ */
+void adc_watchdog_disable_interrupt(ADC_TypeDef *ADCx) {
+    ADCx->CR1 &= ~ADC_CR1_AWDIE;
+}
+
+/**
+ * @brief Configure a single-conversion injected group
+ * 
+ * @details With JL = 0 the only conversion of the group is taken from JSQ4 and
+ *          its result lands in JDR1. The sampling time goes to SMPR1/SMPR2, so
+ *          it also applies when the channel is converted in the regular group.
+ *
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ * @param channel Injected channel (ADC_CHANNEL_x)
+ * @param sampling_time Sample time selection (ADC_SAMPLETIME_xxx)
+ * @param trigger Injected trigger source (ADC_INJECTEDTRIG_xxx)
+ * @param edge Trigger edge (ADC_INJECTEDTRIGCONV_xxx)
+ */
+void adc_config_injected(ADC_TypeDef *ADCx, uint32_t channel, uint32_t sampling_time,
+                         uint32_t trigger, uint32_t edge) {
+    /* One conversion (JL = 0), channel in JSQ4, no offset */
+    ADCx->JSQR = channel << ADC_JSQR_JSQ4_Pos;
+    ADCx->JOFR1 = 0;
+    
+    if (channel <= 9) {
+        uint32_t shift = 3 * channel;
+        ADCx->SMPR2 &= ~(0x7 << shift);
+        ADCx->SMPR2 |= (sampling_time << shift);
+    } else {
+        uint32_t shift = 3 * (channel - 10);
+        ADCx->SMPR1 &= ~(0x7 << shift);
+        ADCx->SMPR1 |= (sampling_time << shift);
+    }
+    
+    /* Injected group is triggered on its own, never appended to the regular one */
+    ADCx->CR1 &= ~ADC_CR1_JAUTO;
+    ADCx->CR2 &= ~(ADC_CR2_JEXTSEL | ADC_CR2_JEXTEN);
+    ADCx->CR2 |= trigger | edge;
+    
+    ADCx->SR = (uint32_t)~(ADC_SR_JEOC | ADC_SR_JSTRT);
+}
+
+/**
+ * @brief Enable the injected end-of-conversion interrupt
+ * 
+ * @details Sets the JEOCIE bit in CR1. The shared ADC_IRQn must be enabled in NVIC.
+ *
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ */
+void adc_injected_enable_interrupt(ADC_TypeDef *ADCx) {
+    ADCx->CR1 |= ADC_CR1_JEOCIE;
+}
+
+/**
+ * @brief Disable the injected end-of-conversion interrupt
+ * 
+ * @details Clears the JEOCIE bit in CR1.
+ *
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ */
+void adc_injected_disable_interrupt(ADC_TypeDef *ADCx) {
+    ADCx->CR1 &= ~ADC_CR1_JEOCIE;
+}
+
+/**
+ * @brief Get the result of the first injected conversion
+ * 
+ * @details Reads JDR1. Unlike DR, reading JDR1 does not clear JEOC.
+ *
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ * @return uint16_t Converted value from JDR1
+ */
+uint16_t adc_get_injected_value(ADC_TypeDef *ADCx) {
+    return (uint16_t)ADCx->JDR1;
+}
+
 /**
  * @brief Enable the ADC
  * 
@@ -162,6 +332,18 @@ void adc_start_conversion(ADC_TypeDef *ADCx) {
     ADCx->CR2 |= ADC_CR2_SWSTART;
 }
 
+/**
+ * @brief Start ADC injected conversion
+ * 
+ * @details Sets the JSWSTART bit in the CR2 register. Only takes effect while
+ *          the injected external trigger is disabled.
+ *
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ */
+void adc_start_injected_conversion(ADC_TypeDef *ADCx) {
+    ADCx->CR2 |= ADC_CR2_JSWSTART;
+}
+
 /**
  * @brief Check if ADC conversion is complete
  * 
@@ -230,6 +412,35 @@ void adc_disable_temp_vref(void) {
     ADC->CCR &= ~ADC_CCR_TSVREFE;
 }
 
+/**
+ * @brief Get ADC kernel clock frequency
+ * 
+ * @details ADCCLK = PCLK2 / (2 * (ADCPRE + 1)), ADCPRE being common to all ADCs.
+ *
+ * @return uint32_t ADCCLK in Hz
+ */
+uint32_t adc_get_clock_freq(void) {
+    uint32_t adcpre = (ADC->CCR & ADC_CCR_ADCPRE) >> ADC_CCR_ADCPRE_Pos;
+    
+    return rcc_get_pclk2_freq() / (2 * (adcpre + 1));
+}
+
+/**
+ * @brief Get total ADCCLK cycles needed for one conversion
+ * 
+ * @details Tconv = sampling time + resolution cycles (12/10/8/6 for 12/10/8/6-bit).
+ *
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ * @param sampling_time Sample time selection (ADC_SAMPLETIME_xxx)
+ * @return uint32_t Total ADCCLK cycles per conversion
+ */
+uint32_t adc_get_conversion_cycles(ADC_TypeDef *ADCx, uint32_t sampling_time) {
+    static const uint16_t sample_cycles[8] = {3, 15, 28, 56, 84, 112, 144, 480};
+    uint32_t res = (ADCx->CR1 & ADC_CR1_RES) >> ADC_CR1_RES_Pos;
+    
+    return sample_cycles[sampling_time & 0x7] + (12 - 2 * res);
+}
+
 /**
  * @brief Initialize GPIO pin for ADC input
  * 
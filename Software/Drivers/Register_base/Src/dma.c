@@ -143,6 +143,82 @@ void dma_config_transfer(DMA_TypeDef *DMAx, uint32_t stream, uint32_t SrcAddress
     }
 }
 
+/**
+ * @brief Configure a peripheral-to-memory transfer in double-buffer mode
+ * 
+ * @details Programs PAR, both memory targets and NDTR, then sets DBM. The
+ *          hardware forces circular operation in this mode and toggles CT at
+ *          the end of every buffer, so software can refill the idle target.
+ *
+ * @param DMAx DMA instance (DMA1 or DMA2)
+ * @param stream Stream number (0-7)
+ * @param PeriphAddress Peripheral data register address
+ * @param Memory0Address First target buffer (M0AR), filled first
+ * @param Memory1Address Second target buffer (M1AR)
+ * @param DataLength Number of data items per buffer
+ */
+void dma_config_double_buffer(DMA_TypeDef *DMAx, uint32_t stream, uint32_t PeriphAddress,
+                              uint32_t Memory0Address, uint32_t Memory1Address, uint16_t DataLength) {
+    DMA_Stream_TypeDef *DMAStream = dma_get_stream(DMAx, stream);
+    
+    /* Make sure the stream is disabled */
+    if (DMAStream->CR & DMA_SxCR_EN) {
+        DMAStream->CR &= ~DMA_SxCR_EN;
+        while(DMAStream->CR & DMA_SxCR_EN);
+    }
+    
+    /* Clear any pending flags for this stream before configuration */
+    if (stream < 4) {
+        DMAx->LIFCR = (0x3F << (stream * 6));
+    } else {
+        DMAx->HIFCR = (0x3F << ((stream - 4) * 6));
+    }
+    
+    DMAStream->PAR = PeriphAddress;
+    DMAStream->M0AR = Memory0Address;
+    DMAStream->M1AR = Memory1Address;
+    DMAStream->NDTR = (DataLength > 0) ? DataLength : 1;
+    
+    /* Start on M0AR; DBM implies circular mode */
+    DMAStream->CR &= ~DMA_SxCR_CT;
+    DMAStream->CR |= DMA_SxCR_DBM | DMA_SxCR_CIRC;
+}
+
+/**
+ * @brief Get the memory target the stream is currently writing
+ * 
+ * @details Reads the CT bit of the stream CR register.
+ *
+ * @param DMAx DMA instance (DMA1 or DMA2)
+ * @param stream Stream number (0-7)
+ * @return uint8_t 0 if M0AR is in use, 1 if M1AR is in use
+ */
+uint8_t dma_get_current_target(DMA_TypeDef *DMAx, uint32_t stream) {
+    DMA_Stream_TypeDef *DMAStream = dma_get_stream(DMAx, stream);
+    return (DMAStream->CR & DMA_SxCR_CT) ? 1 : 0;
+}
+
+/**
+ * @brief Replace the address of one double-buffer target
+ * 
+ * @details Writes M0AR or M1AR. Hardware ignores writes to the target that
+ *          is in use while the stream is enabled.
+ *
+ * @param DMAx DMA instance (DMA1 or DMA2)
+ * @param stream Stream number (0-7)
+ * @param target 0 for M0AR, 1 for M1AR
+ * @param address New buffer address
+ */
+void dma_set_memory_address(DMA_TypeDef *DMAx, uint32_t stream, uint8_t target, uint32_t address) {
+    DMA_Stream_TypeDef *DMAStream = dma_get_stream(DMAx, stream);
+    
+    if (target) {
+        DMAStream->M1AR = address;
+    } else {
+        DMAStream->M0AR = address;
+    }
+}
+
 /**
  * @brief Enable DMA stream
  * 
@@ -10,6 +10,338 @@
 
 #include "../Inc/encoder.h"
 #include "../Inc/rcc.h"
+#include <stddef.h>
+
+#define ENCODER_TIMER_COUNT     6
+
+/**
+ * @brief Timer with encoder mode and the vector of its update interrupt
+ */
+typedef struct {
+    TIM_TypeDef *TIMx;
+    IRQn_Type IRQn;             // Update vector
+    IRQn_Type CcIRQn;           // Capture/compare vector, for the index
+    uint8_t Wide;
+} Encoder_TimerTypeDef;
+
+static const Encoder_TimerTypeDef encoder_timers[ENCODER_TIMER_COUNT] = {
+    { TIM1, TIM1_UP_TIM10_IRQn, TIM1_CC_IRQn, 0 },
+    { TIM2, TIM2_IRQn,          TIM2_IRQn,    1 },
+    { TIM3, TIM3_IRQn,          TIM3_IRQn,    0 },
+    { TIM4, TIM4_IRQn,          TIM4_IRQn,    0 },
+    { TIM5, TIM5_IRQn,          TIM5_IRQn,    1 },
+    { TIM8, TIM8_UP_TIM13_IRQn, TIM8_CC_IRQn, 0 },
+};
+
+static Encoder_HandleTypeDef *volatile encoder_slots[ENCODER_TIMER_COUNT];  // Handle per timer, for the IRQ dispatch
+static Encoder_HandleTypeDef *encoder_instances[ENCODER_MAX_INSTANCES];     // Registered handles, packed
+static uint8_t encoder_instance_count = 0;
+
+/**
+ * @brief Find the encoder_timers entry of a timer
+ * 
+ * @return int8_t Entry index, -1 if the timer has no encoder mode
+ */
+static int8_t encoder_find_timer(TIM_TypeDef *TIMx)
+{
+    for (int8_t i = 0; i < ENCODER_TIMER_COUNT; i++) {
+        if (encoder_timers[i].TIMx == TIMx) return i;
+    }
+    
+    return -1;
+}
+
+/**
+ * @brief Register a handle on a timer
+ * 
+ * @details The handle and whatever was registered on the timer before are taken
+ * out of the list, then the handle is appended. The list is only changed once
+ * it is known to fit.
+ */
+static uint8_t encoder_register(Encoder_HandleTypeDef *handle, uint8_t slot)
+{
+    Encoder_HandleTypeDef *previous = encoder_slots[slot];
+    uint8_t kept = 0;
+    
+    for (uint8_t i = 0; i < encoder_instance_count; i++) {
+        if (encoder_instances[i] != handle && encoder_instances[i] != previous) kept++;
+    }
+    if (kept >= ENCODER_MAX_INSTANCES) return 1;
+    
+    kept = 0;
+    for (uint8_t i = 0; i < encoder_instance_count; i++) {
+        if (encoder_instances[i] != handle && encoder_instances[i] != previous) {
+            encoder_instances[kept++] = encoder_instances[i];
+        }
+    }
+    encoder_instances[kept++] = handle;
+    encoder_instance_count = kept;
+    
+    // A handle moved to another timer no longer receives the old timer's interrupt
+    for (uint8_t i = 0; i < ENCODER_TIMER_COUNT; i++) {
+        if (encoder_slots[i] == handle) encoder_slots[i] = NULL;
+    }
+    encoder_slots[slot] = handle;
+    
+    return 0;
+}
+
+/**
+ * @brief Route timed encoder edges to a free-running timestamp timer
+ * 
+ * @details Every TI1 capture of the encoder timer (rising A edges after the
+ * polarity setting) pulses TRGO in compare-pulse mode. The timestamp timer
+ * captures its own counter on that trigger through IC1 mapped on TRC. The
+ * encoder CCR1 and the timestamp CCR1 then hold count and time of the same edge,
+ * without any interrupt.
+ */
+static void encoder_timestamp_init(Encoder_HandleTypeDef *handle, uint8_t itr)
+{
+    TIM_TypeDef *ts = handle->TimestampTIMx;
+    
+    // Encoder timer: TRGO pulses on every CC1 capture (MMS = 011)
+    handle->TIMx->CR2 = (handle->TIMx->CR2 & ~TIM_CR2_MMS) | TIM_CR2_MMS_1 | TIM_CR2_MMS_0;
+    
+    // Timestamp timer: free-running at the full timer clock, 32-bit on TIM2/TIM5
+    ts->CR1 &= ~TIM_CR1_CEN;
+    ts->PSC = 0;
+    ts->ARR = 0xFFFFFFFF;
+    ts->SMCR = ((uint32_t)(itr & 0x3) << TIM_SMCR_TS_Pos);    // TS = ITRx, slave mode disabled
+    ts->CCER &= ~TIM_CCER_CC1E;
+    ts->CCMR1 = (ts->CCMR1 & ~(TIM_CCMR1_CC1S | TIM_CCMR1_IC1F | TIM_CCMR1_IC1PSC)) | TIM_CCMR1_CC1S;  // CC1S = 11 (TRC)
+    ts->CCER = (ts->CCER & ~(TIM_CCER_CC1P | TIM_CCER_CC1NP)) | TIM_CCER_CC1E;
+    ts->EGR = TIM_EGR_UG;
+    ts->CR1 |= TIM_CR1_CEN;
+    
+    handle->TimestampFreq = tim_get_clock_freq(ts);
+}
+
+/**
+ * @brief Read count and timestamp of the last timed edge as one pair
+ * 
+ * @details The two capture registers are separate reads. Reading the count again
+ * detects an edge between them, in which case the pair is read once more.
+ */
+static void encoder_read_edge(Encoder_HandleTypeDef *handle, uint32_t *count, uint32_t *time)
+{
+    uint32_t check;
+    
+    do {
+        *count = handle->TIMx->CCR1;
+        *time = handle->TimestampTIMx->CCR1;
+        check = handle->TIMx->CCR1;
+    } while (check != *count);
+}
+
+/**
+ * @brief Signed count difference with counter wrap-around
+ * 
+ * @details Exact modulo 2^32 on 32-bit timers. On 16-bit timers the two values
+ * must be less than half a counter range apart.
+ */
+static int32_t encoder_count_diff(Encoder_HandleTypeDef *handle, uint32_t now, uint32_t before)
+{
+    int32_t max_count = (int32_t)handle->TIMx->ARR + 1;
+    int32_t diff;
+    
+    if (handle->Wide) {
+        return (int32_t)(now - before);
+    }
+    
+    diff = (int32_t)now - (int32_t)before;
+    
+    if (diff > max_count / 2) {
+        diff -= max_count;
+    } else if (diff < -max_count / 2) {
+        diff += max_count;
+    }
+    
+    return diff;
+}
+
+/**
+ * @brief Count a wrap of a 16-bit counter if one is pending
+ */
+static void encoder_count_wrap(Encoder_HandleTypeDef *handle)
+{
+    if (handle->TIMx->SR & TIM_SR_UIF) {
+        handle->TIMx->SR = (uint32_t)~TIM_SR_UIF;  // Clear update interrupt flag (rc_w0)
+        
+        // Determine direction, encoder_update() folds the wraps into TotalCount
+        if (handle->TIMx->CR1 & TIM_CR1_DIR) {
+            // Counting down (underflow occurred)
+            handle->WrapCount--;
+        } else {
+            // Counting up (overflow occurred)
+            handle->WrapCount++;
+        }
+    }
+}
+
+/**
+ * @brief Read the unwrapped count, before the homing offset
+ * 
+ * @details Wrap count and counter as one pair: retry if a wrap was counted in
+ * between. A wrap whose interrupt has not run yet, because it is still on its
+ * way or the caller blocks it, is folded in from the pending flag, with the
+ * same direction rule as encoder_count_wrap(). The flag is only read, so the
+ * interrupt still counts the wrap itself. A flag that changes across the
+ * counter read means a wrap in between, and the pair is read again.
+ */
+static int32_t encoder_read_raw(Encoder_HandleTypeDef *handle)
+{
+    int32_t wraps;
+    uint32_t pending;
+    uint32_t count;
+    
+    if (handle->Wide) {
+        // 32-bit counter: the hardware count is the total count
+        return (int32_t)handle->TIMx->CNT;
+    }
+    
+    do {
+        wraps = handle->WrapCount;
+        pending = handle->TIMx->SR & TIM_SR_UIF;
+        count = handle->TIMx->CNT;
+    } while (wraps != handle->WrapCount || pending != (handle->TIMx->SR & TIM_SR_UIF));
+    
+    if (pending) {
+        wraps += (handle->TIMx->CR1 & TIM_CR1_DIR) ? -1 : 1;
+    }
+    
+    return wraps * (int32_t)(handle->TIMx->ARR + 1) + (int32_t)count;
+}
+
+/**
+ * @brief Make a latched homing index the origin of the published counts
+ * 
+ * @details Runs in the caller's context, so the speed reference moves together
+ * with the offset and the next speed sample does not see a jump.
+ */
+static void encoder_apply_home(Encoder_HandleTypeDef *handle)
+{
+    int32_t shift;
+    
+    if (handle->HomeState != ENCODER_HOME_LATCHED) return;
+    
+    shift = handle->HomeRaw - handle->HomeOffset;
+    handle->HomeOffset = handle->HomeRaw;
+    handle->LastCount -= shift;
+    handle->HomeState = ENCODER_HOME_DONE;
+}
+
+/**
+ * @brief Process one index capture
+ * 
+ * @details The spacing to the previous index is rounded to whole revolutions.
+ * A spacing below half a revolution is the same index crossed again after a
+ * reversal. Whatever is left over beyond the gating jitter is counts that were
+ * lost or picked up as noise, and a spacing of several revolutions means index
+ * pulses were missed.
+ */
+static void encoder_index_capture(Encoder_HandleTypeDef *handle, int32_t raw)
+{
+    int32_t cpr = handle->CountsPerRevolution;
+    
+    if (handle->IndexPulses != 0 && cpr > 0) {
+        int32_t spacing = raw - handle->IndexRaw;
+        int32_t turns = (spacing >= 0) ? (spacing + cpr / 2) / cpr : -((cpr / 2 - spacing) / cpr);
+        int32_t deviation = spacing - turns * cpr;
+        
+        handle->Revolutions += turns;
+        if (turns != 0) {
+            handle->IndexDeviation = deviation;
+        }
+        if (turns > 1 || turns < -1 ||
+            deviation > ENCODER_INDEX_TOLERANCE || deviation < -ENCODER_INDEX_TOLERANCE) {
+            handle->IndexErrors++;
+        }
+    }
+    
+    handle->IndexRaw = raw;
+    handle->IndexPulses++;
+    
+    if (handle->HomeState == ENCODER_HOME_ARMED) {
+        handle->HomeRaw = raw;
+        handle->Revolutions = 0;
+        handle->HomeState = ENCODER_HOME_LATCHED;
+    }
+}
+
+/**
+ * @brief Route the Z input to a capture channel of the encoder timer
+ * 
+ * @details The channel captures CNT on the Z edge, so the index position does
+ * not depend on interrupt latency.
+ */
+static void encoder_index_init(Encoder_HandleTypeDef *handle, uint8_t polarity)
+{
+    TIM_TypeDef *tim = handle->TIMx;
+    
+    if (handle->IndexChannel == ENCODER_INDEX_CH3) {
+        tim->CCER &= ~(TIM_CCER_CC3E | TIM_CCER_CC3P | TIM_CCER_CC3NP);
+        tim->CCMR2 = (tim->CCMR2 & ~(TIM_CCMR2_CC3S | TIM_CCMR2_IC3F | TIM_CCMR2_IC3PSC)) |
+                     TIM_CCMR2_CC3S_0 | (0x3 << TIM_CCMR2_IC3F_Pos);    // CC3S = 01 (TI3), IC3F = 0011
+        if (polarity == ENCODER_IC_POLARITY_FALLING) {
+            tim->CCER |= TIM_CCER_CC3P;
+        }
+        tim->CCER |= TIM_CCER_CC3E;
+        tim->SR = (uint32_t)~(TIM_SR_CC3IF | TIM_SR_CC3OF);
+        tim->DIER |= TIM_DIER_CC3IE;
+    } else {
+        tim->CCER &= ~(TIM_CCER_CC4E | TIM_CCER_CC4P | TIM_CCER_CC4NP);
+        tim->CCMR2 = (tim->CCMR2 & ~(TIM_CCMR2_CC4S | TIM_CCMR2_IC4F | TIM_CCMR2_IC4PSC)) |
+                     TIM_CCMR2_CC4S_0 | (0x3 << TIM_CCMR2_IC4F_Pos);    // CC4S = 01 (TI4), IC4F = 0011
+        if (polarity == ENCODER_IC_POLARITY_FALLING) {
+            tim->CCER |= TIM_CCER_CC4P;
+        }
+        tim->CCER |= TIM_CCER_CC4E;
+        tim->SR = (uint32_t)~(TIM_SR_CC4IF | TIM_SR_CC4OF);
+        tim->DIER |= TIM_DIER_CC4IE;
+    }
+}
+
+/**
+ * @brief M/T speed from the last timed edges
+ * 
+ * @details Counts between the last timed edge of this call and that of the
+ * previous call, divided by the exact ticks between the two edges. Without a
+ * new edge the speed can be at most one edge spacing over the time waited so
+ * far, which bounds the decay towards standstill.
+ */
+static void encoder_speed_mt(Encoder_HandleTypeDef *handle)
+{
+    uint32_t edge_count;
+    uint32_t edge_time;
+    int64_t scale = 60000LL * handle->TimestampFreq;    // mRPM * CPR per count per tick
+    
+    encoder_read_edge(handle, &edge_count, &edge_time);
+    
+    if (edge_time != handle->LastEdgeTime) {
+        int32_t counts = encoder_count_diff(handle, edge_count, handle->LastEdgeCount);
+        uint32_t ticks = edge_time - handle->LastEdgeTime;
+        
+        handle->SpeedMilliRpm = (int32_t)((int64_t)counts * scale /
+                                          ((int64_t)handle->CountsPerRevolution * ticks));
+        handle->LastEdgeCount = edge_count;
+        handle->LastEdgeTime = edge_time;
+    } else {
+        uint32_t idle = handle->TimestampTIMx->CNT - edge_time;
+        
+        if (idle / (handle->TimestampFreq / 1000) >= ENCODER_MT_TIMEOUT_MS) {
+            handle->SpeedMilliRpm = 0;
+        } else if (idle > 0) {
+            int64_t bound = ENCODER_MT_COUNTS_PER_EDGE * scale /
+                            ((int64_t)handle->CountsPerRevolution * idle);
+            
+            if (handle->SpeedMilliRpm > bound) {
+                handle->SpeedMilliRpm = (int32_t)bound;
+            } else if (handle->SpeedMilliRpm < -bound) {
+                handle->SpeedMilliRpm = (int32_t)-bound;
+            }
+        }
+    }
+}
 
 /**
  * @brief Initialize encoder using hardware encoder mode
@@ -19,20 +351,45 @@
  */
 uint8_t encoder_init(Encoder_HandleTypeDef *handle, Encoder_InitTypeDef *init)
 {
-    if (!handle || !init || !init->TIMx) {
+    int8_t slot;
+    
+    if (!handle || !init || !init->TIMx || init->IndexChannel == 1 || init->IndexChannel == 2 ||
+        init->IndexChannel > ENCODER_INDEX_CH4) {
         return 1; // Invalid parameters
     }
     
+    slot = encoder_find_timer(init->TIMx);
+    if (slot < 0 || encoder_register(handle, (uint8_t)slot)) {
+        return 1; // No encoder mode on this timer, or registry full
+    }
+    
     // Initialize handle structure
     handle->TIMx = init->TIMx;
     handle->CountsPerRevolution = init->CountsPerRevolution;
     handle->TotalCount = 0;
     handle->LastCount = 0;
-    handle->LastHwCount = 0;
+    handle->WrapCount = 0;
+    handle->Wide = encoder_timers[slot].Wide;
     handle->Speed = 0;
     handle->LastTimeMs = 0;
     handle->LastPhaseA = 0;
     handle->LastPhaseB = 0;
+    handle->TimestampTIMx = init->TimestampTIMx;
+    handle->TimestampFreq = 0;
+    handle->LastEdgeCount = 0;
+    handle->LastEdgeTime = 0;
+    handle->SpeedMilliRpm = 0;
+    handle->IndexChannel = init->IndexChannel;
+    handle->HomeOffset = 0;
+    handle->HomeState = ENCODER_HOME_IDLE;
+    handle->HomeRaw = 0;
+    handle->IndexRaw = 0;
+    handle->IndexPulses = 0;
+    handle->Revolutions = 0;
+    handle->IndexDeviation = 0;
+    handle->IndexErrors = 0;
+    handle->EdgeDMAx = NULL;
+    handle->EdgeOverruns = 0;
     
     // Temporarily disable timer
     init->TIMx->CR1 &= ~TIM_CR1_CEN;
@@ -65,35 +422,34 @@ uint8_t encoder_init(Encoder_HandleTypeDef *handle, Encoder_InitTypeDef *init)
     init->TIMx->SMCR &= ~TIM_SMCR_SMS;  // Clear SMS
     init->TIMx->SMCR |= TIM_SMCR_SMS_1 | TIM_SMCR_SMS_0;  // SMS = 011 (Encoder mode 3)
     
-    // Set auto-reload value
-    init->TIMx->ARR = init->MaxCount - 1;
+    // Set auto-reload value: full range on 32-bit timers, TotalCount is then CNT itself
+    init->TIMx->ARR = handle->Wide ? 0xFFFFFFFFU : (uint32_t)(init->MaxCount - 1);
     
     // Reset counter
     init->TIMx->CNT = 0;
     
-    // Enable overflow interrupt for counting beyond 16-bit
-    init->TIMx->DIER |= TIM_DIER_UIE;
-    
-    // Enable the appropriate NVIC interrupt based on the timer
-    if (init->TIMx == TIM1) {
-        NVIC_SetPriority(TIM1_UP_TIM10_IRQn, 1);
-        NVIC_EnableIRQ(TIM1_UP_TIM10_IRQn);
-    } else if (init->TIMx == TIM2) {
-        NVIC_SetPriority(TIM2_IRQn, 1);
-        NVIC_EnableIRQ(TIM2_IRQn);
-    } else if (init->TIMx == TIM3) {
-        NVIC_SetPriority(TIM3_IRQn, 1);
-        NVIC_EnableIRQ(TIM3_IRQn);
-    } else if (init->TIMx == TIM4) {
-        NVIC_SetPriority(TIM4_IRQn, 1);
-        NVIC_EnableIRQ(TIM4_IRQn);
-    } else if (init->TIMx == TIM5) {
-        NVIC_SetPriority(TIM5_IRQn, 1);
-        NVIC_EnableIRQ(TIM5_IRQn);
-    }
-    
-    // Generate update event to load configuration
+    // Generate update event to load configuration, its flag is not a wrap
     init->TIMx->EGR = TIM_EGR_UG;
+    init->TIMx->SR = (uint32_t)~TIM_SR_UIF;
+    
+    if (!handle->Wide) {
+        // Enable overflow interrupt for counting beyond 16-bit
+        init->TIMx->DIER |= TIM_DIER_UIE;
+        
+        // Enable the update vector of this timer
+        NVIC_SetPriority(encoder_timers[slot].IRQn, 1);
+        NVIC_EnableIRQ(encoder_timers[slot].IRQn);
+    }
+    
+    if (init->TimestampTIMx) {
+        encoder_timestamp_init(handle, init->TimestampITR);
+    }
+    
+    if (init->IndexChannel != ENCODER_INDEX_NONE) {
+        encoder_index_init(handle, init->IndexPolarity);
+        NVIC_SetPriority(encoder_timers[slot].CcIRQn, 1);
+        NVIC_EnableIRQ(encoder_timers[slot].CcIRQn);
+    }
     
     return 0; // Success
 }
@@ -137,11 +493,11 @@ void encoder_stop(Encoder_HandleTypeDef *handle)
 /**
  * @brief Get current encoder count
  */
-uint16_t encoder_get_count(Encoder_HandleTypeDef *handle)
+uint32_t encoder_get_count(Encoder_HandleTypeDef *handle)
 {
     if (!handle || !handle->TIMx) return 0;
     
-    return (uint16_t)handle->TIMx->CNT;
+    return handle->TIMx->CNT;
 }
 
 /**
@@ -152,9 +508,13 @@ void encoder_reset_count(Encoder_HandleTypeDef *handle)
     if (!handle || !handle->TIMx) return;
     
     handle->TIMx->CNT = 0;
+    handle->WrapCount = 0;
     handle->TotalCount = 0;
     handle->LastCount = 0;
-    handle->LastHwCount = 0;
+    handle->HomeOffset = 0;
+    handle->HomeState = ENCODER_HOME_IDLE;
+    handle->IndexPulses = 0;
+    handle->Revolutions = 0;
 }
 
 /**
@@ -175,29 +535,105 @@ int8_t encoder_get_direction(Encoder_HandleTypeDef *handle)
 }
 
 /**
- * @brief Update encoder total count with overflow handling
+ * @brief Update encoder total count
  */
 void encoder_update(Encoder_HandleTypeDef *handle)
 {
     if (!handle || !handle->TIMx) return;
     
-    uint16_t current_count = encoder_get_count(handle);
-    int16_t count_diff = (int16_t)(current_count - handle->LastHwCount);
+    encoder_apply_home(handle);
+    handle->TotalCount = encoder_read_raw(handle) - handle->HomeOffset;
+}
+
+/**
+ * @brief Zero the count on the next index pulse
+ */
+uint8_t encoder_home_start(Encoder_HandleTypeDef *handle)
+{
+    if (!handle || handle->IndexChannel == ENCODER_INDEX_NONE) return 1;
     
-    // Handle counter overflow/underflow
-    uint16_t max_count = handle->TIMx->ARR + 1;
-    int16_t half_max = (int16_t)(max_count / 2);
+    handle->HomeState = ENCODER_HOME_ARMED;
+    return 0;
+}
+
+/**
+ * @brief Check whether the count is referenced to the index
+ */
+uint8_t encoder_is_homed(Encoder_HandleTypeDef *handle)
+{
+    if (!handle) return 0;
+    
+    return (handle->HomeState == ENCODER_HOME_DONE) ? 1 : 0;
+}
+
+/**
+ * @brief Get the absolute shaft angle
+ * 
+ * @details The index raw count is read on both sides of the counter, so an
+ * index interrupt in between is noticed and the pair read again.
+ */
+uint8_t encoder_get_angle(Encoder_HandleTypeDef *handle, uint16_t *angle)
+{
+    int32_t index;
+    int32_t raw;
+    int32_t cpr;
     
-    if (count_diff > half_max) {
-        // Counter underflowed (wrapped from 0 to max)
-        count_diff -= (int16_t)max_count;
-    } else if (count_diff < -half_max) {
-        // Counter overflowed (wrapped from max to 0)
-        count_diff += (int16_t)max_count;
+    if (!handle || !angle || !handle->TIMx || handle->CountsPerRevolution == 0 ||
+        handle->IndexPulses == 0) {
+        return 0;
     }
     
-    handle->TotalCount += count_diff;
-    handle->LastHwCount = current_count;  // Update hardware count tracker
+    cpr = handle->CountsPerRevolution;
+    do {
+        index = handle->IndexRaw;
+        raw = encoder_read_raw(handle);
+    } while (index != handle->IndexRaw);
+    
+    raw = (raw - index) % cpr;
+    *angle = (uint16_t)((raw < 0) ? raw + cpr : raw);
+    
+    return 1;
+}
+
+/**
+ * @brief Update the total count of every registered encoder
+ * 
+ * @details The first pass only reads the hardware, one wrap/counter pair per
+ * axis, the second pass applies the homing offsets.
+ */
+void encoder_update_all(void)
+{
+    int32_t raw[ENCODER_MAX_INSTANCES];
+    uint8_t n = encoder_instance_count;
+    
+    for (uint8_t i = 0; i < n; i++) {
+        raw[i] = encoder_read_raw(encoder_instances[i]);
+    }
+    
+    for (uint8_t i = 0; i < n; i++) {
+        Encoder_HandleTypeDef *handle = encoder_instances[i];
+        
+        encoder_apply_home(handle);
+        handle->TotalCount = raw[i] - handle->HomeOffset;
+    }
+}
+
+/**
+ * @brief Get a registered encoder
+ */
+Encoder_HandleTypeDef *encoder_get_instance(uint8_t index)
+{
+    if (index >= encoder_instance_count) return NULL;
+    
+    return encoder_instances[index];
+}
+
+/**
+ * @brief Get the number of registered encoders
+ */
+uint8_t encoder_get_instance_count(void)
+{
+    return encoder_instance_count;
 }
 
 /**
@@ -210,13 +646,35 @@ int32_t encoder_calculate_speed_rpm(Encoder_HandleTypeDef *handle, uint32_t curr
     // Update total count from hardware counter
     encoder_update(handle);
     
+    return encoder_calculate_speed_latched(handle, current_time_ms);
+}
+
+/**
+ * @brief Calculate speed in RPM from the TotalCount already latched
+ */
+int32_t encoder_calculate_speed_latched(Encoder_HandleTypeDef *handle, uint32_t current_time_ms)
+{
+    if (!handle || handle->CountsPerRevolution == 0) return 0;
+    
     // Initialize LastTimeMs on first call to avoid invalid time difference
     if (handle->LastTimeMs == 0) {
         handle->LastTimeMs = current_time_ms;
         handle->LastCount = handle->TotalCount;
+        if (handle->TimestampTIMx) {
+            encoder_read_edge(handle, &handle->LastEdgeCount, &handle->LastEdgeTime);
+        }
         return 0; // Return 0 on first call since we need time difference
     }
     
+    if (handle->TimestampTIMx) {
+        // M/T mode: exact edge-to-edge time instead of the call interval
+        encoder_speed_mt(handle);
+        handle->Speed = handle->SpeedMilliRpm / 1000;
+        handle->LastCount = handle->TotalCount;
+        handle->LastTimeMs = current_time_ms;
+        return handle->Speed;
+    }
+    
     // Calculate time difference
     uint32_t time_diff_ms = current_time_ms - handle->LastTimeMs;
     
@@ -228,8 +686,9 @@ int32_t encoder_calculate_speed_rpm(Encoder_HandleTypeDef *handle, uint32_t curr
     int32_t count_diff = handle->TotalCount - handle->LastCount;
     
     // Calculate RPM: (count_diff / CPR) * (60000 ms/min / time_diff_ms)
-    handle->Speed = (int32_t)((int64_t)count_diff * 60000L / 
-                              ((int64_t)handle->CountsPerRevolution * time_diff_ms));
+    handle->SpeedMilliRpm = (int32_t)((int64_t)count_diff * 60000000LL / 
+                                      ((int64_t)handle->CountsPerRevolution * time_diff_ms));
+    handle->Speed = handle->SpeedMilliRpm / 1000;
     
     // Update for next calculation
     handle->LastCount = handle->TotalCount;
@@ -239,27 +698,307 @@ int32_t encoder_calculate_speed_rpm(Encoder_HandleTypeDef *handle, uint32_t curr
 }
 
 /**
- * @brief Generic timer IRQ handler for encoder overflow/underflow
+ * @brief Get the speed of the last calculation with sub-RPM resolution
+ */
+int32_t encoder_get_speed_mrpm(Encoder_HandleTypeDef *handle)
+{
+    if (!handle) return 0;
+    
+    return handle->SpeedMilliRpm;
+}
+
+/**
+ * @brief Stream the timestamp of every timed edge into a ring by DMA
+ * 
+ * @details The CC1 capture of the timestamp timer sets its DMA request, and the
+ * DMA reading CCR1 clears it again, so no interrupt is involved. M/T mode keeps
+ * reading the same CCR1.
+ */
+uint8_t encoder_edge_start(Encoder_HandleTypeDef *handle, DMA_TypeDef *DMAx, uint32_t stream,
+                           uint32_t channel, volatile uint32_t *buffer, uint16_t length)
+{
+    DMA_InitTypeDef dma_config;
+    
+    if (!handle || !handle->TimestampTIMx || !DMAx || !buffer || length < 2) return 1;
+    
+    dma_config.Channel = channel;
+    dma_config.Direction = DMA_PERIPH_TO_MEMORY;
+    dma_config.PeriphInc = DMA_PINC_DISABLE;
+    dma_config.MemInc = DMA_MINC_ENABLE;
+    dma_config.PeriphDataAlign = DMA_PDATAALIGN_WORD;       // 32-bit timestamps
+    dma_config.MemDataAlign = DMA_MDATAALIGN_WORD;
+    dma_config.Mode = DMA_CIRCULAR;                         // Ring, the reader follows NDTR
+    dma_config.Priority = DMA_PRIORITY_MEDIUM;
+    dma_config.FIFOMode = DMA_FIFOMODE_DISABLE;             // Each timestamp lands in memory at once
+    dma_config.FIFOThreshold = 0;
+    dma_config.MemBurst = DMA_MBURST_SINGLE;
+    dma_config.PeriphBurst = DMA_PBURST_SINGLE;
+    
+    handle->TimestampTIMx->DIER &= ~TIM_DIER_CC1DE;
+    dma_init(DMAx, stream, &dma_config);
+    dma_config_transfer(DMAx, stream, (uint32_t)&handle->TimestampTIMx->CCR1, (uint32_t)buffer, length);
+    
+    handle->EdgeDMAx = DMAx;
+    handle->EdgeStream = stream;
+    handle->EdgeBuffer = buffer;
+    handle->EdgeLength = length;
+    handle->EdgeRead = 0;
+    handle->EdgeValid = 0;
+    handle->EdgeLastTime = 0;
+    
+    dma_enable(DMAx, stream);
+    handle->TimestampTIMx->DIER |= TIM_DIER_CC1DE;
+    
+    return 0;
+}
+
+/**
+ * @brief Take new edges out of the ring as instantaneous speeds
+ * 
+ * @details The write position is length - NDTR. A lap is detected on the entry
+ * consumed last: the DMA only changes it after writing a whole ring since, and
+ * a newer timestamp never equals the old one.
+ */
+uint16_t encoder_edge_read(Encoder_HandleTypeDef *handle, Encoder_EdgeTypeDef *edges, uint16_t max)
+{
+    uint16_t write;
+    uint16_t last;
+    uint16_t n = 0;
+    int64_t scale;
+    int8_t direction;
+    
+    if (!handle || !handle->EdgeDMAx || !edges || handle->CountsPerRevolution == 0) return 0;
+    
+    write = (uint16_t)(handle->EdgeLength - dma_get_counter(handle->EdgeDMAx, handle->EdgeStream));
+    if (write >= handle->EdgeLength) write = 0;
+    
+    last = (handle->EdgeRead == 0) ? (uint16_t)(handle->EdgeLength - 1) : (uint16_t)(handle->EdgeRead - 1);
+    if (handle->EdgeValid && handle->EdgeBuffer[last] != handle->EdgeLastTime) {
+        handle->EdgeOverruns++;
+        handle->EdgeRead = write;
+        last = (write == 0) ? (uint16_t)(handle->EdgeLength - 1) : (uint16_t)(write - 1);
+        handle->EdgeLastTime = handle->EdgeBuffer[last];
+    }
+    
+    // mRPM * ticks per edge; the sign follows the counting direction at read time
+    scale = (int64_t)ENCODER_MT_COUNTS_PER_EDGE * 60000LL * handle->TimestampFreq /
+            handle->CountsPerRevolution;
+    direction = encoder_get_direction(handle);
+    
+    while (handle->EdgeRead != write && n < max) {
+        uint32_t time = handle->EdgeBuffer[handle->EdgeRead];
+        
+        if (++handle->EdgeRead >= handle->EdgeLength) handle->EdgeRead = 0;
+        
+        if (handle->EdgeValid) {
+            uint32_t interval = time - handle->EdgeLastTime;
+            
+            edges[n].Time = time;
+            edges[n].Interval = interval;
+            edges[n].SpeedMilliRpm = (interval != 0) ? (int32_t)(direction * scale / interval) : 0;
+            n++;
+        }
+        handle->EdgeLastTime = time;
+        handle->EdgeValid = 1;
+    }
+    
+    return n;
+}
+
+/**
+ * @brief Start the angle-tracking observer
+ * 
+ * @details With x = w * T, the triple pole at -w gives the per-update gains
+ * 3x, 3x^2 and x^3 on the position error. Velocity and acceleration are kept
+ * per update, so the update needs no multiply by T.
+ */
+uint8_t encoder_observer_init(Encoder_HandleTypeDef *handle, uint32_t rate_hz, uint32_t bandwidth_hz)
+{
+    float x;
+    
+    if (!handle || !handle->TIMx || handle->CountsPerRevolution == 0 ||
+        rate_hz == 0 || bandwidth_hz == 0 || bandwidth_hz * 20 > rate_hz) {
+        return 1;
+    }
+    
+    x = 6.2831853f * (float)bandwidth_hz / (float)rate_hz;
+    handle->ObsGain[0] = (uint32_t)(3.0f * x * 4294967296.0f);
+    handle->ObsGain[1] = (uint32_t)(3.0f * x * x * 4294967296.0f);
+    handle->ObsGain[2] = (uint32_t)(x * x * x * 4294967296.0f);
+    
+    // counts/update -> mRPM and counts/update^2 -> RPM/s
+    handle->ObsSpeedScale = (uint32_t)(((uint64_t)rate_hz * 60000 + handle->CountsPerRevolution / 2) /
+                                       handle->CountsPerRevolution);
+    handle->ObsAccelScale = (uint32_t)(((uint64_t)rate_hz * rate_hz * 60 + handle->CountsPerRevolution / 2) /
+                                       handle->CountsPerRevolution);
+    
+    encoder_update(handle);
+    handle->ObsLastHwCount = encoder_get_count(handle);
+    handle->ObsCount = handle->TotalCount + handle->HomeOffset;
+    handle->ObsPosition = (int64_t)handle->ObsCount << 32;
+    handle->ObsVelocity = 0;
+    handle->ObsAccel = 0;
+    handle->SnapshotSequence = 0;
+    handle->Snapshot.Updates = 0;
+    handle->Snapshot.Timestamp = 0;
+    handle->Snapshot.Count = handle->TotalCount;
+    handle->Snapshot.Position = handle->TotalCount;
+    handle->Snapshot.SpeedMilliRpm = 0;
+    handle->Snapshot.AccelRpmPerS = 0;
+    
+    return 0;
+}
+
+/**
+ * @brief Advance the observer by one update period
+ * 
+ * @details Error e in Q16 counts times a Q32 gain gives a Q48 product, and
+ * >> 16 brings it to the Q32 state. The observer runs on the raw count, and the
+ * homing offset is only applied to the published counts. The estimates are
+ * published after the state, between two increments of the sequence counter.
+ */
+void encoder_observer_update(Encoder_HandleTypeDef *handle)
+{
+    uint32_t hw_count;
+    int64_t error;
+    int32_t error_q16;
+    int32_t offset;
+    
+    if (!handle || !handle->TIMx || handle->ObsSpeedScale == 0) return;
+    
+    hw_count = encoder_get_count(handle);
+    handle->ObsCount += encoder_count_diff(handle, hw_count, handle->ObsLastHwCount);
+    handle->ObsLastHwCount = hw_count;
+    
+    // Predict one update ahead
+    handle->ObsPosition += handle->ObsVelocity;
+    handle->ObsVelocity += handle->ObsAccel;
+    
+    // Tracking error, clamped so a jump does not overflow the Q16 error
+    error = (((int64_t)handle->ObsCount << 32) - handle->ObsPosition) >> 16;
+    if (error > ((int64_t)ENCODER_OBS_MAX_ERROR << 16)) error = (int64_t)ENCODER_OBS_MAX_ERROR << 16;
+    if (error < -((int64_t)ENCODER_OBS_MAX_ERROR << 16)) error = -((int64_t)ENCODER_OBS_MAX_ERROR << 16);
+    error_q16 = (int32_t)error;
+    
+    // Correct with the measured count
+    handle->ObsPosition += ((int64_t)error_q16 * handle->ObsGain[0]) >> 16;
+    handle->ObsVelocity += ((int64_t)error_q16 * handle->ObsGain[1]) >> 16;
+    handle->ObsAccel += ((int64_t)error_q16 * handle->ObsGain[2]) >> 16;
+    
+    // Odd sequence while the snapshot is inconsistent
+    offset = handle->HomeOffset;
+    handle->SnapshotSequence++;
+    __DMB();
+    handle->Snapshot.Updates++;
+    handle->Snapshot.Timestamp = handle->TimestampTIMx ? handle->TimestampTIMx->CNT : 0;
+    handle->Snapshot.Count = handle->ObsCount - offset;
+    handle->Snapshot.Position = (int32_t)(handle->ObsPosition >> 32) - offset;
+    handle->Snapshot.SpeedMilliRpm = (int32_t)(((handle->ObsVelocity >> 12) * handle->ObsSpeedScale) >> 20);
+    handle->Snapshot.AccelRpmPerS = (int32_t)(((handle->ObsAccel >> 12) * handle->ObsAccelScale) >> 20);
+    __DMB();
+    handle->SnapshotSequence++;
+}
+
+/**
+ * @brief Advance the observer of every registered encoder
+ */
+void encoder_observer_update_all(void)
+{
+    for (uint8_t i = 0; i < encoder_instance_count; i++) {
+        encoder_observer_update(encoder_instances[i]);
+    }
+}
+
+/**
+ * @brief Copy the latest observer state as one consistent tuple
  * 
- * @details This function should be called from the appropriate timer IRQ handler
+ * @details An odd sequence can only be seen by a context that interrupted the
+ * update, which cannot wait for it to finish, so that case returns at once.
+ */
+uint8_t encoder_get_snapshot(Encoder_HandleTypeDef *handle, Encoder_SnapshotTypeDef *snapshot)
+{
+    uint32_t sequence;
+    
+    if (!handle || !snapshot) return 0;
+    
+    do {
+        sequence = handle->SnapshotSequence;
+        if (sequence & 1U) return 0;
+        __DMB();
+        *snapshot = handle->Snapshot;
+        __DMB();
+    } while (sequence != handle->SnapshotSequence);
+    
+    return 1;
+}
+
+/**
+ * @brief Generic timer IRQ handler for encoder overflow/underflow and index
+ * 
+ * @details This function should be called from the appropriate timer IRQ handler.
+ * On 16-bit timers the captured index is placed relative to the live counter,
+ * whose wraps are all counted first, so a wrap next to the index is not lost.
  * 
  * @param handle Pointer to encoder handle structure
  */
 void encoder_timer_irq_handler(Encoder_HandleTypeDef *handle)
 {
+    uint32_t flag;
+    uint32_t overcapture;
+    volatile uint32_t *ccr;
+    
     if (!handle || !handle->TIMx) return;
     
     // Handle timer overflow/underflow interrupt
-    if (handle->TIMx->SR & TIM_SR_UIF) {
-        handle->TIMx->SR &= ~TIM_SR_UIF;  // Clear update interrupt flag
+    encoder_count_wrap(handle);
+    
+    if (handle->IndexChannel == ENCODER_INDEX_NONE) return;
+    
+    if (handle->IndexChannel == ENCODER_INDEX_CH3) {
+        flag = TIM_SR_CC3IF;
+        overcapture = TIM_SR_CC3OF;
+        ccr = &handle->TIMx->CCR3;
+    } else {
+        flag = TIM_SR_CC4IF;
+        overcapture = TIM_SR_CC4OF;
+        ccr = &handle->TIMx->CCR4;
+    }
+    
+    if (handle->TIMx->SR & flag) {
+        uint32_t capture = *ccr;    // Reading CCRx clears CCxIF
+        int32_t raw;
         
-        // Determine direction and update total count
-        if (handle->TIMx->CR1 & TIM_CR1_DIR) {
-            // Counting down (underflow occurred)
-            handle->TotalCount -= (int32_t)(handle->TIMx->ARR + 1);
+        if (handle->TIMx->SR & overcapture) {
+            handle->TIMx->SR = (uint32_t)~overcapture;
+            handle->IndexErrors++;  // An index pulse was overwritten before it was read
+        }
+        
+        if (handle->Wide) {
+            raw = (int32_t)capture;
         } else {
-            // Counting up (overflow occurred)
-            handle->TotalCount += (int32_t)(handle->TIMx->ARR + 1);
+            uint32_t count;
+            
+            do {
+                encoder_count_wrap(handle);
+                count = handle->TIMx->CNT;
+            } while (handle->TIMx->SR & TIM_SR_UIF);
+            
+            raw = handle->WrapCount * (int32_t)(handle->TIMx->ARR + 1) + (int32_t)count +
+                  encoder_count_diff(handle, capture, count);
         }
+        
+        encoder_index_capture(handle, raw);
     }
 }
+
+/**
+ * @brief Route a timer interrupt to the encoder registered on that timer
+ */
+void encoder_irq_dispatch(TIM_TypeDef *TIMx)
+{
+    int8_t slot = encoder_find_timer(TIMx);
+    
+    if (slot < 0) return;
+    
+    encoder_timer_irq_handler(encoder_slots[slot]);
+}
@@ -0,0 +1,129 @@
+/**
+ * @file flash.c
+ * @author Haoyi Chen
+ * @date 2025-08-30
+ * @brief STM32F4 embedded flash register-level driver
+ *
+ * @details This file provides sector erase and word programming for the embedded
+ * flash of STM32F407 series microcontrollers. All operations are performed at
+ * the register level, without using HAL or LL libraries.
+ *
+ * Created for personal learning and embedded systems experimentation.
+ */
+
+#include "../Inc/flash.h"
+
+#define FLASH_KEY1          0x45670123U
+#define FLASH_KEY2          0xCDEF89ABU
+#define FLASH_SR_ERRORS     (FLASH_SR_OPERR | FLASH_SR_WRPERR | FLASH_SR_PGAERR | \
+                             FLASH_SR_PGPERR | FLASH_SR_PGSERR)
+
+/**
+ * @brief Wait for the end of the current operation
+ * 
+ * @return uint8_t 0 if it completed cleanly, 1 if an error flag was set
+ */
+static uint8_t flash_wait(void) {
+    while (FLASH->SR & FLASH_SR_BSY) { }
+
+    if (FLASH->SR & FLASH_SR_ERRORS) {
+        FLASH->SR = FLASH_SR_ERRORS;    /* rc_w1 */
+        return 1;
+    }
+
+    FLASH->SR = FLASH_SR_EOP;
+    return 0;
+}
+
+/**
+ * @brief Drop stale data cache lines after the array changed
+ */
+static void flash_flush_data_cache(void) {
+    if (FLASH->ACR & FLASH_ACR_DCEN) {
+        FLASH->ACR &= ~FLASH_ACR_DCEN;
+        FLASH->ACR |= FLASH_ACR_DCRST;
+        FLASH->ACR &= ~FLASH_ACR_DCRST;
+        FLASH->ACR |= FLASH_ACR_DCEN;
+    }
+}
+
+/**
+ * @brief Unlock the flash control register
+ * 
+ * @return uint8_t 0 if successful, 1 if the key sequence was rejected
+ */
+uint8_t flash_unlock(void) {
+    if (FLASH->CR & FLASH_CR_LOCK) {
+        FLASH->KEYR = FLASH_KEY1;
+        FLASH->KEYR = FLASH_KEY2;
+    }
+
+    return (FLASH->CR & FLASH_CR_LOCK) ? 1 : 0;
+}
+
+/**
+ * @brief Lock the flash control register
+ */
+void flash_lock(void) {
+    FLASH->CR |= FLASH_CR_LOCK;
+}
+
+/**
+ * @brief Erase one sector
+ * 
+ * @param sector Sector number (0 to FLASH_SECTOR_COUNT - 1)
+ * @return uint8_t 0 if successful, 1 on error
+ */
+uint8_t flash_erase_sector(uint8_t sector) {
+    uint8_t status;
+
+    if (sector >= FLASH_SECTOR_COUNT || (FLASH->CR & FLASH_CR_LOCK)) {
+        return 1;
+    }
+
+    if (flash_wait()) {
+        return 1;
+    }
+
+    FLASH->CR = (FLASH->CR & ~(FLASH_CR_PSIZE | FLASH_CR_SNB)) |
+                FLASH_CR_PSIZE_1 | ((uint32_t)sector << FLASH_CR_SNB_Pos) | FLASH_CR_SER;
+    FLASH->CR |= FLASH_CR_STRT;
+
+    status = flash_wait();
+    FLASH->CR &= ~(FLASH_CR_SER | FLASH_CR_SNB);
+    flash_flush_data_cache();
+
+    return status;
+}
+
+/**
+ * @brief Program words into erased flash
+ * 
+ * @param address Destination, word aligned
+ * @param data Source words
+ * @param count Number of words
+ * @return uint8_t 0 if successful, 1 on error
+ */
+uint8_t flash_program(uint32_t address, const uint32_t *data, uint32_t count) {
+    uint8_t status = 0;
+
+    if (!data || (address & 0x3) || (FLASH->CR & FLASH_CR_LOCK)) {
+        return 1;
+    }
+
+    if (flash_wait()) {
+        return 1;
+    }
+
+    FLASH->CR = (FLASH->CR & ~FLASH_CR_PSIZE) | FLASH_CR_PSIZE_1 | FLASH_CR_PG;
+
+    for (uint32_t i = 0; i < count && status == 0; i++) {
+        *(volatile uint32_t *)(address + 4 * i) = data[i];
+        status = flash_wait();
+    }
+
+    FLASH->CR &= ~FLASH_CR_PG;
+    flash_flush_data_cache();
+
+    return status;
+}
@@ -74,6 +74,39 @@ uint32_t systick_get_ms(void)
     return system_tick_ms;
 }
 
+/**
+ * @brief Get current system time in microseconds
+ * 
+ * @details SysTick counts down from LOAD, so LOAD - VAL cycles of the current
+ *          millisecond have elapsed. If the counter already wrapped but the
+ *          SysTick handler has not run yet (pending, or preempted by the caller),
+ *          the millisecond counter is one behind and is corrected here.
+ * 
+ * @return uint32_t Current system time in microseconds
+ * 
+ * @note Rolls over approximately every 71.6 minutes (2^32 us)
+ */
+uint32_t systick_get_us(void)
+{
+    uint32_t ms;
+    uint32_t val;
+    uint32_t load = SysTick->LOAD + 1;
+    
+    /* Retry if the SysTick handler ran between the two reads */
+    do {
+        ms = system_tick_ms;
+        val = SysTick->VAL;
+    } while (ms != system_tick_ms);
+    
+    /* Tick pending means the counter wrapped but ms was not incremented yet */
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+        val = SysTick->VAL;     /* Re-read so val is from after the wrap */
+        ms++;
+    }
+    
+    return ms * 1000 + ((load - 1 - val) * 1000) / load;
+}
+
 /**
  * @brief Calculate elapsed time since a reference point
  * 
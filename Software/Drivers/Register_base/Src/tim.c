@@ -12,6 +12,7 @@
  */
 
 #include "../Inc/tim.h"
+#include "../Inc/rcc.h"
 
 /**
  * @brief Initialize a timer with basic parameters
@@ -214,3 +215,94 @@ uint8_t tim_get_update_flag(TIM_TypeDef *TIMx) {
 void tim_clear_update_flag(TIM_TypeDef *TIMx) {
     TIMx->SR &= ~TIM_SR_UIF;
 }
+
+/**
+ * @brief Get timer kernel clock frequency
+ * 
+ * @details TIM1 and TIM8-TIM11 are clocked from APB2, all other timers from APB1.
+ *          When the APB prescaler is greater than 1 the timer clock is 2 x PCLK.
+ * 
+ * @param TIMx Timer instance
+ * @return uint32_t Counter clock before prescaler in Hz
+ */
+uint32_t tim_get_clock_freq(TIM_TypeDef *TIMx) {
+    uint32_t pclk;
+    uint32_t apb_prescaler;
+    
+    if (TIMx == TIM1 || TIMx == TIM8 || TIMx == TIM9 || TIMx == TIM10 || TIMx == TIM11) {
+        pclk = rcc_get_pclk2_freq();
+        apb_prescaler = (RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos;
+    } else {
+        pclk = rcc_get_pclk1_freq();
+        apb_prescaler = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;
+    }
+    
+    /* Prescaler values 0xx mean "not divided" */
+    return (apb_prescaler & 0x04) ? (pclk * 2) : pclk;
+}
+
+/**
+ * @brief Program PSC/ARR for the closest achievable update frequency
+ * 
+ * @details Uses the smallest prescaler that lets ARR fit the counter width,
+ *          which gives the finest period resolution.
+ *          Achieved frequency = clock / ((PSC + 1) * (ARR + 1))
+ *          PSC and ARR go through their preload registers. A running counter
+ *          switches at its next update, so no period is cut short and no
+ *          update is forced. A stopped counter is loaded at once with UG,
+ *          during which TRGO is held on the counter enable signal.
+ * 
+ * @param TIMx Timer instance
+ * @param freq_hz Requested update frequency in Hz
+ * @return uint32_t Achieved update frequency in Hz, 0 if the request is invalid
+ */
+uint32_t tim_set_frequency(TIM_TypeDef *TIMx, uint32_t freq_hz) {
+    uint32_t clock = tim_get_clock_freq(TIMx);
+    uint32_t max_arr = (TIMx == TIM2 || TIMx == TIM5) ? 0xFFFFFFFFU : 0xFFFFU;
+    uint32_t ticks;
+    uint32_t psc;
+    uint32_t arr;
+    
+    if (freq_hz == 0 || freq_hz > clock) {
+        return 0;
+    }
+    
+    /* Total timer ticks per period, rounded to nearest */
+    ticks = (clock + freq_hz / 2) / freq_hz;
+    
+    psc = (max_arr == 0xFFFFFFFFU) ? 0 : (ticks - 1) / 0x10000U;
+    if (psc > 0xFFFF) {
+        return 0;  // Frequency too low for this timer
+    }
+    arr = (ticks + (psc + 1) / 2) / (psc + 1) - 1;
+    
+    /* Both buffered: a running counter takes them at its next natural update */
+    TIMx->CR1 |= TIM_CR1_ARPE;
+    TIMx->PSC = psc;
+    TIMx->ARR = arr;
+    
+    if (!(TIMx->CR1 & TIM_CR1_CEN)) {
+        /* Stopped: load them now with UG, holding TRGO on the idle counter enable
+         * so an update-driven trigger (ADC, DAC, slave timer) sees no extra edge */
+        uint32_t cr2 = TIMx->CR2;
+        
+        TIMx->CR2 = (cr2 & ~TIM_CR2_MMS) | ((uint32_t)TIM_TRGO_ENABLE << TIM_CR2_MMS_Pos);
+        TIMx->EGR = TIM_EGR_UG;
+        TIMx->CR2 = cr2;
+    }
+    
+    return clock / ((psc + 1) * (arr + 1));
+}
+
+/**
+ * @brief Select the trigger output (TRGO) source
+ * 
+ * @details Writes the MMS bits in CR2, used to chain timers or trigger ADC/DAC.
+ * 
+ * @param TIMx Timer instance
+ * @param source TRGO source (TIM_TRGO_xxx)
+ */
+void tim_set_trgo(TIM_TypeDef *TIMx, uint8_t source) {
+    TIMx->CR2 &= ~TIM_CR2_MMS;
+    TIMx->CR2 |= ((uint32_t)source << TIM_CR2_MMS_Pos) & TIM_CR2_MMS;
+}
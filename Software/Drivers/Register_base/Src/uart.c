@@ -303,6 +303,71 @@ uint8_t uart_transmit_string(UART_HandleTypeDef *huart, const char *str)
     return 0;
 }
 
+/**
+ * @brief Start sending data through UART (interrupt mode)
+ * 
+ * @details Returns at once. Each TXE interrupt hands the next byte to the
+ * data register, so the caller only waits for the line, never for the bits.
+ * 
+ * @param huart Pointer to UART handle structure
+ * @param data Pointer to data buffer, must stay valid until uart_tx_busy() returns 0
+ * @param size Buffer size
+ * @return uint8_t 0 if started, 1 if error or a transmission is still running
+ */
+uint8_t uart_transmit_it(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size)
+{
+    /* Validate input parameters */
+    if (huart == NULL || data == NULL || size == 0 || huart->TxBusy) {
+        return 1;
+    }
+    
+    huart->pTxBuffer = (uint8_t *)data;
+    huart->TxSize = size;
+    huart->TxCount = 0;
+    huart->TxBusy = 1;
+    
+    /* TXE is already set, so the first interrupt follows right away */
+    huart->Instance->CR1 |= USART_CR1_TXEIE;
+    
+    return 0;
+}
+
+/**
+ * @brief Check whether an interrupt-mode transmission is still running
+ * 
+ * @param huart Pointer to UART handle structure
+ * @return uint8_t 1 while bytes are left to hand to the UART, 0 otherwise
+ */
+uint8_t uart_tx_busy(UART_HandleTypeDef *huart)
+{
+    return (huart != NULL && huart->TxBusy) ? 1 : 0;
+}
+
+/**
+ * @brief UART interrupt handler, feeds interrupt-mode transmissions
+ * 
+ * @details The last byte is in the data register when TxBusy clears, so the
+ * buffer may be reused while it is still being shifted out.
+ * 
+ * @param huart Pointer to UART handle structure
+ */
+void uart_irq_handler(UART_HandleTypeDef *huart)
+{
+    if (huart == NULL) {
+        return;
+    }
+    
+    if ((huart->Instance->CR1 & USART_CR1_TXEIE) && (huart->Instance->SR & USART_SR_TXE)) {
+        if (huart->TxCount < huart->TxSize) {
+            huart->Instance->DR = huart->pTxBuffer[huart->TxCount++];
+        }
+        if (huart->TxCount >= huart->TxSize) {
+            huart->Instance->CR1 &= ~USART_CR1_TXEIE;
+            huart->TxBusy = 0;
+        }
+    }
+}
+
 /**
  * @brief Check if UART flag is set
  * 
@@ -0,0 +1,153 @@
+/**
+ ******************************************************************************
+ * @file           : acquisition.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-22
+ * @brief          : Multi-channel ADC scan acquisition header
+ ******************************************************************************
+ * @details
+ * This file declares the scan-mode acquisition engine. A table of channels is
+ * converted as one regular sequence per trigger, DMA writes the frames
+ * interleaved into the pool buffers of current_adcBuffer, and the engine splits every block into
+ * per-channel ring buffers. Rank 0 is always the motor current channel and is
+ * additionally returned as a contiguous block for the current pipeline. With
+ * more than one channel that block is a copy, so nothing downstream keeps a
+ * pointer into the pool.
+ *
+ * Channels with long sampling times stay out of the regular sequence, where
+ * they would stretch every frame. They are converted one at a time on request
+ * instead and get rings numbered after the regular ranks.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <stddef.h>
+#include "stm32f407xx.h"
+#include "current.h"
+
+/**
+ * @name Acquisition Configuration Constants
+ * @{
+ */
+#define ACQUISITION_MAX_CHANNELS    8       /**< Maximum channels in the scan table */
+#define ACQUISITION_RING_SIZE       64      /**< Samples kept per channel, must be a power of two */
+#define ACQUISITION_RING_MASK       (ACQUISITION_RING_SIZE - 1)
+/** @} */
+
+/**
+ * @brief Scan table entry
+ */
+typedef struct {
+    uint32_t Channel;           /**< ADC channel number (ADC_CHANNEL_x) */
+    uint32_t SamplingTime;      /**< Sample time selection (ADC_SAMPLETIME_x) */
+    GPIO_TypeDef *GPIOx;        /**< Analog input port, NULL for internal channels */
+    uint8_t pin;                /**< Analog input pin number */
+} Acquisition_ChannelTypeDef;
+
+/**
+ * @brief Per-channel sample ring
+ */
+typedef struct {
+    uint16_t data[ACQUISITION_RING_SIZE];   /**< Most recent samples */
+    uint32_t head;                          /**< Total samples written since configuration */
+} Acquisition_RingTypeDef;
+
+/**
+ * @brief Configure ADC1 regular sequence and analog inputs from a channel table
+ *
+ * @param table Channel table, entry 0 must be the motor current channel
+ * @param count Number of entries (1 to ACQUISITION_MAX_CHANNELS)
+ * @return uint8_t 0 if successful, 1 if the table is invalid
+ *
+ * @note Call after adc_init() and before DMA is enabled. The temperature sensor
+ *       and VREFINT are switched on automatically when channels 16/17 are listed.
+ */
+uint8_t acquisition_configure(const Acquisition_ChannelTypeDef *table, uint8_t count);
+
+/**
+ * @brief Register the channels converted outside the regular sequence
+ *
+ * @param table Channel table, ring i of this table is regular count + i
+ * @param count Number of entries, 0 to remove all
+ * @return uint8_t 0 if successful, 1 if the table is invalid
+ *
+ * @note Call after acquisition_configure()
+ */
+uint8_t acquisition_configure_slow(const Acquisition_ChannelTypeDef *table, uint8_t count);
+
+/**
+ * @brief Convert every slow channel once into its ring
+ *
+ * @return uint8_t Number of channels converted
+ *
+ * @note Main loop only, see inject_convert() for the cost
+ */
+uint8_t acquisition_sample_slow(void);
+
+/**
+ * @brief Get the number of channels in the active scan table
+ *
+ * @return uint8_t Channels per frame
+ */
+uint8_t acquisition_get_channel_count(void);
+
+/**
+ * @brief Get the ADCCLK cycles needed to convert one complete frame
+ *
+ * @return uint32_t Sum of conversion cycles over all ranks
+ */
+uint32_t acquisition_get_frame_cycles(void);
+
+/**
+ * @brief Get the ADCCLK cycles of the slowest rank
+ *
+ * @return uint32_t Largest conversion time in the regular sequence
+ *
+ * @note This is what an injected conversion can waste at most: the regular
+ *       conversion it interrupts starts over afterwards
+ */
+uint32_t acquisition_get_rank_cycles(void);
+
+/**
+ * @brief Split an interleaved DMA block into per-channel rings
+ *
+ * @param raw Block from current_pipeline_get() (interleaved frames)
+ * @param current Filled with a contiguous block of rank 0 (current) samples
+ *
+ * @note With a single-channel table the current block aliases the DMA buffer
+ *       and is only valid until raw is released. Otherwise it is a copy that
+ *       stays valid until the next call.
+ */
+void acquisition_split(const Current_BlockTypeDef *raw, Current_BlockTypeDef *current);
+
+/**
+ * @brief Get the newest sample of a rank
+ *
+ * @param rank Position in the scan table (0 = current), slow channels following
+ * @return uint16_t Latest raw sample, 0 if the rank is invalid or empty
+ */
+uint16_t acquisition_get_latest(uint8_t rank);
+
+/**
+ * @brief Copy the newest samples of a rank, oldest first
+ *
+ * @param rank Position in the scan table (0 = current), slow channels following
+ * @param dst Destination buffer
+ * @param count Number of samples requested (at most ACQUISITION_RING_SIZE)
+ * @return uint16_t Number of samples copied
+ */
+uint16_t acquisition_read(uint8_t rank, uint16_t *dst, uint16_t count);
+
+/**
+ * @brief Get the ring of a rank for direct access
+ *
+ * @param rank Position in the scan table (0 = current), slow channels following
+ * @return const Acquisition_RingTypeDef* Ring pointer, NULL if the rank is invalid
+ */
+const Acquisition_RingTypeDef *acquisition_get_ring(uint8_t rank);
+
+#endif /* ACQUISITION_H */
@@ -29,6 +29,23 @@
 #include "event.h"
 #include "button.h"
 #include "uart.h"
+#include "current.h"
+#include "stats.h"
+#include "acquisition.h"
+#include "burst.h"
+#include "protect.h"
+#include "filter.h"
+#include "fft.h"
+#include "oversample.h"
+#include "pwm.h"
+#include "inject.h"
+#include "scope.h"
+#include "flash.h"
+#include "calib.h"
+#include "pid.h"
+#include "profile.h"
+#include "speed.h"
+#include "control.h"
 
 /* Buttion pin definitions */
 #define BUTTON_UP_PORT      GPIOE
@@ -50,6 +67,14 @@
 #define MOTOR_ENABLE_PORT   GPIOE
 #define MOTOR_ENABLE_PIN    7
 
+/* Motor bridge PWM: center-aligned TIM3, CH3 on PB0 (P), CH4 on PB1 (M) */
+#define MOTOR_PWM_TIM           TIM3
+#define MOTOR_PWM_AF            2
+#define MOTOR_PWM_CH_P          TIM_CHANNEL_3
+#define MOTOR_PWM_CH_M          TIM_CHANNEL_4
+#define MOTOR_PWM_CH_TRIGGER    TIM_CHANNEL_2   // No pin, TIM3_CC2 starts the injected current sample
+#define MOTOR_PWM_FREQ_HZ       20000
+
 /* Motor encoder pin definitions */
 #define ENCODER_CH3_PORT    GPIOA
 #define ENCODER_CH3_PIN     2
@@ -57,12 +82,84 @@
 #define ENCODER_CH4_PORT    GPIOA
 #define ENCODER_CH4_PIN     3
 
+/*
+ * Z channel on PB10, TIM2_CH3 (AF1). PA2 above is TIM2_CH3 as well, so the
+ * index stays off on this board and PB10 is left alone. Set to 1 only once
+ * A/B are wired to TIM2_CH1/CH2 pins (PA15/PB3) and PA2 is free.
+ */
+#define ENCODER_INDEX_ENABLE 0
+#define ENCODER_INDEX_PORT  GPIOB
+#define ENCODER_INDEX_PIN   10
+#if ENCODER_INDEX_ENABLE
+#define ENCODER_INDEX_CH    ENCODER_INDEX_CH3
+#else
+#define ENCODER_INDEX_CH    ENCODER_INDEX_NONE
+#endif
+
 #define ENCODER_TIM         TIM2
+#define ENCODER_TS_TIM      TIM5    // Free-running 32-bit edge timestamps for M/T speed
+#define ENCODER_TS_ITR      0       // TIM5 ITR0 = TIM2 TRGO
+
+/* Per-edge timestamps: TIM5 CC1 requests DMA1 Stream2 Channel 6 on every timed edge */
+#define ENCODER_EDGE_DMA            DMA1
+#define ENCODER_EDGE_DMA_STREAM     DMA_STREAM2
+#define ENCODER_EDGE_DMA_CHANNEL    DMA_CHANNEL_6
+#define ENCODER_EDGE_BUFFER_SIZE    2048    // Timestamps in the ring: 160 ms of edges at 3000 RPM, 1000 CPR
+
+/* Encoder tracking observer: fixed-rate update from the TIM7 interrupt */
+#define ENCODER_OBS_TIM             TIM7
+#define ENCODER_OBS_RATE_HZ         10000   // Observer updates per second
+#define ENCODER_OBS_BANDWIDTH_HZ    50      // Loop bandwidth: higher follows faster, lower is quieter
+
+/* PI speed loop, run from the observer interrupt. Gains are Q15 current per mRPM of error, in Q16 */
+#define SPEED_LOOP_RATE_HZ          1000        // Loop updates per second, divides ENCODER_OBS_RATE_HZ
+#define SPEED_KP_Q16                2185        // Proportional: 0.033 current LSB per mRPM, 1.25 A at 300 RPM error
+#define SPEED_KI_Q16                21627       // Integral per second: 10 rad/s integral corner
+#define SPEED_MAX_MRPM              3000000     // Setpoint limit, 3000 RPM
+#define SPEED_STEP_MRPM             250000      // Setpoint step of the UP button and the +/- commands
+
+/* Control cascade: PI current loop on every injected sample, P position loop ahead of the speed loop */
+#define CONTROL_CURRENT_LIMIT_MA    2500        // Current setpoint limit, below CURRENT_CRITICAL_THRESHOLD_MA
+#define CONTROL_CURRENT_KP_Q16      16384       // Proportional: 0.25 Q15 duty per Q15 current, about 6% duty at 1 A error
+#define CONTROL_CURRENT_KI_Q16      16384000    // Integral per second: 1000 rad/s zero, near the winding L/R corner
+#define CONTROL_POSITION_KP_MRPM    2000        // Speed setpoint per count of position error, mRPM
+#define COMMAND_ENTRY_MAX           1000000     // Typed values stay below this magnitude (RPM, mA, counts or Hz)
+
+/* Setpoint profile ahead of the speed and position loops, at SPEED_LOOP_RATE_HZ */
+#define PROFILE_MAX_ACCEL_RPM_S     10000       // Acceleration limit: 0 to 3000 RPM in 0.3 s plus the jerk ramps
+#define PROFILE_MAX_JERK_RPM_S2     200000      // Jerk limit: acceleration ramps up in 50 ms
+
+/* PID library benchmark, run by the b command */
+#define PID_BENCHMARK_UPDATES       512         // Updates timed per variant
 
 /* Current sensing ADC pin definition */
 #define CURRENT_ADC_PORT    GPIOA
 #define CURRENT_ADC_PIN     0
 
+/* Bus voltage divider ADC pin definition */
+#define BUS_VOLTAGE_ADC_PORT    GPIOA
+#define BUS_VOLTAGE_ADC_PIN     1
+
+/*
+ * Scan acquisition: 1 = current and bus voltage in one sequence per trigger, die
+ * temperature and VREFINT converted once per calibration period on the borrowed
+ * injected group; 0 = current only. Temperature and VREFINT need >= 10us
+ * sampling time and would cap the frame rate at about 19.7kHz in the sequence.
+ */
+#define ADC_SCAN_MONITOR_ENABLE 1
+
+/* Ranks of the scan channels, the slow channels follow the regular ranks */
+#define ADC_RANK_CURRENT        0
+#define ADC_RANK_BUS_VOLTAGE    1
+#define ADC_RANK_TEMPERATURE    2   // Slow
+#define ADC_RANK_VREFINT        3   // Slow
+#define ADC_VREFINT_AVERAGE     8   // Newest slow VREFINT samples averaged into VDDA
+
+/* ADC sampling trigger: TIM8 TRGO (TIM2 is taken by the encoder) */
+#define ADC_TRIGGER_TIM     TIM8
+#define ADC_SAMPLE_RATE_HZ  500000  // Default frame rate; the limit is about 680kHz with injection worst case
+#define ADC_SAMPLE_RATE_MIN_HZ  80000   // Slowest rate the 'c' command sets: R = FILTER_COMP_MIN_DECIMATION at k = 0
+
 /**
  * @brief UART pin definitions
  */
@@ -72,17 +169,49 @@
 #define FPGA_UART_RX_PIN         6
 
 /* UART handle structure */
+extern UART_HandleTypeDef huart2;  // USART2 on PD5/PD6, command input and scope readout
+
+/* Default analog front end, used until a calibration is stored in flash */
+#define CURRENT_SENSE_OFFSET_MV       0                 // PA0 voltage at zero motor current
+#define CURRENT_SENSE_GAIN_Q16        (1L << 16)        // mA per mV at PA0, e.g. 0.1 ohm shunt with x10 amplifier
+#define BUS_VOLTAGE_OFFSET_MV         0                 // PA1 voltage at zero bus voltage
+#define BUS_VOLTAGE_GAIN_Q16          (11L << 16)       // Divider ratio, e.g. 100k over 10k
 
+/* Current protection threshold, compiled to raw counts through the calibration */
+#define CURRENT_CRITICAL_THRESHOLD_MA 2740  // Sliding-average limit, adjust based on system requirements
+#define CURRENT_TRIP_THRESHOLD_MA     3060  // Single-sample analog watchdog trip, above the average limit to ride through PWM ripple
+#define CURRENT_STATS_WINDOW          200   // Raw frames in the sliding average window, any k (max STATS_WINDOW_MAX)
 
+/* Current filter chain: CIC decimates to CURRENT_FILTER_RATE_HZ, compensating FIR follows */
+#define CURRENT_FILTER_RATE_HZ        10000 // Output rate, decimation R = sample rate / this (at least FILTER_COMP_MIN_DECIMATION)
+#define CURRENT_FILTER_CIC_ORDER      3     // Matches the default compensation FIR
 
-/* Current protection threshold */
-#define CURRENT_CRITICAL_THRESHOLD    3400  // ADC value threshold, adjust based on system requirements
+/* Current oversampling: 4^k samples per output, k extra bits (0 = raw 12-bit stream) */
+#define CURRENT_OVERSAMPLE_BITS       0     // Power-up k, 0 to OVERSAMPLE_MAX_BITS
+#define CURRENT_OVERSAMPLE_DITHER     0     // Power-up rounding: 1 = dithered, 0 = nearest
+#define CURRENT_FINE_STATS_LENGTH     64    // Oversampled samples per current_fine_stats snapshot
+
+/* Current spectrum: FFT over the filter output, for current signature analysis */
+#define CURRENT_SPECTRUM_POINTS       1024  // Power of two, FFT_MIN_POINTS to FFT_MAX_POINTS
+
+/* Current transient recorder: raw samples around a trigger, SCOPE_RECORD_SIZE in total */
+#define CURRENT_SCOPE_POST_SAMPLES    4096  // Samples from the trigger on, the rest of the record is history
+
+/* ADC sample pool layout: CURRENT_POOL_BUFFERS blocks, DMA double-buffers between free ones */
+#define CURRENT_ADC_BLOCK_SIZE        100   // Samples per pool buffer, trimmed to whole scan frames
+#define CURRENT_ADC_BUFFER_SIZE       (CURRENT_POOL_BUFFERS * CURRENT_ADC_BLOCK_SIZE)
 
 /* Global shared variables for ADC data handling */
-extern volatile uint16_t current_adcBuffer[200];  // ADC sample buffer
+extern volatile uint16_t current_adcBuffer[CURRENT_ADC_BUFFER_SIZE];  // ADC sample pool storage
 extern uint16_t current_adcAverage;               // Calculated average value
-extern volatile uint8_t current_adcAverageReady;  // Flag indicating new data is ready
-extern uint32_t sum;
+extern uint16_t current_adcCritical;              // CURRENT_CRITICAL_THRESHOLD_MA in raw counts
+extern uint16_t current_adcTrip;                  // CURRENT_TRIP_THRESHOLD_MA in raw counts
+extern Stats_WindowTypeDef current_stats;         // Sliding-window current statistics
+extern Stats_BlockTypeDef current_block_stats;    // Mean/RMS/peak snapshot of the newest valid block
+extern Stats_BlockTypeDef current_fine_stats;     // Same snapshot of the oversampled stream, the raw block at k = 0
+extern Filter_ChainTypeDef current_filter;        // Decimating current filter chain
+extern int16_t current_adcFiltered;               // Latest filtered value, ADC counts << FILTER_OUTPUT_SHIFT
+extern FFT_AnalyzerTypeDef current_spectrum;      // Spectrum of the filtered current
 
 /**
  * @brief Initialize RCC (Reset and Clock Control)
@@ -101,17 +230,54 @@ void gpio_system_init(void);
 /**
  * @brief Initialize timer for ADC trigger
  * 
- * Configures TIM2 to generate periodic trigger for ADC sampling at 500kHz
+ * Configures TIM8 to generate periodic TRGO trigger for ADC sampling at ADC_SAMPLE_RATE_HZ
  */
 void timer_init(void);
 
 /**
  * @brief Initialize ADC and DMA
  * 
- * Configures ADC for timer-triggered sampling with DMA on PA0
+ * Configures ADC for timer-triggered scan sampling with DMA, current on PA0
  */
 void adc_dma_init(void);
 
+/**
+ * @brief Change the ADC sample rate at runtime
+ * 
+ * @param rate_hz Requested sample rate in Hz
+ * @return uint32_t Achieved sample rate in Hz, 0 if the rate cannot be generated
+ * 
+ * @note Requests above the conversion limit of one scan frame are clamped to that limit
+ */
+uint32_t adc_sampling_set_rate(uint32_t rate_hz);
+
+/**
+ * @brief Get the achieved ADC sample rate
+ * 
+ * @return uint32_t Sample rate in Hz as programmed into the trigger timer
+ */
+uint32_t adc_sampling_get_rate(void);
+
+/**
+ * @brief Select the current oversampling ratio at runtime
+ * 
+ * @param extra_bits k, 0 (raw 12-bit stream) to OVERSAMPLE_MAX_BITS; the ratio is 4^k
+ * @param dither 1 to round with a pseudo-random offset, 0 to round to nearest
+ * @return uint8_t 0 if successful, 1 if extra_bits is out of range
+ * 
+ * @note Restarts the sliding window, filter chain and spectrum at the new output rate
+ */
+uint8_t adc_oversampling_set(uint8_t extra_bits, uint8_t dither);
+
+/**
+ * @brief Measure VDDA and recompile the current limits
+ * 
+ * @return uint16_t VDDA in mV
+ * 
+ * @note Call periodically; also after changing a calibration with calib_set_channel()
+ */
+uint16_t adc_calibration_update(void);
+
 /**
  * @brief Initialize UART interface
  * 
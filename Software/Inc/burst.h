@@ -0,0 +1,98 @@
+/**
+ ******************************************************************************
+ * @file           : burst.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-23
+ * @brief          : Triple-interleaved ADC burst capture header
+ ******************************************************************************
+ * @details
+ * This file declares the optional high-speed capture mode. ADC1, ADC2 and ADC3
+ * convert the current channel in triple-interleaved mode, and one DMA stream
+ * copies the packed common data register into a burst buffer. At ADCCLK = 21MHz
+ * with a 5-cycle phase delay, the combined rate is 4.2MSPS, which is enough to
+ * resolve PWM ripple and commutation transients.
+ *
+ * The burst borrows ADC1 and DMA2 Stream0 from the regular acquisition path.
+ * That path is rebuilt once the burst completes and stays the default mode.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef BURST_H
+#define BURST_H
+
+#include "stm32f407xx.h"
+#include "current.h"
+
+/**
+ * @name Burst Configuration Constants
+ * @{
+ */
+#define BURST_BUFFER_SIZE       3072    /**< Samples per burst, a multiple of 6 (three ADCs x two per word) */
+#define BURST_PHASE_DELAY       5       /**< ADCCLK cycles between ADC1, ADC2 and ADC3 sampling phases */
+/** @} */
+
+/**
+ * @brief Burst capture state
+ */
+typedef enum {
+    BURST_IDLE = 0,             /**< No burst captured yet */
+    BURST_RUNNING,              /**< Interleaved conversions in progress */
+    BURST_COMPLETE,             /**< DMA finished, regular path not restored yet */
+    BURST_READY                 /**< Burst buffer valid, regular path running again */
+} Burst_StateTypeDef;
+
+/**
+ * @brief Start one triple-interleaved burst
+ *
+ * @return uint8_t 0 if the burst was started, 1 if a burst is still in progress,
+ *         2 if the motor driver is enabled
+ *
+ * @note Regular acquisition and the current protection pause until
+ *       burst_handler() has restored them, so the bridge must be off
+ */
+uint8_t burst_capture_start(void);
+
+/**
+ * @brief Check whether the regular path is still down for a burst
+ *
+ * @return uint8_t 1 until burst_handler() has restored regular sampling, 0 otherwise
+ */
+uint8_t burst_capture_busy(void);
+
+/**
+ * @brief Check whether a burst owns ADC1 and DMA2 Stream0
+ *
+ * @return uint8_t 1 while the burst is running, 0 otherwise
+ */
+uint8_t burst_capture_active(void);
+
+/**
+ * @brief Burst DMA transfer complete handler (called from the DMA ISR)
+ */
+void burst_capture_irq_handler(void);
+
+/**
+ * @brief Restore the regular acquisition path after a burst
+ *
+ * @note Call periodically from the main loop
+ */
+void burst_handler(void);
+
+/**
+ * @brief Get the last completed burst
+ *
+ * @param block Filled with the burst samples in time order
+ * @return uint8_t 1 if a burst is available, 0 otherwise
+ */
+uint8_t burst_get(Current_BlockTypeDef *block);
+
+/**
+ * @brief Get the effective sample rate of a burst
+ *
+ * @return uint32_t Combined sample rate of the three ADCs in Hz
+ */
+uint32_t burst_get_sample_rate(void);
+
+#endif /* BURST_H */
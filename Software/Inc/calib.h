@@ -0,0 +1,138 @@
+/**
+ ******************************************************************************
+ * @file           : calib.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-30
+ * @brief          : ADC calibration and engineering unit conversion header
+ ******************************************************************************
+ * @details
+ * This file declares the conversion from raw ADC counts to engineering units.
+ * The reference is VDDA, which is measured through VREFINT against the factory
+ * value the ST production test stored in system memory. Every scan rank then
+ * has a linear calibration: an offset at the pin in mV and a gain in units per
+ * pin mV. Units are mA for the current rank and mV for the voltage ranks.
+ *
+ * The calibration is kept in the last flash sector and falls back to the
+ * board defaults when that sector holds no valid record. Each VDDA update folds
+ * reference, offset and gain into one Q16 scale and one offset per rank, so a
+ * conversion is a multiply, a shift and a subtraction. Thresholds convert the
+ * other way once, and the hot paths keep comparing raw counts.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef CALIB_H
+#define CALIB_H
+
+#include "stm32f407xx.h"
+#include "acquisition.h"
+
+#define CALIB_MAX_CHANNELS      ACQUISITION_MAX_CHANNELS
+#define CALIB_VREFINT_CAL       (*(const uint16_t *)0x1FFF7A2AU)    /**< VREFINT raw value at VDDA = 3.3 V, 30 degC */
+#define CALIB_VREFINT_CAL_MV    3300                                /**< VDDA of the factory measurement */
+#define CALIB_FULL_SCALE        4095                                /**< 12-bit full scale count */
+
+/**
+ * @brief Linear calibration of one scan rank
+ */
+typedef struct {
+    int16_t offset_mv;          /**< Pin voltage at zero input, mV */
+    uint16_t reserved;          /**< Keeps the stored record word aligned */
+    int32_t gain_q16;           /**< Units per pin mV, Q16.16, must be positive */
+} Calib_ChannelTypeDef;
+
+/**
+ * @brief Load the stored calibration
+ *
+ * @param defaults Calibration used for ranks without a stored record
+ * @param count Number of ranks (1 to CALIB_MAX_CHANNELS)
+ * @return uint8_t 1 if a stored record was loaded, 0 if the defaults are in use
+ *
+ * @note VDDA starts at CALIB_VREFINT_CAL_MV until the first calib_update_vdda()
+ */
+uint8_t calib_init(const Calib_ChannelTypeDef *defaults, uint8_t count);
+
+/**
+ * @brief Measure VDDA and refresh the conversion scales
+ *
+ * @param vrefint_raw Averaged raw VREFINT conversion, 12-bit
+ * @return uint16_t VDDA in mV
+ */
+uint16_t calib_update_vdda(uint16_t vrefint_raw);
+
+/**
+ * @brief Get the latest VDDA measurement
+ *
+ * @return uint16_t VDDA in mV
+ */
+uint16_t calib_get_vdda_mv(void);
+
+/**
+ * @brief Get the calibration of a rank
+ *
+ * @param rank Scan rank
+ * @param channel Destination
+ * @return uint8_t 0 if successful, 1 if the rank is invalid
+ */
+uint8_t calib_get_channel(uint8_t rank, Calib_ChannelTypeDef *channel);
+
+/**
+ * @brief Replace the calibration of a rank
+ *
+ * @param rank Scan rank
+ * @param channel New calibration
+ * @return uint8_t 0 if successful, 1 if the rank or gain is invalid
+ *
+ * @note Takes effect immediately, calib_save() makes it permanent
+ */
+uint8_t calib_set_channel(uint8_t rank, const Calib_ChannelTypeDef *channel);
+
+/**
+ * @brief Store the calibration in flash
+ *
+ * @return uint8_t 0 if successful, 1 on a flash error
+ *
+ * @warning Erases a 128 KB sector, which stalls the CPU and every interrupt
+ *          for up to 2 s. Only call with the motor disabled.
+ */
+uint8_t calib_save(void);
+
+/**
+ * @brief Convert a raw count to engineering units
+ *
+ * @param rank Scan rank
+ * @param raw 12-bit raw ADC count
+ * @return int32_t mA or mV, 0 if the rank is invalid
+ */
+int32_t calib_to_units(uint8_t rank, uint16_t raw);
+
+/**
+ * @brief Convert a fractional raw count to thousandths of engineering units
+ *
+ * @param rank Scan rank
+ * @param raw Raw ADC count << frac_bits, e.g. an oversampled or block mean
+ * @param frac_bits Fraction bits of raw
+ * @return int32_t uA or uV, 0 if the rank is invalid
+ */
+int32_t calib_to_milliunits(uint8_t rank, uint32_t raw, uint8_t frac_bits);
+
+/**
+ * @brief Convert engineering units to the raw compare value
+ *
+ * @param rank Scan rank
+ * @param units mA or mV
+ * @return uint16_t Largest raw count that does not exceed units, so
+ *         raw > result exactly when the converted value exceeds units
+ */
+uint16_t calib_to_raw(uint8_t rank, int32_t units);
+
+/**
+ * @brief Convert a raw count to the voltage at the pin
+ *
+ * @param raw 12-bit raw ADC count
+ * @return int32_t Pin voltage in mV
+ */
+int32_t calib_raw_to_mv(uint16_t raw);
+
+#endif /* CALIB_H */
@@ -0,0 +1,165 @@
+/**
+ ******************************************************************************
+ * @file           : control.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-09-03
+ * @brief          : Cascaded current, speed and position control header
+ ******************************************************************************
+ * @details
+ * This file declares the motor control cascade. Each level runs in the
+ * interrupt of its feedback and hands its output to the next level as that
+ * level's setpoint:
+ *
+ *   profile  (S-curve, TIM7, SPEED_LOOP_RATE_HZ) -> position and speed reference
+ *   position (P, TIM7, SPEED_LOOP_RATE_HZ) -> speed setpoint
+ *   speed    (PI, TIM7, SPEED_LOOP_RATE_HZ) -> current setpoint
+ *   current  (PI, ADC injected, every PWM period) -> bridge duty
+ *
+ * The current loop limits the motor current to CONTROL_CURRENT_LIMIT_MA. The
+ * averaged shutdown and the watchdog trip only remain as a backstop for
+ * faults.
+ *
+ * Every setpoint is one aligned 32-bit word, written by the one level above
+ * it (or by the main loop for the outermost active level) and read by the
+ * level below. A single store is atomic on the Cortex-M4, so the hand-off
+ * needs no lock and never masks an interrupt.
+ *
+ * The shunt only sees the current magnitude. The current loop takes its sign
+ * from the direction of the applied duty, so it cannot measure regenerative
+ * current.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include "stm32f407xx.h"
+#include "encoder.h"
+#include "profile.h"
+
+#define CONTROL_CURRENT_SHIFT           3       /**< mA to Q15 current */
+#define CONTROL_CURRENT_FULL_SCALE_MA   (32768 >> CONTROL_CURRENT_SHIFT)    /**< Q15 current full scale */
+
+/**
+ * @brief Outermost active level
+ */
+typedef enum {
+    CONTROL_MODE_OFF = 0,       /**< No loop drives the bridge, the duty is left alone */
+    CONTROL_MODE_CURRENT,       /**< Current loop on the control_set_current_target() setpoint */
+    CONTROL_MODE_SPEED,         /**< Speed and current loops on the control_set_speed_target() setpoint */
+    CONTROL_MODE_POSITION       /**< All three loops on the control_set_position_target() setpoint */
+} Control_ModeTypeDef;
+
+/**
+ * @brief Current loop state, as seen by the last current loop update
+ */
+typedef struct {
+    Control_ModeTypeDef mode;   /**< Active mode */
+    int32_t target_ma;          /**< Current setpoint in mA */
+    int32_t measured_ma;        /**< Signed measured current in mA */
+    int16_t duty;               /**< Q15 bridge duty written */
+    uint8_t saturated;          /**< 1 while the duty is at the limit */
+    uint32_t updates;           /**< Current loop updates since control_init() */
+} Control_StatusTypeDef;
+
+/**
+ * @brief Set up all levels, initially off
+ *
+ * @param encoder Encoder whose observer provides speed and position
+ * @param call_rate_hz Rate at which control_irq_handler() will be called, a
+ *                     multiple of SPEED_LOOP_RATE_HZ
+ * @return uint8_t 0 if successful, 1 on an invalid rate or gain
+ */
+uint8_t control_init(Encoder_HandleTypeDef *encoder, uint32_t call_rate_hz);
+
+/**
+ * @brief Select the outermost active level
+ *
+ * @param mode New mode
+ * @return uint8_t 0 if successful, 1 on an invalid mode or, for any mode but
+ *         CONTROL_MODE_OFF, before control_init() succeeded
+ *
+ * @note Levels that become active start from empty integrators. Entering
+ *       position mode holds the present position.
+ */
+uint8_t control_set_mode(Control_ModeTypeDef mode);
+
+/**
+ * @brief Get the active mode
+ *
+ * @return Control_ModeTypeDef Active mode
+ */
+Control_ModeTypeDef control_get_mode(void);
+
+/**
+ * @brief Current loop update (called from ADC_IRQHandler)
+ *
+ * @note Call after inject_irq_handler(), so the loop sees the fresh sample
+ */
+void control_current_irq_handler(void);
+
+/**
+ * @brief Position and speed loop tick (called from the observer timer interrupt)
+ *
+ * @note Call after encoder_observer_update_all(), so the loops see the fresh estimate
+ */
+void control_irq_handler(void);
+
+/**
+ * @brief Set the current setpoint
+ *
+ * @param ma Setpoint in mA, limited to +-CONTROL_CURRENT_LIMIT_MA
+ *
+ * @note Overwritten by the speed loop unless in current mode
+ */
+void control_set_current_target(int32_t ma);
+
+/**
+ * @brief Set the speed setpoint
+ *
+ * @param mrpm Setpoint in 0.001 RPM, limited to +-SPEED_MAX_MRPM
+ *
+ * @note The speed loop reaches it along the profile
+ */
+void control_set_speed_target(int32_t mrpm);
+
+/**
+ * @brief Get the speed setpoint
+ *
+ * @return int32_t Setpoint in 0.001 RPM
+ */
+int32_t control_get_speed_target(void);
+
+/**
+ * @brief Set the position setpoint
+ *
+ * @param counts Setpoint in encoder counts, relative to the home position
+ *
+ * @note A move in progress bends towards the new setpoint
+ */
+void control_set_position_target(int32_t counts);
+
+/**
+ * @brief Get the position setpoint
+ *
+ * @return int32_t Setpoint in encoder counts
+ */
+int32_t control_get_position_target(void);
+
+/**
+ * @brief Copy the current loop state
+ *
+ * @param status Destination
+ */
+void control_get_status(Control_StatusTypeDef *status);
+
+/**
+ * @brief Copy the progress of the speed or position move
+ *
+ * @param status Destination
+ */
+void control_get_profile_status(Profile_StatusTypeDef *status);
+
+#endif /* CONTROL_H */
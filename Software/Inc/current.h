@@ -0,0 +1,130 @@
+/**
+ ******************************************************************************
+ * @file           : current.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-20
+ * @brief          : Current sensing pipeline header
+ ******************************************************************************
+ * @details
+ * This file declares the block hand-off between the ADC DMA interrupt and the
+ * main loop. DMA runs in double-buffer mode over a pool of sample buffers.
+ * Every time one target fills up, the ISR swaps a free pool buffer into that
+ * target and queues the filled one, tagged with a sequence number. The main
+ * loop takes each block by pointer and holds it until it is released, so DMA
+ * never overwrites a block that is being processed.
+ *
+ * Only a single-channel table is processed in place. With several channels
+ * acquisition_split() copies every rank out of the interleaved block, so the
+ * pool buffer goes back as soon as that one pass is done. Consumers that keep
+ * samples for longer (scope, FFT frames, statistics windows) copy them too.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef CURRENT_H
+#define CURRENT_H
+
+#include "stm32f407xx.h"
+
+/**
+ * @name Pipeline Configuration Constants
+ * @{
+ */
+#define CURRENT_POOL_BUFFERS    8       /**< Sample buffers in the pool, must be a power of two */
+#define CURRENT_POOL_MASK       (CURRENT_POOL_BUFFERS - 1)
+#define CURRENT_BUFFER_NONE     0xFF    /**< Block is not backed by a pool buffer */
+#define CURRENT_RAW_RESOLUTION  12      /**< Bits per sample as converted by the ADC */
+/** @} */
+
+/**
+ * @brief Stable block of ADC samples handed to the consumer
+ */
+typedef struct {
+    const volatile uint16_t *data;  /**< First sample of the block */
+    uint16_t length;                /**< Number of samples in the block */
+    uint8_t channels;               /**< Interleaved channels per frame (1 = contiguous) */
+    uint8_t buffer;                 /**< Pool buffer index, CURRENT_BUFFER_NONE if not pooled */
+    uint8_t resolution;             /**< Significant bits per sample (CURRENT_RAW_RESOLUTION unless oversampled) */
+    uint32_t sequence;              /**< Block sequence number (first block = 1) */
+} Current_BlockTypeDef;
+
+/**
+ * @brief Buffer pool shared between DMA ISR and main loop
+ *
+ * @details Two single-producer rings move buffer indices. The ready ring goes
+ *          from the ISR to the main loop and the free ring goes the other way,
+ *          so neither side needs to mask interrupts. The held flags are
+ *          only touched by the main loop.
+ */
+typedef struct {
+    uint8_t ready[CURRENT_POOL_BUFFERS];        /**< Filled buffers in completion order */
+    volatile uint32_t ready_head;               /**< Written by the ISR */
+    volatile uint32_t ready_tail;               /**< Written by the main loop */
+    uint8_t free[CURRENT_POOL_BUFFERS];         /**< Buffers DMA may fill next */
+    volatile uint32_t free_head;                /**< Written by the main loop */
+    volatile uint32_t free_tail;                /**< Written by the ISR */
+    uint8_t held[CURRENT_POOL_BUFFERS];         /**< 1 while the main loop holds a buffer, main loop only */
+    uint32_t sequence[CURRENT_POOL_BUFFERS];    /**< Sequence of the data in each buffer */
+    uint8_t target[2];                          /**< Buffers currently in M0AR and M1AR */
+    volatile uint32_t published;                /**< Sequence number of the newest filled buffer */
+    volatile uint32_t overrun;                  /**< Blocks dropped because no free buffer was left */
+    uint16_t block_length;                      /**< Samples per buffer (whole frames only) */
+    uint8_t channels;                           /**< Interleaved channels per frame */
+} Current_PipelineTypeDef;
+
+extern Current_PipelineTypeDef current_pipeline;
+
+/**
+ * @brief Reset the pipeline and pick the two initial DMA targets
+ *
+ * @param block_length Samples per buffer, a multiple of channels
+ * @param channels Interleaved channels per frame
+ * @return uint8_t 0 if successful, 1 if fewer than two buffers are free
+ *
+ * @note Call with the DMA stream stopped. Queued blocks are discarded, but
+ *       a buffer still held by the main loop stays untouched until released.
+ */
+uint8_t current_pipeline_init(uint16_t block_length, uint8_t channels);
+
+/**
+ * @brief Get the address of an initial DMA target
+ *
+ * @param target 0 for M0AR, 1 for M1AR
+ * @return uint32_t Buffer address to program into the stream
+ */
+uint32_t current_pipeline_target_address(uint8_t target);
+
+/**
+ * @brief Queue the filled buffer and refill the idle target (called from the DMA ISR)
+ */
+void current_pipeline_post(void);
+
+/**
+ * @brief Fetch the oldest queued block
+ *
+ * @param block Pointer to block descriptor to fill
+ * @return uint8_t 1 if a block was returned, 0 if nothing is pending
+ *
+ * @note The caller holds the buffer and must hand it back with current_pipeline_release()
+ */
+uint8_t current_pipeline_get(Current_BlockTypeDef *block);
+
+/**
+ * @brief Return a held block's buffer to the pool
+ *
+ * @param block Block obtained from current_pipeline_get()
+ * @return uint8_t 0 if the buffer was returned, 1 if the block was not held
+ */
+uint8_t current_pipeline_release(const Current_BlockTypeDef *block);
+
+/**
+ * @brief Locate the sample DMA wrote most recently
+ *
+ * @return uint16_t Index into current_adcBuffer
+ *
+ * @note Intended for interrupt handlers that react to a single conversion
+ */
+uint16_t current_pipeline_last_index(void);
+
+#endif /* CURRENT_H */
@@ -35,14 +35,15 @@ void button_system_init(void);
 /**
  * @brief Initialize all system scanning timers
  * 
- * @details Initializes encoder timer, current monitoring timer, and button system.
+ * @details Initializes encoder timer and button system.
  */
 void scan_init(void);
 
 /**
  * @brief Check all system timers and handle events
  * 
- * @details Checks encoder timer, current monitoring timer, and button states.
+ * @details Checks encoder timer, pending current blocks, the spectrum analysis
+ *          and button states.
  *          Calls button_handler() when button events are detected.
  */
 void scan_check(void);
@@ -51,12 +52,16 @@ void scan_check(void);
  * @brief Handle button events
  * 
  * @details Processes button press events for motor control including:
- *          - UP: Navigation/speed increase
- *          - DOWN: Navigation/speed decrease  
+ *          - UP: Speed setpoint increase
+ *          - DOWN: Trigger a scope capture
  *          - ENTER: Start/stop motor
  *          - RETURN: Emergency stop
  */
 void button_handler(void);
 void current_handler(void);
+void spectrum_handler(void);
+void command_handler(void);
+void scope_handler(void);
+void calib_handler(void);
 void encoder_handler(void);
 #endif /* EVENT_H */
@@ -0,0 +1,133 @@
+/**
+ ******************************************************************************
+ * @file           : fft.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-26
+ * @brief          : Incremental Q15 FFT spectrum analyzer header
+ ******************************************************************************
+ * @details
+ * This file declares a spectrum analyzer for current signature analysis. It
+ * collects a frame of filtered current samples and removes the mean. It then
+ * applies a Hann window and runs a radix-4 Q15 FFT, with one extra radix-2
+ * stage for odd powers of two. Last it computes the bin magnitudes and picks
+ * the strongest peaks.
+ *
+ * The work is split into bounded steps, so one call from the main loop never
+ * takes more than FFT_STEP_ITEMS butterflies, samples or bins. On Cortex-M4
+ * the butterflies use the halving SIMD adds and the dual 16x16 multiplies on
+ * packed complex samples. Other targets use a bit-exact portable C version.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#include "stm32f407xx.h"
+
+/**
+ * @name FFT Configuration Constants
+ * @{
+ */
+#define FFT_MIN_POINTS          256     /**< Smallest supported transform */
+#define FFT_MAX_POINTS          2048    /**< Largest supported transform, sizes the buffers */
+#define FFT_MAX_PEAKS           4       /**< Peaks reported per spectrum */
+#define FFT_PEAK_MIN_BIN        3       /**< Lowest peak bin, keeps clear of the DC main lobe */
+#define FFT_STEP_ITEMS          128     /**< Work items per fft_analyzer_step() call */
+/** @} */
+
+/**
+ * @brief SIMD kernel selection, 1 when the core has the DSP extension
+ */
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#define FFT_USE_SIMD            1
+#else
+#define FFT_USE_SIMD            0
+#endif
+
+/**
+ * @brief Analyzer phase, advanced by fft_analyzer_step()
+ */
+typedef enum {
+    FFT_STATE_COLLECT = 0,      /**< Waiting for samples from fft_analyzer_push() */
+    FFT_STATE_WINDOW,           /**< Mean removal and Hann window */
+    FFT_STATE_RADIX2,           /**< Leading radix-2 stage (odd log2 of points only) */
+    FFT_STATE_RADIX4,           /**< Radix-4 stages, span divided by 4 each pass */
+    FFT_STATE_MAGNITUDE,        /**< Bin magnitudes in natural order */
+    FFT_STATE_PEAKS             /**< Peak picking over the finished magnitudes */
+} FFT_StateTypeDef;
+
+/**
+ * @brief Spectral peak
+ */
+typedef struct {
+    uint16_t bin;               /**< Bin of the local maximum */
+    uint16_t magnitude;         /**< Bin magnitude */
+    uint32_t amplitude;         /**< Estimated sine amplitude, input units */
+    uint32_t frequency_mhz;     /**< Interpolated frequency in mHz */
+} FFT_PeakTypeDef;
+
+/**
+ * @brief Spectrum analyzer state
+ *
+ * @details Complex samples are packed as one word, real part in the low
+ *          halfword. After the transform the bins are in bit-reversed order;
+ *          the magnitude pass reorders them.
+ */
+typedef struct {
+    uint32_t work[FFT_MAX_POINTS];              /**< Packed complex samples, transformed in place */
+    uint16_t magnitude[FFT_MAX_POINTS / 2];     /**< Bin magnitudes of the last spectrum, DC first */
+    FFT_PeakTypeDef peak[FFT_MAX_PEAKS];        /**< Strongest peaks, largest first */
+    uint8_t peaks;                              /**< Valid entries in peak */
+    FFT_StateTypeDef state;                     /**< Current phase */
+    uint16_t points;                            /**< Transform length N */
+    uint8_t log2_points;                        /**< log2(N) */
+    uint16_t fill;                              /**< Samples collected for the next frame */
+    int32_t sum;                                /**< Sum of the collected samples */
+    uint16_t span;                              /**< Sub-transform length of the running stage */
+    uint16_t position;                          /**< Next work item inside the running phase */
+    uint32_t sample_rate_hz;                    /**< Rate of the pushed samples */
+    uint32_t sequence;                          /**< Finished spectra since init */
+} FFT_AnalyzerTypeDef;
+
+/**
+ * @brief Initialize a spectrum analyzer
+ *
+ * @param analyzer Pointer to analyzer structure
+ * @param points Transform length, power of two from FFT_MIN_POINTS to FFT_MAX_POINTS
+ * @param sample_rate_hz Rate of the samples that will be pushed
+ * @return uint8_t 0 if successful, 1 if a parameter is out of range
+ *
+ * @note The first call also builds the shared twiddle table
+ */
+uint8_t fft_analyzer_init(FFT_AnalyzerTypeDef *analyzer, uint16_t points, uint32_t sample_rate_hz);
+
+/**
+ * @brief Feed samples into the frame being collected
+ *
+ * @param analyzer Pointer to analyzer structure
+ * @param samples Signed Q15 samples
+ * @param length Number of samples
+ *
+ * @note Samples arriving while a frame is being transformed are dropped
+ */
+void fft_analyzer_push(FFT_AnalyzerTypeDef *analyzer, const int16_t *samples, uint16_t length);
+
+/**
+ * @brief Run one bounded slice of the analysis
+ *
+ * @param analyzer Pointer to analyzer structure
+ * @return uint8_t 1 if this call finished a spectrum, 0 otherwise
+ */
+uint8_t fft_analyzer_step(FFT_AnalyzerTypeDef *analyzer);
+
+/**
+ * @brief Get the frequency resolution
+ *
+ * @param analyzer Pointer to analyzer structure
+ * @return uint32_t Bin spacing in mHz, 0 if not initialized
+ */
+uint32_t fft_analyzer_get_resolution_mhz(const FFT_AnalyzerTypeDef *analyzer);
+
+#endif /* FFT_H */
@@ -0,0 +1,140 @@
+/**
+ ******************************************************************************
+ * @file           : filter.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-25
+ * @brief          : CIC decimator and Q15 FIR filter chain header
+ ******************************************************************************
+ * @details
+ * This file declares a two-stage decimating filter for ADC sample blocks. A
+ * CIC decimator reduces the rate by R using only additions. A Q15 FIR then
+ * compensates the CIC passband droop and removes what is left above the output
+ * band. On Cortex-M4 the FIR uses the SMLAD dual 16x16 MAC on packed sample
+ * pairs. Other targets use a portable C loop.
+ *
+ * Output samples are in 12-bit ADC counts scaled by 2^FILTER_OUTPUT_SHIFT,
+ * keeping some of the resolution gained by averaging. Wider oversampled inputs
+ * are normalized to the same scale.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "stm32f407xx.h"
+
+/**
+ * @name Filter Configuration Constants
+ * @{
+ */
+#define FILTER_CIC_MAX_ORDER    4       /**< Maximum number of integrator/comb stages */
+#define FILTER_CIC_MAX_GAIN     (1UL << 19) /**< Largest R^N keeping 12-bit input inside int32 */
+#define FILTER_INPUT_BITS       12      /**< Input resolution the output scale refers to */
+#define FILTER_INPUT_MAX_BITS   16      /**< Widest accepted input (oversampled samples) */
+#define FILTER_FIR_MAX_TAPS     64      /**< Maximum FIR length, must be even */
+#define FILTER_OUTPUT_SHIFT     3       /**< Extra fractional bits of the output samples */
+#define FILTER_COMP_TAPS        31      /**< Length of filter_cic3_comp_q15 */
+#define FILTER_COMP_MIN_DECIMATION  8   /**< Smallest R filter_cic3_comp_q15 is designed for */
+/** @} */
+
+/**
+ * @brief SIMD kernel selection, 1 when the core has the DSP extension
+ */
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#define FILTER_USE_SIMD         1
+#else
+#define FILTER_USE_SIMD         0
+#endif
+
+/**
+ * @brief CIC decimator state
+ *
+ * @details Integrators and combs wrap modulo 2^32. That is exact as long as
+ *          the final output fits in int32.
+ */
+typedef struct {
+    uint32_t integrator[FILTER_CIC_MAX_ORDER];  /**< Integrator accumulators */
+    uint32_t comb[FILTER_CIC_MAX_ORDER];        /**< Previous input of each comb */
+    uint32_t gain_mul;                          /**< 2^(28 + FILTER_OUTPUT_SHIFT + 12 - input bits) / R^N */
+    uint16_t decimation;                        /**< Rate change factor R */
+    uint16_t phase;                             /**< Input samples since the last output */
+    uint8_t order;                              /**< Number of stages N */
+} Filter_CICTypeDef;
+
+/**
+ * @brief Q15 FIR state
+ *
+ * @details The delay line is stored twice, so the newest `taps` samples are
+ *          always contiguous and the MAC loop needs no wrap check.
+ */
+typedef struct {
+    int16_t coeffs[FILTER_FIR_MAX_TAPS];        /**< Coefficients reversed, oldest sample first */
+    int16_t history[2 * FILTER_FIR_MAX_TAPS];   /**< Mirrored delay line */
+    uint16_t taps;                              /**< Filter length, rounded up to even */
+    uint16_t pos;                               /**< Index of the oldest sample in the window */
+} Filter_FIRTypeDef;
+
+/**
+ * @brief Complete filter chain with cycle accounting
+ */
+typedef struct {
+    Filter_CICTypeDef cic;      /**< First stage, decimates by R */
+    Filter_FIRTypeDef fir;      /**< Second stage, droop compensation */
+    int16_t latest;             /**< Most recent output sample */
+    uint32_t outputs;           /**< Total output samples since init */
+    uint32_t last_cycles;       /**< Core cycles spent on the last block */
+    uint32_t max_cycles;        /**< Worst block since init */
+    uint16_t last_samples;      /**< Input samples of the last block */
+} Filter_ChainTypeDef;
+
+/**
+ * @brief Default compensation FIR for a 3rd-order CIC (R >= 8)
+ *
+ * @details Flat within 0.1% up to 0.15 x output rate after the CIC droop,
+ *          -7dB at 0.25, -27dB at 0.3 and below -60dB from 0.4.
+ */
+extern const int16_t filter_cic3_comp_q15[FILTER_COMP_TAPS];
+
+/**
+ * @brief Initialize a filter chain
+ *
+ * @param chain Pointer to chain structure
+ * @param order CIC order N (1 to FILTER_CIC_MAX_ORDER)
+ * @param decimation CIC rate change R (R^N at most FILTER_CIC_MAX_GAIN, halved per extra input bit)
+ * @param input_bits Input resolution, FILTER_INPUT_BITS to FILTER_INPUT_MAX_BITS
+ * @param coeffs Q15 FIR coefficients, DC gain 32768 for unity
+ * @param taps Number of coefficients (1 to FILTER_FIR_MAX_TAPS)
+ * @return uint8_t 0 if successful, 1 if a parameter is out of range
+ *
+ * @note Also starts the DWT cycle counter used for per-block timing
+ */
+uint8_t filter_chain_init(Filter_ChainTypeDef *chain, uint8_t order, uint16_t decimation,
+                          uint8_t input_bits, const int16_t *coeffs, uint16_t taps);
+
+/**
+ * @brief Run a block of raw ADC samples through the chain
+ *
+ * @param chain Pointer to chain structure
+ * @param in Samples of the input resolution given at init
+ * @param length Number of input samples
+ * @param out Destination for decimated output samples, may be NULL
+ * @param out_max Capacity of out
+ * @return uint16_t Output samples written to out (all produced if out is NULL)
+ *
+ * @note Outputs beyond out_max are still filtered and update chain->latest
+ */
+uint16_t filter_chain_process(Filter_ChainTypeDef *chain, const volatile uint16_t *in, uint16_t length,
+                              int16_t *out, uint16_t out_max);
+
+/**
+ * @brief Get the CPU load of the last block
+ *
+ * @param chain Pointer to chain structure
+ * @param sample_rate_hz Input sample rate in Hz
+ * @return uint32_t Load in permille of the core clock, 0 if unknown
+ */
+uint32_t filter_chain_get_load_permille(const Filter_ChainTypeDef *chain, uint32_t sample_rate_hz);
+
+#endif /* FILTER_H */
@@ -0,0 +1,90 @@
+/**
+ ******************************************************************************
+ * @file           : inject.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-28
+ * @brief          : PWM-synchronized injected current sampling header
+ ******************************************************************************
+ * @details
+ * This file declares one current sample per PWM period, taken by the ADC1
+ * injected group at the center of the bridge on-time. Switching edges are as
+ * far away as possible there, so a single conversion is clean enough for a
+ * fast current loop. The regular group keeps streaming all scan channels to
+ * the sample pool. A PWM-timed injected conversion pre-empts it and the
+ * regular conversion it interrupts is restarted.
+ *
+ * Slow channels, such as the die temperature and VREFINT with their 10 us
+ * minimum sampling time, are converted on the same group through
+ * inject_convert(), so they never stretch the regular scan frame.
+ *
+ * The result is picked up in the JEOC interrupt, which shares ADC_IRQn with the
+ * analog watchdog at the highest priority. The delay from the trigger to that
+ * interrupt is measured in timer ticks on every sample.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef INJECT_H
+#define INJECT_H
+
+#include "stm32f407xx.h"
+
+#define INJECT_CONVERT_TIMEOUT  100000  /**< Polling rounds allowed for a borrowed conversion */
+
+/**
+ * @brief Latest synchronized current sample
+ */
+typedef struct {
+    uint32_t count;             /**< Samples since init (0 = none yet) */
+    uint16_t value;             /**< Raw ADC value of the newest sample */
+    uint16_t latency;           /**< Trigger to interrupt entry of the newest sample, PWM timer ticks */
+    uint16_t max_latency;       /**< Worst latency since init, PWM timer ticks */
+} Inject_SampleTypeDef;
+
+/**
+ * @brief Start PWM-synchronized sampling of one channel
+ *
+ * @param channel ADC1 channel carrying the motor current (ADC_CHANNEL_x)
+ * @param sampling_time Sample time selection (ADC_SAMPLETIME_xxx)
+ *
+ * @note Call after adc_init() and pwm_init(). Centers the sampling window on
+ *       the PWM valley by moving the trigger half a window ahead.
+ */
+void inject_init(uint32_t channel, uint32_t sampling_time);
+
+/**
+ * @brief Injected end-of-conversion handler (called from ADC_IRQHandler)
+ */
+void inject_irq_handler(void);
+
+/**
+ * @brief Convert one slow channel on the borrowed injected group
+ *
+ * @param channel ADC1 channel (ADC_CHANNEL_x)
+ * @param sampling_time Sample time selection (ADC_SAMPLETIME_xxx)
+ * @param value Destination for the raw result
+ * @return uint8_t 0 if successful, 1 if ADC1 is off or not set up, or on timeout
+ *
+ * @note Main loop only. Blocks for one conversion time, during which the
+ *       current loop misses its sample and regular triggers are dropped.
+ */
+uint8_t inject_convert(uint32_t channel, uint32_t sampling_time, uint16_t *value);
+
+/**
+ * @brief Copy the latest synchronized sample
+ *
+ * @param sample Destination
+ * @return uint8_t 1 if at least one sample was taken, 0 otherwise
+ */
+uint8_t inject_get(Inject_SampleTypeDef *sample);
+
+/**
+ * @brief Get the ADC time used by injected conversions
+ *
+ * @return uint32_t ADCCLK cycles per second taken from the regular group,
+ *         counting the regular conversion each one restarts
+ */
+uint32_t inject_get_adc_load(void);
+
+#endif /* INJECT_H */
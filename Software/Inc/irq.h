@@ -21,11 +21,20 @@
 /**
  * @brief DMA2 Stream 0 interrupt handler (ADC1 DMA)
  * 
- * This function is called when DMA completes transferring 50 ADC samples.
- * It automatically calculates the average and sets a ready flag.
+ * This function is called when DMA fills one double-buffer target. It swaps
+ * in a free pool buffer and queues the filled one for the main loop.
  */
 void DMA2_Stream0_IRQHandler(void);
 
+/**
+ * @brief ADC global interrupt handler (analog watchdog trip, injected sample)
+ * 
+ * This function is called when an ADC1 current conversion crosses the
+ * watchdog threshold, where it drops the motor enable line and records the
+ * trip, and when the PWM-synchronized injected conversion completes.
+ */
+void ADC_IRQHandler(void);
+
 /* External variables for ADC data */
 extern uint16_t adcBuffer[50];
 extern uint16_t adcAverage;
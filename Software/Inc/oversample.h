@@ -0,0 +1,71 @@
+/**
+ ******************************************************************************
+ * @file           : oversample.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-27
+ * @brief          : Oversample-and-decimate stage header
+ ******************************************************************************
+ * @details
+ * This file declares an oversampling stage for the current blocks. It sums
+ * 4^k consecutive samples and shifts the sum right by k, which gives k extra
+ * bits of resolution at 1/4^k of the input rate. It only works if the input
+ * noise covers at least one LSB. The shunt amplifier noise normally does.
+ *
+ * The output is a normal Current_BlockTypeDef whose resolution field carries
+ * the effective bit count. Consumers do not need to know whether the stage
+ * is active. With k = 0 blocks pass through unchanged.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef OVERSAMPLE_H
+#define OVERSAMPLE_H
+
+#include "stm32f407xx.h"
+#include "current.h"
+
+/**
+ * @name Oversampling Configuration Constants
+ * @{
+ */
+#define OVERSAMPLE_MAX_BITS     4       /**< Largest k: 256 samples per output, 16-bit results */
+/** @} */
+
+/**
+ * @brief Select the oversampling ratio
+ *
+ * @param extra_bits k, 0 (bypass) to OVERSAMPLE_MAX_BITS; the ratio is 4^k
+ * @param dither 1 to round with a pseudo-random offset, 0 to round to nearest
+ * @return uint8_t 0 if successful, 1 if extra_bits is out of range
+ *
+ * @note Discards a partly accumulated output sample
+ */
+uint8_t oversample_configure(uint8_t extra_bits, uint8_t dither);
+
+/**
+ * @brief Get the configured number of extra bits
+ *
+ * @return uint8_t k, 0 when the stage is bypassed
+ */
+uint8_t oversample_get_bits(void);
+
+/**
+ * @brief Get the configured rounding
+ *
+ * @return uint8_t 1 if dithered, 0 if rounded to nearest
+ */
+uint8_t oversample_get_dither(void);
+
+/**
+ * @brief Oversample one contiguous block
+ *
+ * @param in Single-channel block, e.g. from acquisition_split()
+ * @param out Decimated block, may be empty while the accumulator fills
+ *
+ * @note The accumulator carries over block boundaries. Output data stays valid
+ *       until the next call.
+ */
+void oversample_process(const Current_BlockTypeDef *in, Current_BlockTypeDef *out);
+
+#endif /* OVERSAMPLE_H */
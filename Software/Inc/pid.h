@@ -0,0 +1,216 @@
+/**
+ ******************************************************************************
+ * @file           : pid.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-09-02
+ * @brief          : PID controller library header
+ ******************************************************************************
+ * @details
+ * This file declares one PID controller in three number formats: Q15 and Q31
+ * fixed point for interrupt handlers, where the cycle count must not depend on
+ * the data and the FPU context should stay untouched, and float for code that
+ * already uses the FPU.
+ *
+ * All three are set up from the same float configuration. The fixed-point
+ * variants work on signals normalized to full scale, so 1.0 in the
+ * configuration is 32768 in Q15 and 2^31 in Q31. Gains are per update: ki is
+ * Ki * Ts and kd is Kd / Ts.
+ *
+ * Every variant has the same structure:
+ *   - proportional term on the error
+ *   - integral term with clamping or back-calculation anti-windup
+ *   - derivative term on the measurement, through a first-order low-pass, so
+ *     setpoint steps do not kick the output
+ *   - output limits followed by a slew limit
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef PID_H
+#define PID_H
+
+#include "stm32f407xx.h"
+
+/**
+ * @name PID Configuration Constants
+ * @{
+ */
+#define PID_ANTIWINDUP_CLAMP        0       /**< Stop integrating while the output is limited towards the error */
+#define PID_ANTIWINDUP_BACKCALC     1       /**< Bleed the integrator by kt times the limited-off output */
+#define PID_Q15_MAX_SHIFT           7       /**< Q15 gains up to 2^7 */
+#define PID_Q31_MAX_SHIFT           15      /**< Q31 gains up to 2^15 */
+/** @} */
+
+/**
+ * @brief Controller configuration, shared by all variants
+ */
+typedef struct {
+    float kp;                   /**< Proportional gain */
+    float ki;                   /**< Integral gain per update, Ki * Ts */
+    float kd;                   /**< Derivative gain per update, Kd / Ts */
+    float kt;                   /**< Back-calculation gain per update, PID_ANTIWINDUP_BACKCALC only */
+    float d_pole;               /**< Derivative low-pass pole, 0 for none, below 1 */
+    float out_min;              /**< Output lower limit, -1 to out_max in the fixed-point variants */
+    float out_max;              /**< Output upper limit, out_min to below 1 in the fixed-point variants */
+    float slew;                 /**< Largest output change per update, 0 for no limit */
+    uint8_t antiwindup;         /**< PID_ANTIWINDUP_xxx */
+} Pid_ConfigTypeDef;
+
+/**
+ * @brief Q15 controller state
+ *
+ * @details Gains are stored as k * 2^(15 - shift), with one shift shared by
+ *          all gains. The integrator keeps 8 bits below Q15.
+ */
+typedef struct {
+    int16_t kp, ki, kd, kt;     /**< Gains, scaled by 2^(15 - shift) */
+    int32_t beta;               /**< 1 - d_pole in Q15, up to 32768 */
+    uint8_t shift;              /**< Common gain exponent */
+    uint8_t antiwindup;         /**< PID_ANTIWINDUP_xxx */
+    int32_t out_min, out_max;   /**< Output limits in Q15 */
+    int32_t slew;               /**< Output step limit in Q15, 0 for none */
+    int32_t integral;           /**< Integral term in Q23 */
+    int32_t derivative;         /**< Filtered derivative term in Q15 */
+    int16_t last_measurement;   /**< Measurement of the previous update */
+    int16_t output;             /**< Output of the previous update */
+    uint8_t primed;             /**< 1 once last_measurement is valid */
+    uint8_t saturated;          /**< 1 if the last output was limited */
+} Pid_Q15TypeDef;
+
+/**
+ * @brief Q31 controller state
+ *
+ * @details Gains are stored as k * 2^(31 - shift). The integrator keeps 16
+ *          bits below Q31.
+ */
+typedef struct {
+    int32_t kp, ki, kd, kt;     /**< Gains, scaled by 2^(31 - shift) */
+    uint32_t beta;              /**< 1 - d_pole in Q31, up to 2^31 */
+    uint8_t shift;              /**< Common gain exponent */
+    uint8_t antiwindup;         /**< PID_ANTIWINDUP_xxx */
+    int64_t out_min, out_max;   /**< Output limits in Q31 */
+    int64_t slew;               /**< Output step limit in Q31, 0 for none */
+    int64_t integral;           /**< Integral term in Q47 */
+    int32_t derivative;         /**< Filtered derivative term in Q31 */
+    int32_t last_measurement;   /**< Measurement of the previous update */
+    int32_t output;             /**< Output of the previous update */
+    uint8_t primed;             /**< 1 once last_measurement is valid */
+    uint8_t saturated;          /**< 1 if the last output was limited */
+} Pid_Q31TypeDef;
+
+/**
+ * @brief Float controller state
+ */
+typedef struct {
+    Pid_ConfigTypeDef config;   /**< Gains and limits */
+    float beta;                 /**< 1 - d_pole */
+    float integral;             /**< Integral term */
+    float derivative;           /**< Filtered derivative term */
+    float last_measurement;     /**< Measurement of the previous update */
+    float output;               /**< Output of the previous update */
+    uint8_t primed;             /**< 1 once last_measurement is valid */
+    uint8_t saturated;          /**< 1 if the last output was limited */
+} Pid_F32TypeDef;
+
+/**
+ * @brief Cycles per update of each variant
+ */
+typedef struct {
+    uint32_t q15_cycles;        /**< Q15 update, worst case */
+    uint32_t q31_cycles;        /**< Q31 update, worst case */
+    uint32_t f32_cycles;        /**< Float update, worst case */
+    uint16_t updates;           /**< Updates timed per variant */
+} Pid_BenchmarkTypeDef;
+
+/**
+ * @brief Set up a Q15 controller
+ *
+ * @param pid Pointer to controller state
+ * @param config Configuration
+ * @return uint8_t 0 if successful, 1 if a gain or limit does not fit Q15
+ */
+uint8_t pid_q15_init(Pid_Q15TypeDef *pid, const Pid_ConfigTypeDef *config);
+
+/**
+ * @brief Clear the integrator, derivative and output history
+ *
+ * @param pid Pointer to controller state
+ */
+void pid_q15_reset(Pid_Q15TypeDef *pid);
+
+/**
+ * @brief Run one Q15 update
+ *
+ * @param pid Pointer to controller state
+ * @param setpoint Setpoint in Q15
+ * @param measurement Measurement in Q15
+ * @return int16_t Output in Q15
+ */
+int16_t pid_q15_update(Pid_Q15TypeDef *pid, int16_t setpoint, int16_t measurement);
+
+/**
+ * @brief Set up a Q31 controller
+ *
+ * @param pid Pointer to controller state
+ * @param config Configuration
+ * @return uint8_t 0 if successful, 1 if a gain or limit does not fit Q31
+ */
+uint8_t pid_q31_init(Pid_Q31TypeDef *pid, const Pid_ConfigTypeDef *config);
+
+/**
+ * @brief Clear the integrator, derivative and output history
+ *
+ * @param pid Pointer to controller state
+ */
+void pid_q31_reset(Pid_Q31TypeDef *pid);
+
+/**
+ * @brief Run one Q31 update
+ *
+ * @param pid Pointer to controller state
+ * @param setpoint Setpoint in Q31
+ * @param measurement Measurement in Q31
+ * @return int32_t Output in Q31
+ */
+int32_t pid_q31_update(Pid_Q31TypeDef *pid, int32_t setpoint, int32_t measurement);
+
+/**
+ * @brief Set up a float controller
+ *
+ * @param pid Pointer to controller state
+ * @param config Configuration
+ * @return uint8_t 0 if successful, 1 if the limits are inverted
+ */
+uint8_t pid_f32_init(Pid_F32TypeDef *pid, const Pid_ConfigTypeDef *config);
+
+/**
+ * @brief Clear the integrator, derivative and output history
+ *
+ * @param pid Pointer to controller state
+ */
+void pid_f32_reset(Pid_F32TypeDef *pid);
+
+/**
+ * @brief Run one float update
+ *
+ * @param pid Pointer to controller state
+ * @param setpoint Setpoint
+ * @param measurement Measurement
+ * @return float Output
+ */
+float pid_f32_update(Pid_F32TypeDef *pid, float setpoint, float measurement);
+
+/**
+ * @brief Time the three variants on the same input sequence
+ *
+ * @param config Configuration used for all three
+ * @param updates Updates to time per variant
+ * @param result Destination
+ * @return uint8_t 0 if successful, 1 if the configuration is invalid
+ *
+ * @note Uses the DWT cycle counter, all cycle counts read 0 off target
+ */
+uint8_t pid_benchmark(const Pid_ConfigTypeDef *config, uint16_t updates, Pid_BenchmarkTypeDef *result);
+
+#endif /* PID_H */
@@ -0,0 +1,165 @@
+/**
+ ******************************************************************************
+ * @file           : profile.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-09-04
+ * @brief          : Jerk-limited motion profile generator header
+ ******************************************************************************
+ * @details
+ * This file declares the setpoint generator that sits between the user
+ * setpoints and the control cascade. Instead of passing a new speed or
+ * position on as a step, it moves its reference there with limited speed,
+ * acceleration and jerk, so the current drawn to accelerate the motor rises
+ * and falls gradually and stays clear of the protection limits.
+ *
+ * The profile is advanced by one tick per call from the control interrupt,
+ * in fixed point, with a bounded number of operations. It
+ * holds no precomputed trajectory, so a target that changes mid-move simply
+ * changes the next tick's decision: the reference bends towards the new
+ * target from its present speed and acceleration, without any jump.
+ *
+ * Targets are single 32-bit words written from the main loop. The state,
+ * including the progress of the current move, is read back through a
+ * sequence-counted copy.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "stm32f407xx.h"
+
+#define PROFILE_FRACTION_BITS_MAX   20  /**< Most fraction bits of the internal counts-per-tick units */
+#define PROFILE_FRACTION_BITS_MIN   8   /**< Fewest, below this the jerk step gets coarse */
+
+/**
+ * @brief What the profile moves towards
+ */
+typedef enum {
+    PROFILE_MODE_SPEED = 0,     /**< Speed target, position follows freely */
+    PROFILE_MODE_POSITION       /**< Position target, arriving at standstill */
+} Profile_ModeTypeDef;
+
+/**
+ * @brief Limits and units
+ */
+typedef struct {
+    uint32_t rate_hz;           /**< Rate of profile_update() calls */
+    uint16_t counts_per_rev;    /**< Encoder counts per revolution */
+    int32_t max_speed_mrpm;     /**< Speed limit, 0.001 RPM */
+    uint32_t max_accel_rpm_s;   /**< Acceleration limit, RPM per second */
+    uint32_t max_jerk_rpm_s2;   /**< Jerk limit, RPM per second squared */
+} Profile_InitTypeDef;
+
+/**
+ * @brief Generator state
+ *
+ * @details Internally position is in counts, speed in counts per tick and so
+ *          on, all with fraction_bits fraction bits. profile_init() picks the
+ *          most the limits allow, so a fine encoder trades fraction bits for
+ *          range.
+ */
+typedef struct {
+    /* Limits, in internal units */
+    uint8_t fraction_bits;      /**< Fraction bits of the internal units */
+    int32_t v_max;              /**< Speed limit */
+    int32_t a_max;              /**< Acceleration limit */
+    int32_t j_max;              /**< Jerk limit */
+    uint32_t to_mrpm_q8;        /**< mRPM per count per tick, Q8 */
+    uint32_t from_mrpm_q16;     /**< Internal speed per mRPM, Q16 */
+
+    /* Targets, written by the main loop */
+    volatile int32_t target_mrpm;   /**< Speed target */
+    volatile int32_t target_counts; /**< Position target */
+
+    /* Reference, advanced by profile_update() */
+    int64_t position;           /**< Reference position */
+    int32_t velocity;           /**< Reference speed */
+    int32_t accel;              /**< Reference acceleration */
+    int32_t position_counts;    /**< Reference position in counts */
+    int32_t speed_mrpm;         /**< Reference speed in 0.001 RPM */
+
+    /* Progress of the move towards the latest target */
+    Profile_ModeTypeDef mode;   /**< Mode of the last update */
+    int32_t planned;            /**< Target the move was planned for */
+    int64_t goal;               /**< That target in internal units */
+    int64_t start;              /**< Position or speed where the move began */
+    uint8_t moving;             /**< 1 until the reference has settled on the target */
+    uint32_t moves;             /**< Moves completed */
+    volatile uint32_t updates;  /**< Updates since profile_reset(), the sequence for readers */
+} Profile_HandleTypeDef;
+
+/**
+ * @brief Progress snapshot
+ */
+typedef struct {
+    Profile_ModeTypeDef mode;   /**< Mode of the last update */
+    uint8_t moving;             /**< 1 while moving towards the target */
+    int32_t target;             /**< Target in mRPM or counts */
+    int32_t position_counts;    /**< Reference position in counts */
+    int32_t speed_mrpm;         /**< Reference speed in 0.001 RPM */
+    uint16_t progress_permille; /**< Share of the move done, 1000 once settled */
+    uint32_t moves;             /**< Moves completed */
+} Profile_StatusTypeDef;
+
+/**
+ * @brief Set the limits and units of a profile
+ *
+ * @param profile Pointer to profile handle
+ * @param init Limits and units
+ * @return uint8_t 0 if successful, 1 if the limits are out of range
+ *
+ * @note Leaves the profile at rest at position 0, call profile_reset() to
+ *       start it elsewhere
+ */
+uint8_t profile_init(Profile_HandleTypeDef *profile, const Profile_InitTypeDef *init);
+
+/**
+ * @brief Restart the reference from a measured state
+ *
+ * @param profile Pointer to profile handle
+ * @param position Position in counts
+ * @param speed_mrpm Speed in 0.001 RPM
+ *
+ * @note Call from the context that calls profile_update(). Acceleration
+ *       starts at zero.
+ */
+void profile_reset(Profile_HandleTypeDef *profile, int32_t position, int32_t speed_mrpm);
+
+/**
+ * @brief Advance the reference by one tick
+ *
+ * @param profile Pointer to profile handle
+ * @param mode Target to move towards
+ *
+ * @note Updates position_counts and speed_mrpm
+ */
+void profile_update(Profile_HandleTypeDef *profile, Profile_ModeTypeDef mode);
+
+/**
+ * @brief Set the speed target
+ *
+ * @param profile Pointer to profile handle
+ * @param mrpm Target in 0.001 RPM, limited to the speed limit
+ */
+void profile_set_speed_target(Profile_HandleTypeDef *profile, int32_t mrpm);
+
+/**
+ * @brief Set the position target
+ *
+ * @param profile Pointer to profile handle
+ * @param counts Target in counts
+ */
+void profile_set_position_target(Profile_HandleTypeDef *profile, int32_t counts);
+
+/**
+ * @brief Copy the progress of the current move
+ *
+ * @param profile Pointer to profile handle
+ * @param status Destination
+ */
+void profile_get_status(Profile_HandleTypeDef *profile, Profile_StatusTypeDef *status);
+
+#endif /* PROFILE_H */
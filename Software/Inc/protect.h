@@ -0,0 +1,80 @@
+/**
+ ******************************************************************************
+ * @file           : protect.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-24
+ * @brief          : Analog watchdog overcurrent trip header
+ ******************************************************************************
+ * @details
+ * This file declares the first-layer overcurrent protection. The ADC1 analog
+ * watchdog compares every current conversion against a threshold in hardware.
+ * Its interrupt drops the motor enable line within microseconds of a single bad
+ * sample, without waiting for a DMA block or the main loop. The sliding-average
+ * check in current_handler() remains as a second layer.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef PROTECT_H
+#define PROTECT_H
+
+#include "stm32f407xx.h"
+
+/**
+ * @brief Overcurrent trip record, captured inside the watchdog interrupt
+ */
+typedef struct {
+    uint32_t count;             /**< Number of trips since power-up (0 = never tripped) */
+    uint32_t timestamp_us;      /**< systick_get_us() at the trip */
+    uint32_t sequence;          /**< Newest published pipeline sequence at the trip */
+    uint16_t index;             /**< Position of the sample in current_adcBuffer */
+    uint16_t value;             /**< Raw ADC value of the offending sample */
+} Protect_TripTypeDef;
+
+/**
+ * @brief Arm the analog watchdog on the current channel
+ *
+ * @param channel ADC1 channel carrying the motor current (ADC_CHANNEL_x)
+ * @param threshold High threshold in raw ADC counts
+ *
+ * @note Call after ADC1 has been configured; adc_init() clears the watchdog.
+ *       A latched trip stays latched, only protect_rearm() clears it.
+ */
+void protect_init(uint32_t channel, uint16_t threshold);
+
+/**
+ * @brief Move the trip threshold without touching the trip state
+ *
+ * @param threshold High threshold in raw ADC counts
+ */
+void protect_set_threshold(uint16_t threshold);
+
+/**
+ * @brief Analog watchdog interrupt handler (called from ADC_IRQHandler)
+ */
+void protect_irq_handler(void);
+
+/**
+ * @brief Check whether the trip is latched
+ *
+ * @return uint8_t 1 if tripped and not yet re-armed, 0 otherwise
+ */
+uint8_t protect_is_tripped(void);
+
+/**
+ * @brief Copy the most recent trip record
+ *
+ * @param trip Destination record
+ * @return uint8_t 1 if at least one trip occurred, 0 otherwise
+ */
+uint8_t protect_get_trip(Protect_TripTypeDef *trip);
+
+/**
+ * @brief Clear the latched trip and re-enable the watchdog interrupt
+ *
+ * @note Does not re-enable the motor; the enable line is left to the caller
+ */
+void protect_rearm(void);
+
+#endif /* PROTECT_H */
@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ * @file           : pwm.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-28
+ * @brief          : Motor bridge PWM header
+ ******************************************************************************
+ * @details
+ * This file declares the center-aligned PWM that drives the motor bridge
+ * inputs. The positive input gets the duty cycle for forward drive and the
+ * negative input for reverse; the other input is held low. In center-aligned
+ * mode every on-time is centered on the counter valley, which is also where
+ * the injected current sample is taken. A third compare channel without an
+ * output pin produces that ADC trigger a programmable lead before the valley.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef PWM_H
+#define PWM_H
+
+#include "stm32f407xx.h"
+
+/**
+ * @brief Start the bridge PWM
+ *
+ * @param freq_hz PWM frequency in Hz (one full up/down counter cycle)
+ * @return uint32_t Achieved frequency in Hz, 0 if it cannot be generated
+ *
+ * @note Starts at full forward duty, the same drive as the former static pin levels
+ */
+uint32_t pwm_init(uint32_t freq_hz);
+
+/**
+ * @brief Set the signed bridge duty cycle
+ *
+ * @param duty Q15 duty, positive drives the P input, negative the M input
+ */
+void pwm_set_duty(int16_t duty);
+
+/**
+ * @brief Get the signed bridge duty cycle
+ *
+ * @return int16_t Q15 duty as last set
+ */
+int16_t pwm_get_duty(void);
+
+/**
+ * @brief Place the ADC trigger ahead of the counter valley
+ *
+ * @param ticks Timer ticks before the valley, at least 1
+ */
+void pwm_set_trigger_lead(uint16_t ticks);
+
+/**
+ * @brief Get the PWM frequency
+ *
+ * @return uint32_t Frequency in Hz, 0 before pwm_init()
+ */
+uint32_t pwm_get_frequency(void);
+
+/**
+ * @brief Get the time elapsed since the last ADC trigger
+ *
+ * @return uint16_t Timer ticks since the trigger, valid within half a PWM period
+ *
+ * @note Intended for latency measurement inside the injected conversion interrupt
+ */
+uint16_t pwm_get_ticks_since_trigger(void);
+
+#endif /* PWM_H */
@@ -0,0 +1,151 @@
+/**
+ ******************************************************************************
+ * @file           : scope.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-29
+ * @brief          : Pre/post-trigger transient recorder header
+ ******************************************************************************
+ * @details
+ * This file declares a transient recorder for the raw current samples. While
+ * armed it keeps a rolling history of the newest samples. A trigger marks one
+ * sample. The recorder then takes a configurable number of further samples and
+ * freezes, so the record holds the waveform before and after the event until
+ * it is read out and re-armed.
+ *
+ * Triggers come from the software current limit, the analog watchdog trip, a
+ * button or a UART command. A watchdog trip is located at its exact sample
+ * through the block sequence and frame reported by the protection module.
+ *
+ * The record lives in CCM RAM. Nothing else uses that memory, and DMA cannot
+ * reach it, so the capture never takes SRAM from the sample pool. Samples are
+ * copied in by the CPU from blocks that are already in the pipeline.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef SCOPE_H
+#define SCOPE_H
+
+#include "stm32f407xx.h"
+#include "current.h"
+
+#define SCOPE_RECORD_SIZE       16384   /**< Samples in the record, power of two (32 KB of CCM RAM) */
+#define SCOPE_TEXT_SAMPLES      8       /**< Samples per line of text readout */
+#define SCOPE_TEXT_SIZE         96      /**< Buffer size that fits any readout line */
+
+/**
+ * @brief Recorder state
+ */
+typedef enum {
+    SCOPE_STATE_ARMED = 0,      /**< Recording the pre-trigger history */
+    SCOPE_STATE_TRIGGERED,      /**< Recording the post-trigger window */
+    SCOPE_STATE_FROZEN          /**< Record complete, ready for readout */
+} Scope_StateTypeDef;
+
+/**
+ * @brief Trigger source
+ */
+typedef enum {
+    SCOPE_SOURCE_NONE = 0,
+    SCOPE_SOURCE_THRESHOLD,     /**< Window mean above CURRENT_CRITICAL_THRESHOLD_MA */
+    SCOPE_SOURCE_WATCHDOG,      /**< Analog watchdog trip */
+    SCOPE_SOURCE_BUTTON,        /**< User button */
+    SCOPE_SOURCE_COMMAND        /**< UART command */
+} Scope_SourceTypeDef;
+
+/**
+ * @brief Description of a frozen record
+ */
+typedef struct {
+    uint32_t count;             /**< Records frozen since power-up */
+    Scope_SourceTypeDef source; /**< What triggered the record */
+    uint32_t sequence;          /**< Pool block holding the trigger sample */
+    uint32_t sample_rate_hz;    /**< Frame rate at trigger time */
+    uint16_t length;            /**< Samples in the record */
+    uint16_t pre;               /**< Samples before the trigger sample */
+    uint8_t resolution;         /**< Significant bits per sample */
+} Scope_RecordTypeDef;
+
+/**
+ * @brief Start a new record
+ *
+ * @param post_samples Samples to take after the trigger, including the trigger
+ *                     sample, 1 to SCOPE_RECORD_SIZE
+ *
+ * @note Discards a frozen record. The pre-trigger history restarts empty.
+ */
+void scope_arm(uint16_t post_samples);
+
+/**
+ * @brief Append the samples of one single-channel block
+ *
+ * @param block Current block, e.g. from acquisition_split()
+ */
+void scope_push_block(const Current_BlockTypeDef *block);
+
+/**
+ * @brief Trigger on the next sample
+ *
+ * @param source Trigger source
+ *
+ * @note Ignored unless the recorder is armed
+ */
+void scope_trigger(Scope_SourceTypeDef source);
+
+/**
+ * @brief Trigger on a sample that may still be in flight
+ *
+ * @param source Trigger source
+ * @param sequence Pool block sequence number holding the trigger sample
+ * @param frame Frame index of the trigger sample within that block
+ *
+ * @note Ignored unless the recorder is armed. Falls back to the first sample
+ *       of a later block if the given block never arrives.
+ */
+void scope_trigger_at(Scope_SourceTypeDef source, uint32_t sequence, uint16_t frame);
+
+/**
+ * @brief Get the recorder state
+ *
+ * @return Scope_StateTypeDef Current state
+ */
+Scope_StateTypeDef scope_get_state(void);
+
+/**
+ * @brief Describe the frozen record
+ *
+ * @param record Destination
+ * @return uint8_t 1 if a record is frozen, 0 otherwise
+ */
+uint8_t scope_get_record(Scope_RecordTypeDef *record);
+
+/**
+ * @brief Copy samples out of the frozen record
+ *
+ * @param offset First sample, 0 is the oldest
+ * @param dst Destination
+ * @param count Samples requested
+ * @return uint16_t Samples copied, 0 past the end or while not frozen
+ */
+uint16_t scope_read(uint16_t offset, uint16_t *dst, uint16_t count);
+
+/**
+ * @brief Format the record description as one line of text
+ *
+ * @param text Destination, at least SCOPE_TEXT_SIZE bytes
+ * @return uint16_t Characters written, 0 while not frozen
+ */
+uint16_t scope_format_header(char *text);
+
+/**
+ * @brief Format up to SCOPE_TEXT_SAMPLES samples as one line of text
+ *
+ * @param offset First sample, 0 is the oldest
+ * @param text Destination, at least SCOPE_TEXT_SIZE bytes
+ * @param consumed Receives the number of samples formatted
+ * @return uint16_t Characters written, 0 past the end or while not frozen
+ */
+uint16_t scope_format_samples(uint16_t offset, char *text, uint16_t *consumed);
+
+#endif /* SCOPE_H */
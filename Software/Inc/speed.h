@@ -0,0 +1,87 @@
+/**
+ ******************************************************************************
+ * @file           : speed.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-09-01
+ * @brief          : Closed-loop motor speed control header
+ ******************************************************************************
+ * @details
+ * This file declares the PI speed loop, the middle level of the control
+ * cascade. It runs at SPEED_LOOP_RATE_HZ from the observer timer interrupt,
+ * compares the observer speed with the setpoint and writes the current
+ * setpoint of the current loop. The setpoint comes from the position loop,
+ * or from the buttons and UART commands in speed mode.
+ *
+ * The loop is switched on and off by control_set_mode(). While the bridge is
+ * disabled or the overcurrent trip is latched, it holds a zero current
+ * setpoint and an empty integrator, and a restart begins from standstill.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef SPEED_H
+#define SPEED_H
+
+#include "stm32f407xx.h"
+#include "encoder.h"
+
+/**
+ * @brief Speed loop state, as seen by the last loop update
+ */
+typedef struct {
+    int32_t target_mrpm;        /**< Setpoint in 0.001 RPM */
+    int32_t measured_mrpm;      /**< Observer speed in 0.001 RPM */
+    int32_t current_ma;         /**< Current setpoint written, mA */
+    uint8_t enabled;            /**< 1 while the loop drives the current setpoint */
+    uint8_t saturated;          /**< 1 while the current setpoint is at the limit */
+    uint32_t updates;           /**< Loop updates since speed_init() */
+} Speed_StatusTypeDef;
+
+/**
+ * @brief Set up the speed loop, initially off
+ *
+ * @param encoder Encoder whose observer provides the speed
+ * @param call_rate_hz Rate at which speed_irq_handler() will be called, a
+ *                     multiple of SPEED_LOOP_RATE_HZ
+ * @return uint8_t 0 if successful, 1 if the rate is too low
+ */
+uint8_t speed_init(Encoder_HandleTypeDef *encoder, uint32_t call_rate_hz);
+
+/**
+ * @brief Speed loop update (called from control_irq_handler())
+ */
+void speed_irq_handler(void);
+
+/**
+ * @brief Turn the closed loop on or off
+ *
+ * @param enable 1 to drive the current setpoint from the loop, 0 to leave it alone
+ */
+void speed_enable(uint8_t enable);
+
+/**
+ * @brief Set the speed setpoint
+ *
+ * @param mrpm Setpoint in 0.001 RPM, limited to +-SPEED_MAX_MRPM
+ *
+ * @note Written by control_irq_handler() while the loop is on, set targets
+ *       with control_set_speed_target() instead
+ */
+void speed_set_target(int32_t mrpm);
+
+/**
+ * @brief Get the speed setpoint
+ *
+ * @return int32_t Setpoint in 0.001 RPM
+ */
+int32_t speed_get_target(void);
+
+/**
+ * @brief Copy the loop state
+ *
+ * @param status Destination
+ */
+void speed_get_status(Speed_StatusTypeDef *status);
+
+#endif /* SPEED_H */
@@ -0,0 +1,159 @@
+/**
+ ******************************************************************************
+ * @file           : stats.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-21
+ * @brief          : Streaming sample statistics header
+ ******************************************************************************
+ * @details
+ * This file declares a sliding-window statistics stage for ADC samples. The
+ * window keeps a running sum plus monotonic min/max queues, so each new sample
+ * costs O(1) amortized regardless of the window length.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "stm32f407xx.h"
+
+/**
+ * @name Statistics Configuration Constants
+ * @{
+ */
+#define STATS_WINDOW_MAX        4096    /**< Maximum window length, must be a power of two */
+#define STATS_WINDOW_MASK       (STATS_WINDOW_MAX - 1)
+#define STATS_BLOCK_FRAC_BITS   4       /**< Fractional bits of block mean and RMS */
+/** @} */
+
+/**
+ * @brief SIMD kernel selection, 1 when the core has the DSP extension
+ */
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#define STATS_USE_SIMD          1
+#else
+#define STATS_USE_SIMD          0
+#endif
+
+/**
+ * @brief Sliding-window statistics structure
+ *
+ * @details Sample history is indexed by the absolute sample position masked to
+ *          the storage size. The min/max queues store 16-bit positions whose
+ *          samples are monotonic, front element being the current extremum.
+ */
+typedef struct {
+    uint16_t samples[STATS_WINDOW_MAX];     /**< Sample history ring */
+    uint16_t min_queue[STATS_WINDOW_MAX];   /**< Positions of increasing samples */
+    uint16_t max_queue[STATS_WINDOW_MAX];   /**< Positions of decreasing samples */
+    uint16_t min_head;                      /**< Index of oldest entry in min_queue */
+    uint16_t min_size;                      /**< Number of entries in min_queue */
+    uint16_t max_head;                      /**< Index of oldest entry in max_queue */
+    uint16_t max_size;                      /**< Number of entries in max_queue */
+    uint32_t position;                      /**< Total samples pushed since init */
+    uint32_t window;                        /**< Configured window length */
+    uint32_t count;                         /**< Samples currently inside the window */
+    uint32_t sum;                           /**< Running sum of samples inside the window */
+} Stats_WindowTypeDef;
+
+/**
+ * @brief Per-block statistics snapshot
+ *
+ * @details Mean and RMS carry STATS_BLOCK_FRAC_BITS fractional bits, so ripple
+ *          of a few counts is still resolved. An oversampled source fills
+ *          those bits with real resolution. RMS is the AC part only, i.e. the
+ *          standard deviation about the block mean.
+ */
+typedef struct {
+    uint32_t sequence;          /**< Pipeline sequence of the source block */
+    uint16_t length;            /**< Samples in the block */
+    uint16_t mean;              /**< DC mean, counts << STATS_BLOCK_FRAC_BITS */
+    uint16_t rms;               /**< AC RMS, counts << STATS_BLOCK_FRAC_BITS */
+    uint16_t min;               /**< Smallest sample, counts */
+    uint16_t max;               /**< Largest sample, counts */
+    uint16_t peak_to_peak;      /**< max - min, counts */
+    uint16_t crest;             /**< Peak deviation from mean / RMS, Q8 (256 = 1.0), 0 if RMS is 0 */
+    uint8_t extra_bits;         /**< Oversampling k of the source, min and max are in 2^-k counts */
+} Stats_BlockTypeDef;
+
+/**
+ * @brief Initialize a sliding window
+ *
+ * @param win Pointer to window structure
+ * @param window Window length in samples (1 to STATS_WINDOW_MAX, clamped)
+ */
+void stats_window_init(Stats_WindowTypeDef *win, uint32_t window);
+
+/**
+ * @brief Push a block of new samples into the window
+ *
+ * @param win Pointer to window structure
+ * @param data Pointer to new samples
+ * @param length Number of new samples
+ *
+ * @note Cost is proportional to length only, never to the window size
+ */
+void stats_window_push_block(Stats_WindowTypeDef *win, const volatile uint16_t *data, uint16_t length);
+
+/**
+ * @brief Get the mean of the samples in the window
+ *
+ * @param win Pointer to window structure
+ * @return uint16_t Mean value, 0 if the window is empty
+ */
+uint16_t stats_window_mean(const Stats_WindowTypeDef *win);
+
+/**
+ * @brief Get the minimum sample in the window
+ *
+ * @param win Pointer to window structure
+ * @return uint16_t Minimum value, 0 if the window is empty
+ */
+uint16_t stats_window_min(const Stats_WindowTypeDef *win);
+
+/**
+ * @brief Get the maximum sample in the window
+ *
+ * @param win Pointer to window structure
+ * @return uint16_t Maximum value, 0 if the window is empty
+ */
+uint16_t stats_window_max(const Stats_WindowTypeDef *win);
+
+/**
+ * @brief Get the number of samples currently in the window
+ *
+ * @param win Pointer to window structure
+ * @return uint32_t Sample count (saturates at the window length)
+ */
+uint32_t stats_window_count(const Stats_WindowTypeDef *win);
+
+/**
+ * @brief Compute mean, AC RMS, peak-to-peak and crest factor of one block
+ *
+ * @param result Snapshot to fill (sequence is left to the caller)
+ * @param data Samples, at most 12 bits each
+ * @param length Number of samples
+ *
+ * @note One pass over the data plus a fixed 32-step square root, no allocation.
+ *       The block must not change while it is processed.
+ */
+void stats_block_compute(Stats_BlockTypeDef *result, const volatile uint16_t *data, uint16_t length);
+
+/**
+ * @brief Compute the block statistics of an oversampled stream
+ *
+ * @param result Snapshot to fill (sequence is left to the caller)
+ * @param data Samples with extra_bits more bits than the raw 12
+ * @param length Number of samples
+ * @param extra_bits Oversampling k, at most STATS_BLOCK_FRAC_BITS
+ *
+ * @note Mean and RMS come out in raw counts << STATS_BLOCK_FRAC_BITS, the
+ *       same scale as stats_block_compute(), with the extra bits filling the
+ *       fraction.
+ */
+void stats_block_compute_oversampled(Stats_BlockTypeDef *result, const volatile uint16_t *data,
+                                     uint16_t length, uint8_t extra_bits);
+
+#endif /* STATS_H */
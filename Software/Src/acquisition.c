@@ -0,0 +1,277 @@
+/**
+ ******************************************************************************
+ * @file           : acquisition.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-22
+ * @brief          : Multi-channel ADC scan acquisition implementation
+ ******************************************************************************
+ * @details
+ * This file implements the scan-mode acquisition engine. With N channels in
+ * the table, every trigger converts one frame of N ranks and DMA stores it as
+ * N consecutive halfwords. Splitting walks each block once, frame by frame,
+ * appending every rank to its own ring buffer.
+ *
+ * Slow channels follow the regular ranks in the ring numbering. Each call of
+ * acquisition_sample_slow() converts every one of them once on the borrowed
+ * injected group and appends the result to its ring.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include "bsp.h"
+
+/* Active scan table and per-rank rings */
+static Acquisition_ChannelTypeDef acquisition_table[ACQUISITION_MAX_CHANNELS];
+static uint8_t acquisition_count = 0;
+static uint32_t acquisition_frame_cycles = 0;
+static uint32_t acquisition_rank_cycles = 0;    /* Longest single rank */
+static Acquisition_ChannelTypeDef acquisition_slow[ACQUISITION_MAX_CHANNELS];
+static uint8_t acquisition_slow_count = 0;
+static uint8_t acquisition_temp_vref = 0;   /* Bit 0: regular table, bit 1: slow table uses channel 16/17 */
+static Acquisition_RingTypeDef acquisition_rings[ACQUISITION_MAX_CHANNELS];
+
+/* Contiguous copy of the current rank for multi-channel tables */
+static uint16_t acquisition_current[CURRENT_ADC_BLOCK_SIZE];
+
+/**
+ * @brief Set up the analog input of a table entry
+ *
+ * @param channel Table entry
+ * @return uint8_t 1 if the entry is the temperature sensor or VREFINT
+ */
+static uint8_t acquisition_input_init(const Acquisition_ChannelTypeDef *channel)
+{
+    /* External inputs need analog mode, internal ones need TSVREFE */
+    if (channel->GPIOx != NULL) {
+        gpio_init(channel->GPIOx, channel->pin, GPIO_MODE_ANALOG, 0, 0, GPIO_NOPULL);
+    }
+
+    return (channel->Channel == ADC_CHANNEL_16 || channel->Channel == ADC_CHANNEL_17) ? 1 : 0;
+}
+
+/**
+ * @brief Switch TSVREFE to match both tables
+ */
+static void acquisition_update_temp_vref(void)
+{
+    if (acquisition_temp_vref) {
+        adc_enable_temp_vref();
+    } else {
+        adc_disable_temp_vref();
+    }
+}
+
+/**
+ * @brief Configure ADC1 regular sequence and analog inputs from a channel table
+ *
+ * @param table Channel table, entry 0 must be the motor current channel
+ * @param count Number of entries (1 to ACQUISITION_MAX_CHANNELS)
+ * @return uint8_t 0 if successful, 1 if the table is invalid
+ */
+uint8_t acquisition_configure(const Acquisition_ChannelTypeDef *table, uint8_t count)
+{
+    ADC_ChannelConfTypeDef sequence[ACQUISITION_MAX_CHANNELS];
+    uint8_t need_temp_vref = 0;
+
+    if (!table || count == 0 || count + acquisition_slow_count > ACQUISITION_MAX_CHANNELS) {
+        return 1;
+    }
+
+    acquisition_frame_cycles = 0;
+    acquisition_rank_cycles = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        acquisition_table[i] = table[i];
+        need_temp_vref |= acquisition_input_init(&table[i]);
+
+        sequence[i].Channel = table[i].Channel;
+        sequence[i].Rank = i + 1;
+        sequence[i].SamplingTime = table[i].SamplingTime;
+        acquisition_frame_cycles += adc_get_conversion_cycles(ADC1, table[i].SamplingTime);
+        if (adc_get_conversion_cycles(ADC1, table[i].SamplingTime) > acquisition_rank_cycles) {
+            acquisition_rank_cycles = adc_get_conversion_cycles(ADC1, table[i].SamplingTime);
+        }
+    }
+    acquisition_count = count;
+
+    /* Slow rings move up behind the new regular ranks */
+    for (uint8_t i = 0; i < count + acquisition_slow_count; i++) {
+        acquisition_rings[i].head = 0;
+    }
+
+    acquisition_temp_vref = (uint8_t)((acquisition_temp_vref & 2) | need_temp_vref);
+    acquisition_update_temp_vref();
+
+    return adc_config_sequence(ADC1, sequence, count);
+}
+
+/**
+ * @brief Register the channels converted outside the regular sequence
+ *
+ * @param table Channel table, ring i of this table is regular count + i
+ * @param count Number of entries, 0 to remove all
+ * @return uint8_t 0 if successful, 1 if the table is invalid
+ */
+uint8_t acquisition_configure_slow(const Acquisition_ChannelTypeDef *table, uint8_t count)
+{
+    uint8_t need_temp_vref = 0;
+
+    if ((count != 0 && !table) || acquisition_count + count > ACQUISITION_MAX_CHANNELS) {
+        return 1;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        acquisition_slow[i] = table[i];
+        need_temp_vref |= acquisition_input_init(&table[i]);
+        acquisition_rings[acquisition_count + i].head = 0;
+    }
+    acquisition_slow_count = count;
+
+    acquisition_temp_vref = (uint8_t)((acquisition_temp_vref & 1) | (need_temp_vref << 1));
+    acquisition_update_temp_vref();
+
+    return 0;
+}
+
+/**
+ * @brief Convert every slow channel once into its ring
+ *
+ * @return uint8_t Number of channels converted
+ */
+uint8_t acquisition_sample_slow(void)
+{
+    uint8_t converted = 0;
+    uint16_t value;
+
+    for (uint8_t i = 0; i < acquisition_slow_count; i++) {
+        Acquisition_RingTypeDef *ring = &acquisition_rings[acquisition_count + i];
+
+        if (inject_convert(acquisition_slow[i].Channel, acquisition_slow[i].SamplingTime, &value) == 0) {
+            ring->data[ring->head++ & ACQUISITION_RING_MASK] = value;
+            converted++;
+        }
+    }
+
+    return converted;
+}
+
+/**
+ * @brief Get the number of channels in the active scan table
+ *
+ * @return uint8_t Channels per frame
+ */
+uint8_t acquisition_get_channel_count(void)
+{
+    return acquisition_count;
+}
+
+/**
+ * @brief Get the ADCCLK cycles needed to convert one complete frame
+ *
+ * @return uint32_t Sum of conversion cycles over all ranks
+ */
+uint32_t acquisition_get_frame_cycles(void)
+{
+    return acquisition_frame_cycles;
+}
+
+/**
+ * @brief Get the ADCCLK cycles of the slowest rank
+ *
+ * @return uint32_t Largest conversion time in the regular sequence
+ */
+uint32_t acquisition_get_rank_cycles(void)
+{
+    return acquisition_rank_cycles;
+}
+
+/**
+ * @brief Split an interleaved DMA block into per-channel rings
+ *
+ * @param raw Block from current_pipeline_get() (interleaved frames)
+ * @param current Filled with a contiguous block of rank 0 (current) samples
+ */
+void acquisition_split(const Current_BlockTypeDef *raw, Current_BlockTypeDef *current)
+{
+    uint8_t channels = raw->channels;
+    uint16_t frames = raw->length / channels;
+    const volatile uint16_t *frame = raw->data;
+
+    /* Single channel: rank 0 is already contiguous, only feed its ring */
+    if (channels == 1) {
+        Acquisition_RingTypeDef *ring = &acquisition_rings[0];
+        for (uint16_t f = 0; f < frames; f++) {
+            ring->data[ring->head++ & ACQUISITION_RING_MASK] = frame[f];
+        }
+        *current = *raw;
+        return;
+    }
+
+    for (uint16_t f = 0; f < frames; f++, frame += channels) {
+        acquisition_current[f] = frame[0];
+        for (uint8_t r = 0; r < channels; r++) {
+            Acquisition_RingTypeDef *ring = &acquisition_rings[r];
+            ring->data[ring->head++ & ACQUISITION_RING_MASK] = frame[r];
+        }
+    }
+
+    current->data = acquisition_current;
+    current->length = frames;
+    current->channels = 1;
+    current->buffer = CURRENT_BUFFER_NONE;  /* Copy, the pool buffer stays with raw */
+    current->resolution = raw->resolution;
+    current->sequence = raw->sequence;
+}
+
+/**
+ * @brief Get the newest sample of a rank
+ *
+ * @param rank Position in the scan table (0 = current), slow channels following
+ * @return uint16_t Latest raw sample, 0 if the rank is invalid or empty
+ */
+uint16_t acquisition_get_latest(uint8_t rank)
+{
+    if (rank >= acquisition_count + acquisition_slow_count || acquisition_rings[rank].head == 0) return 0;
+
+    return acquisition_rings[rank].data[(acquisition_rings[rank].head - 1) & ACQUISITION_RING_MASK];
+}
+
+/**
+ * @brief Copy the newest samples of a rank, oldest first
+ *
+ * @param rank Position in the scan table (0 = current), slow channels following
+ * @param dst Destination buffer
+ * @param count Number of samples requested (at most ACQUISITION_RING_SIZE)
+ * @return uint16_t Number of samples copied
+ */
+uint16_t acquisition_read(uint8_t rank, uint16_t *dst, uint16_t count)
+{
+    const Acquisition_RingTypeDef *ring;
+    uint32_t start;
+
+    if (!dst || rank >= acquisition_count + acquisition_slow_count) return 0;
+
+    ring = &acquisition_rings[rank];
+    if (count > ACQUISITION_RING_SIZE) count = ACQUISITION_RING_SIZE;
+    if (count > ring->head) count = (uint16_t)ring->head;
+
+    start = ring->head - count;
+    for (uint16_t i = 0; i < count; i++) {
+        dst[i] = ring->data[(start + i) & ACQUISITION_RING_MASK];
+    }
+
+    return count;
+}
+
+/**
+ * @brief Get the ring of a rank for direct access
+ *
+ * @param rank Position in the scan table (0 = current), slow channels following
+ * @return const Acquisition_RingTypeDef* Ring pointer, NULL if the rank is invalid
+ */
+const Acquisition_RingTypeDef *acquisition_get_ring(uint8_t rank)
+{
+    if (rank >= acquisition_count + acquisition_slow_count) return NULL;
+
+    return &acquisition_rings[rank];
+}
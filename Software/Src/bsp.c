@@ -17,11 +17,53 @@
 
 #include "event.h"
 
-/* Global ADC buffer for 200 samples */
-volatile uint16_t current_adcBuffer[200];  /* Removed static to allow access from irq.c and made volatile for DMA writes */
+/* Global ADC sample pool, CURRENT_POOL_BUFFERS blocks of CURRENT_ADC_BLOCK_SIZE samples */
+volatile uint16_t current_adcBuffer[CURRENT_ADC_BUFFER_SIZE];  /* Removed static to allow access from irq.c and made volatile for DMA writes */
 uint16_t current_adcAverage = 0;  /* Latest calculated average */
-volatile uint8_t current_adcAverageReady = 0;  /* Flag indicating new average is ready */
-uint32_t sum = 0;
+uint16_t current_adcCritical = CALIB_FULL_SCALE;  /* Average limit in raw counts, set by current_limits_compile() */
+uint16_t current_adcTrip = CALIB_FULL_SCALE;  /* Watchdog limit in raw counts, set by current_limits_compile() */
+Stats_WindowTypeDef current_stats;  /* Sliding window fed with every new block */
+Stats_BlockTypeDef current_block_stats;  /* Per-block snapshot, updated only from valid blocks */
+Stats_BlockTypeDef current_fine_stats;  /* Snapshot of the last CURRENT_FINE_STATS_LENGTH oversampled samples */
+Filter_ChainTypeDef current_filter;  /* CIC + compensation FIR, fed with every new block */
+int16_t current_adcFiltered = 0;  /* Latest decimated filter output */
+FFT_AnalyzerTypeDef current_spectrum;  /* Spectrum analyzer fed with the filter output */
+UART_HandleTypeDef huart2;  /* USART2 handle, commands polled, scope readout interrupt-driven */
+static uint32_t adc_sample_rate_hz = 0;  /* Achieved sample rate of the trigger timer */
+
+/*
+ * Regular scan sequence, rank 0 must stay the motor current. Both inputs are
+ * driven from low impedance (amplifier output, filter capacitor at the divider),
+ * so the shortest sample time keeps a frame at 30 ADCCLK and 500 kS/s in reach.
+ */
+static const Acquisition_ChannelTypeDef adc_scan_table[] = {
+    { ADC_CHANNEL_0,  ADC_SAMPLETIME_3CYCLES,   CURRENT_ADC_PORT, CURRENT_ADC_PIN },          /* PA0 = ADC1_IN0, motor current */
+#if ADC_SCAN_MONITOR_ENABLE
+    { ADC_CHANNEL_1,  ADC_SAMPLETIME_3CYCLES,   BUS_VOLTAGE_ADC_PORT, BUS_VOLTAGE_ADC_PIN },  /* PA1 = ADC1_IN1, bus voltage divider */
+#endif
+};
+#define ADC_SCAN_COUNT  (sizeof(adc_scan_table) / sizeof(adc_scan_table[0]))
+
+#if ADC_SCAN_MONITOR_ENABLE
+/* Slow channels, converted by adc_calibration_update() on the injected group */
+static const Acquisition_ChannelTypeDef adc_slow_table[] = {
+    { ADC_CHANNEL_16, ADC_SAMPLETIME_480CYCLES, NULL, 0 },                                    /* Die temperature, needs >= 10us */
+    { ADC_CHANNEL_17, ADC_SAMPLETIME_480CYCLES, NULL, 0 },                                    /* VREFINT, needs >= 10us */
+};
+#define ADC_SLOW_COUNT  (sizeof(adc_slow_table) / sizeof(adc_slow_table[0]))
+#endif
+
+/* Default calibration per rank, replaced by the record in flash once one is saved */
+static const Calib_ChannelTypeDef adc_calib_defaults[] = {
+    { CURRENT_SENSE_OFFSET_MV, 0, CURRENT_SENSE_GAIN_Q16 },     /* Current, mA */
+#if ADC_SCAN_MONITOR_ENABLE
+    { BUS_VOLTAGE_OFFSET_MV,   0, BUS_VOLTAGE_GAIN_Q16 },       /* Bus voltage, mV */
+    { 0,                       0, 1L << 16 },                   /* Temperature sensor, pin mV */
+    { 0,                       0, 1L << 16 },                   /* VREFINT, pin mV */
+#endif
+};
+#define ADC_CALIB_COUNT (sizeof(adc_calib_defaults) / sizeof(adc_calib_defaults[0]))
+
 /**
  * @brief Initialize RCC (Reset and Clock Control)
  * 
@@ -43,8 +85,15 @@ void rcc_init(void)
     rcc_enable_gpio_clock(GPIOE);
     rcc_enable_gpio_clock(GPIOD);
     rcc_enable_adc_clock(ADC1);
+    rcc_enable_adc_clock(ADC2);  /* ADC2/ADC3 only run during interleaved bursts */
+    rcc_enable_adc_clock(ADC3);
+    rcc_enable_dma_clock(DMA1);
     rcc_enable_dma_clock(DMA2);
     rcc_enable_tim_clock(TIM2);
+    rcc_enable_tim_clock(ENCODER_TS_TIM);
+    rcc_enable_tim_clock(ENCODER_OBS_TIM);
+    rcc_enable_tim_clock(ADC_TRIGGER_TIM);
+    rcc_enable_tim_clock(MOTOR_PWM_TIM);
     rcc_enable_usart_clock(USART2);
 }
 
@@ -66,45 +115,212 @@ void gpio_system_init(void)
     button_system_init();
 }
 
+/**
+ * @brief Initialize timer for ADC trigger
+ * 
+ * Configures TIM8 as a free-running time base whose update event is routed to
+ * TRGO. Every TRGO rising edge starts exactly one ADC1 conversion, so the sample
+ * period is set by the timer crystal-derived clock rather than by ADC timing.
+ * 
+ * @note Must be called after adc_dma_init() so that no trigger is lost before
+ *       DMA and ADC are ready
+ */
+void timer_init(void)
+{
+    tim_disable(ADC_TRIGGER_TIM);
+    tim_set_trgo(ADC_TRIGGER_TIM, TIM_TRGO_UPDATE);  /* Update event -> TRGO -> ADC EXTSEL */
+    
+    adc_sampling_set_rate(ADC_SAMPLE_RATE_HZ);
+}
+
+/**
+ * @brief Restart the current filter chain and spectrum for the present input rate
+ * 
+ * The chain runs behind the oversampling stage, so its input rate is the trigger
+ * rate divided by 4^k and its input carries k extra bits. Below the design range
+ * of the compensation FIR, R is raised to FILTER_COMP_MIN_DECIMATION and the
+ * output rate drops under CURRENT_FILTER_RATE_HZ instead.
+ */
+static void current_chain_init(void)
+{
+    uint8_t bits = oversample_get_bits();
+    uint32_t rate = adc_sample_rate_hz >> (2 * bits);
+    
+    if (rate == 0) rate = 1;
+    
+    /* Keep the filter output rate fixed: decimation follows the input rate */
+    uint32_t decimation = rate / CURRENT_FILTER_RATE_HZ;
+    if (decimation < FILTER_COMP_MIN_DECIMATION) decimation = FILTER_COMP_MIN_DECIMATION;
+    filter_chain_init(&current_filter, CURRENT_FILTER_CIC_ORDER, (uint16_t)decimation,
+                      CURRENT_RAW_RESOLUTION + bits, filter_cic3_comp_q15, FILTER_COMP_TAPS);
+    fft_analyzer_init(&current_spectrum, CURRENT_SPECTRUM_POINTS, rate / decimation);
+}
+
+/**
+ * @brief Change the ADC sample rate at runtime
+ * 
+ * Clamps the request to the fastest rate at which the ADC can convert a complete
+ * scan frame, then programs the trigger timer and restarts it. The current filter
+ * chain is re-initialized for the new decimation factor, and the spectrum analyzer
+ * restarts at the resulting output rate.
+ * 
+ * @param rate_hz Requested sample rate in Hz
+ * @return uint32_t Achieved sample rate in Hz, 0 if the rate cannot be generated
+ */
+uint32_t adc_sampling_set_rate(uint32_t rate_hz)
+{
+    /* Injected conversions at the PWM rate take their share of ADC time first */
+    uint32_t max_rate = (adc_get_clock_freq() - inject_get_adc_load()) / acquisition_get_frame_cycles();
+    uint32_t achieved;
+    
+    if (rate_hz > max_rate) {
+        rate_hz = max_rate;  /* Triggers during a running conversion would be ignored */
+    }
+    
+    tim_disable(ADC_TRIGGER_TIM);
+    achieved = tim_set_frequency(ADC_TRIGGER_TIM, rate_hz);
+    if (achieved == 0) {
+        return 0;  /* Keep previous setting, timer stays stopped */
+    }
+    
+    /* Rounding may land one timer tick short of the conversion time: add that tick back */
+    if (achieved > max_rate) {
+        uint32_t tim_clock = tim_get_clock_freq(ADC_TRIGGER_TIM);
+        achieved = tim_set_frequency(ADC_TRIGGER_TIM, tim_clock / (tim_clock / max_rate + 1));
+    }
+    
+    adc_sample_rate_hz = achieved;
+    current_chain_init();
+    
+    tim_enable(ADC_TRIGGER_TIM);
+    
+    return achieved;
+}
+
+/**
+ * @brief Get the achieved ADC sample rate
+ * 
+ * @return uint32_t Sample rate in Hz as programmed into the trigger timer
+ */
+uint32_t adc_sampling_get_rate(void)
+{
+    return adc_sample_rate_hz;
+}
+
+/**
+ * @brief Select the current oversampling ratio at runtime
+ * 
+ * Called from the main loop only, so no block is in flight through the
+ * consumers while the stages restart. The sliding window keeps running, it
+ * averages the raw block ahead of the oversampler.
+ * 
+ * @param extra_bits k, 0 (raw 12-bit stream) to OVERSAMPLE_MAX_BITS; the ratio is 4^k
+ * @param dither 1 to round with a pseudo-random offset, 0 to round to nearest
+ * @return uint8_t 0 if successful, 1 if extra_bits is out of range
+ */
+uint8_t adc_oversampling_set(uint8_t extra_bits, uint8_t dither)
+{
+    if (oversample_configure(extra_bits, dither) != 0) {
+        return 1;
+    }
+    
+    current_chain_init();
+    
+    return 0;
+}
+
+/**
+ * @brief Convert the mA limits into raw compare values
+ * 
+ * @details Runs whenever VDDA or the calibration changes, so the per-sample
+ *          checks stay single integer compares.
+ */
+static void current_limits_compile(void)
+{
+    current_adcCritical = calib_to_raw(ADC_RANK_CURRENT, CURRENT_CRITICAL_THRESHOLD_MA);
+    current_adcTrip = calib_to_raw(ADC_RANK_CURRENT, CURRENT_TRIP_THRESHOLD_MA);
+}
+
+/**
+ * @brief Measure VDDA and recompile the current limits
+ * 
+ * Converts the slow channels once, then takes VDDA from the average of the
+ * newest ADC_VREFINT_AVERAGE VREFINT samples.
+ * 
+ * @return uint16_t VDDA in mV
+ */
+uint16_t adc_calibration_update(void)
+{
+    uint16_t vdda_mv = calib_get_vdda_mv();
+#if ADC_SCAN_MONITOR_ENABLE
+    uint16_t samples[ADC_VREFINT_AVERAGE];
+    uint16_t count;
+    uint32_t sum = 0;
+
+    if (!burst_capture_active()) {
+        acquisition_sample_slow();      /* A burst has ADC1 in interleaved mode */
+    }
+    count = acquisition_read(ADC_RANK_VREFINT, samples, ADC_VREFINT_AVERAGE);
+
+    for (uint16_t i = 0; i < count; i++) {
+        sum += samples[i];
+    }
+    if (count > 0) {
+        vdda_mv = calib_update_vdda((uint16_t)((sum + count / 2) / count));
+    }
+#endif
+
+    current_limits_compile();
+    protect_set_threshold(current_adcTrip);
+
+    return vdda_mv;
+}
+
 /**
  * @brief Initialize ADC and DMA
  * 
- * Configures ADC for continuous sampling with DMA on PA0
+ * Configures ADC for timer-triggered scan sampling with DMA, current on PA0
  * Using library functions while maintaining the critical sequence of operations
  * 
  * @note Critical aspects for correct ADC-DMA operation:
  * 1. DDS bit (ADC_CR2_DDS) must be explicitly set to generate DMA requests after each conversion
- * 2. DMA must be enabled before starting ADC conversion
+ * 2. DMA must be enabled before the first trigger arrives
  * 3. Proper flag clearing before enabling DMA is essential
- * 4. Sequence of operations: DMA config → DMA enable → ADC config → ADC DMA enable → Set DDS → Start ADC
+ * 4. Sequence of operations: DMA config → DMA enable → ADC config → ADC DMA enable → Set DDS → Start trigger timer
  */
 void adc_dma_init(void)
 {
     /* ADC1 initialization */  
     ADC_InitTypeDef adc_config;  
-    ADC_ChannelConfTypeDef adc_channel_config;  
     DMA_InitTypeDef dma_config;
+    uint16_t block_length = (CURRENT_ADC_BLOCK_SIZE / ADC_SCAN_COUNT) * ADC_SCAN_COUNT;  /* Whole frames per block */
       
     /* Configure ADC1 with high speed and DMA enabled */  
     adc_config.Resolution = ADC_RESOLUTION_12BIT;        /* 12-bit resolution for high accuracy */  
     adc_config.Align = ADC_DATAALIGN_RIGHT;              /* Right alignment of data */  
-    adc_config.ScanMode = ADC_SCAN_DISABLE;              /* Single channel, no scan needed */  
-    adc_config.ContMode = ADC_CONTINUOUS_ENABLE;         /* Enable continuous conversion mode */  
-    adc_config.ExternalTrigger = 0;                      /* No external trigger needed */  
-    adc_config.ExternalTrigConv = 0;                     /* No external trigger edge */  
+    adc_config.ScanMode = (ADC_SCAN_COUNT > 1) ? ADC_SCAN_ENABLE : ADC_SCAN_DISABLE;  /* Whole table per trigger */  
+    adc_config.ContMode = ADC_CONTINUOUS_DISABLE;        /* One conversion per trigger */  
+    adc_config.ExternalTrigger = ADC_EXTERNALTRIG_T8_TRGO;     /* TIM8 TRGO paces the conversions */  
+    adc_config.ExternalTrigConv = ADC_EXTERNALTRIGCONV_RISING; /* Convert on TRGO rising edge */  
     adc_config.DataManagement = ADC_DMA_CIRCULAR;        /* Enable circular DMA mode */  
     adc_init(ADC1, &adc_config);  
       
-    /* Configure ADC channel for current sensing on PA0 */  
-    adc_channel_config.Channel = ADC_CHANNEL_0;        /* PA0 = ADC1_IN0 */  
-    adc_channel_config.Rank = ADC_REGULAR_RANK_1;      /* Set as first and only conversion */  
-    adc_channel_config.SamplingTime = ADC_SAMPLETIME_28CYCLES;  /* Sampling time for ~500kHz */  
-    adc_config_channel(ADC1, &adc_channel_config);  
+    /* Configure regular sequence: current first, then the bus voltage */  
+    acquisition_configure(adc_scan_table, ADC_SCAN_COUNT);  
+#if ADC_SCAN_MONITOR_ENABLE
+    acquisition_configure_slow(adc_slow_table, ADC_SLOW_COUNT);
+#endif
+    
+    /* Hardware overcurrent trip on every current conversion */
+    current_limits_compile();
+    protect_init(adc_scan_table[ADC_RANK_CURRENT].Channel, current_adcTrip);
+    
+    /* One clean current sample per PWM period from the injected group */
+    inject_init(adc_scan_table[ADC_RANK_CURRENT].Channel, adc_scan_table[ADC_RANK_CURRENT].SamplingTime);
       
-    /* Clear the ADC buffer to avoid confusion during debugging */  
-    for (int i = 0; i < 200; i++) {  
-        current_adcBuffer[i] = 0;  
-    }  
+    /* Reset buffer pool and statistics before DMA can raise TC, held blocks stay intact */
+    current_pipeline_init(block_length, ADC_SCAN_COUNT);
+    stats_window_init(&current_stats, CURRENT_STATS_WINDOW);
       
     /* Reset DMA configuration before setup */  
     /* Critical: First disable DMA if it's enabled */
@@ -124,7 +340,7 @@ void adc_dma_init(void)
     dma_config.MemInc = DMA_MINC_ENABLE;                 /* Increment memory address */
     dma_config.PeriphDataAlign = DMA_PDATAALIGN_HALFWORD; /* ADC data is 16-bit */
     dma_config.MemDataAlign = DMA_MDATAALIGN_HALFWORD;    /* Memory is also 16-bit */
-    dma_config.Mode = DMA_CIRCULAR;                      /* Circular mode enabled */
+    dma_config.Mode = DMA_CIRCULAR;                      /* Circular mode, required by double-buffer mode */
     dma_config.Priority = DMA_PRIORITY_HIGH;             /* High priority */
     dma_config.FIFOMode = DMA_FIFOMODE_DISABLE;          /* FIFO disabled, direct mode */
     dma_config.FIFOThreshold = 0;                        /* Not used in direct mode */
@@ -134,32 +350,31 @@ void adc_dma_init(void)
     /* Initialize DMA using library function */
     dma_init(DMA2, DMA_STREAM0, &dma_config);
     
-    /* Configure DMA transfer parameters */
-    dma_config_transfer(DMA2, DMA_STREAM0, 
-                       (uint32_t)&ADC1->DR,              /* Source: ADC data register */
-                       (uint32_t)current_adcBuffer,      /* Destination: ADC buffer */
-                       200);                             /* Buffer size: 200 samples */
+    /* Configure double-buffer transfer: two pool buffers, swapped by the ISR as they fill */
+    dma_config_double_buffer(DMA2, DMA_STREAM0,
+                             (uint32_t)&ADC1->DR,                       /* Source: ADC data register */
+                             current_pipeline_target_address(0),        /* M0AR: first pool buffer */
+                             current_pipeline_target_address(1),        /* M1AR: second pool buffer */
+                             block_length);                             /* Whole frames per buffer */
     
-    /* Enable DMA interrupts for transfer complete and half transfer */
-    dma_enable_interrupt(DMA2, DMA_STREAM0, DMA_SxCR_TCIE | DMA_SxCR_HTIE);
+    /* Enable DMA interrupt for transfer complete, raised once per filled buffer */
+    dma_enable_interrupt(DMA2, DMA_STREAM0, DMA_SxCR_TCIE);
     
     /* Configure interrupt priority and enable in NVIC */
-    NVIC_SetPriority(DMA2_Stream0_IRQn, 0);
+    NVIC_SetPriority(DMA2_Stream0_IRQn, 1);  /* Below the analog watchdog trip */
     NVIC_EnableIRQ(DMA2_Stream0_IRQn);
     
     /* Critical sequence: Enable DMA stream before configuring ADC */
     dma_enable(DMA2, DMA_STREAM0);
     
-    /* Enable ADC with explicit DDS bit setting (critical for continuous DMA operation) */
+    /* Enable ADC with explicit DDS bit setting (critical for circular DMA operation) */
     adc_enable(ADC1);
     
     /* Critical: Setting DDS bit explicitly to ensure DMA requests after each conversion */
     ADC1->CR2 |= ADC_CR2_DMA;  /* Enable DMA mode */
     ADC1->CR2 |= ADC_CR2_DDS;  /* DMA requests generated after each conversion */
-    ADC1->CR2 |= ADC_CR2_CONT; /* Ensure continuous mode is set */
     
-    /* Start ADC conversion */
-    adc_start_conversion(ADC1);
+    /* Conversions start with the first TRGO once timer_init() runs the trigger timer */
 }
 
 /**
@@ -169,7 +384,6 @@ void adc_dma_init(void)
  */
 void uart_system_init(void)
 {
-    UART_HandleTypeDef huart2;
     /* Configure UART pins */
     UART_PinConfig uart_pins;
     uart_pins.tx_port = FPGA_UART_TX_PORT;
@@ -189,6 +403,10 @@ void uart_system_init(void)
     
     /* Initialize UART */
     uart_init(&huart2, &uart_pins);
+
+    /* Scope readout is sent from the TXE interrupt, below every control interrupt */
+    NVIC_SetPriority(USART2_IRQn, 3);
+    NVIC_EnableIRQ(USART2_IRQn);
 }
 
 /**
@@ -203,6 +421,8 @@ void system_init(void)
     rcc_init();             // First initialize system clock and peripheral clocks
     systick_init(SystemCoreClock); // Initialize SysTick for 1ms timing
     gpio_system_init();     // Then initialize GPIO pins
-    adc_dma_init();         // Initialize ADC with DMA in continuous mode
+    calib_init(adc_calib_defaults, ADC_CALIB_COUNT); // Stored calibration, before any limit is compiled
+    adc_dma_init();         // Initialize ADC with DMA, waiting for external trigger
+    timer_init();           // Start TIM8 trigger, sampling begins here
     uart_system_init();     // Initialize UART interface
 }
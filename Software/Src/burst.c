@@ -0,0 +1,212 @@
+/**
+ ******************************************************************************
+ * @file           : burst.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-23
+ * @brief          : Triple-interleaved ADC burst capture implementation
+ ******************************************************************************
+ * @details
+ * This file implements the burst capture mode. ADC1 is the master in continuous
+ * mode, and ADC2 and ADC3 sample the same input BURST_PHASE_DELAY cycles after
+ * the previous ADC. Multi-ADC DMA mode 2 moves two results per 32-bit word.
+ * The order is ADC1/ADC2, ADC3/ADC1, ADC2/ADC3 (low half first), so the buffer
+ * read as halfwords is already in time order.
+ *
+ * Each ADC has to finish a 3 + 12 = 15 cycle conversion before its next
+ * phase. Three phases of 5 cycles meet that exactly, so the sampling time
+ * must stay at 3 cycles.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include "bsp.h"
+
+/* Word-sized so word DMA transfers stay aligned, read back as halfwords */
+static volatile uint32_t burst_buffer[BURST_BUFFER_SIZE / 2];
+static volatile Burst_StateTypeDef burst_state = BURST_IDLE;
+static uint32_t burst_count = 0;
+
+/**
+ * @brief Configure one ADC for the interleaved current conversion
+ *
+ * @param ADCx ADC instance (ADC1, ADC2, or ADC3)
+ */
+static void burst_adc_config(ADC_TypeDef *ADCx)
+{
+    ADC_InitTypeDef adc_config;
+    ADC_ChannelConfTypeDef channel_config;
+
+    adc_config.Resolution = ADC_RESOLUTION_12BIT;
+    adc_config.Align = ADC_DATAALIGN_RIGHT;
+    adc_config.ScanMode = ADC_SCAN_DISABLE;
+    adc_config.ContMode = ADC_CONTINUOUS_ENABLE;            /* Slaves follow the master continuously */
+    adc_config.ExternalTrigger = 0;
+    adc_config.ExternalTrigConv = ADC_EXTERNALTRIGCONV_NONE; /* Started by SWSTART on ADC1 */
+    adc_config.DataManagement = ADC_DMA_DISABLE;             /* Common DMA via ADC->CDR instead */
+    adc_init(ADCx, &adc_config);
+
+    channel_config.Channel = ADC_CHANNEL_0;                  /* PA0 = ADC123_IN0, motor current */
+    channel_config.Rank = ADC_REGULAR_RANK_1;
+    channel_config.SamplingTime = ADC_SAMPLETIME_3CYCLES;
+    adc_config_channel(ADCx, &channel_config);
+}
+
+/**
+ * @brief Start one triple-interleaved burst
+ *
+ * @details Stops the regular trigger, takes over DMA2 Stream0 for word transfers
+ *          from ADC->CDR, switches the common block to triple-interleaved mode
+ *          and starts the master. Reconfiguring ADC1 clears the analog
+ *          watchdog and stops the injected samples, so the overcurrent trip
+ *          and the current loop are gone until burst_handler() runs. A burst
+ *          is therefore only taken with the bridge disabled.
+ *
+ * @return uint8_t 0 if the burst was started, 1 if a burst is still in progress,
+ *         2 if the motor driver is enabled
+ */
+uint8_t burst_capture_start(void)
+{
+    DMA_InitTypeDef dma_config;
+
+    if (burst_capture_busy()) {
+        return 1;
+    }
+    if (gpio_read(MOTOR_ENABLE_PORT, MOTOR_ENABLE_PIN)) {
+        return 2;
+    }
+
+    /* Stop the regular path: trigger first, then DMA, then the ADC */
+    tim_disable(ADC_TRIGGER_TIM);
+    dma_disable(DMA2, DMA_STREAM0);
+    adc_disable(ADC1);
+
+    /* All ADCs must be off while the multi-mode changes */
+    burst_adc_config(ADC1);
+    burst_adc_config(ADC2);
+    burst_adc_config(ADC3);
+    adc_config_multimode(ADC_MODE_TRIPLE_INTERLEAVED, ADC_MULTI_DMA_MODE2, BURST_PHASE_DELAY);
+
+    dma_config.Channel = DMA_CHANNEL_0;                  /* ADC1 request line carries the common data */
+    dma_config.Direction = DMA_PERIPH_TO_MEMORY;
+    dma_config.PeriphInc = DMA_PINC_DISABLE;
+    dma_config.MemInc = DMA_MINC_ENABLE;
+    dma_config.PeriphDataAlign = DMA_PDATAALIGN_WORD;    /* Two results per CDR read */
+    dma_config.MemDataAlign = DMA_MDATAALIGN_WORD;
+    dma_config.Mode = DMA_NORMAL;                        /* One buffer, then stop */
+    dma_config.Priority = DMA_PRIORITY_VERY_HIGH;
+    dma_config.FIFOMode = DMA_FIFOMODE_DISABLE;
+    dma_config.FIFOThreshold = 0;
+    dma_config.MemBurst = DMA_MBURST_SINGLE;
+    dma_config.PeriphBurst = DMA_PBURST_SINGLE;
+    dma_init(DMA2, DMA_STREAM0, &dma_config);
+
+    dma_config_transfer(DMA2, DMA_STREAM0,
+                        (uint32_t)&ADC->CDR,
+                        (uint32_t)burst_buffer,
+                        BURST_BUFFER_SIZE / 2);
+    dma_enable_interrupt(DMA2, DMA_STREAM0, DMA_SxCR_TCIE);
+
+    burst_state = BURST_RUNNING;
+    dma_enable(DMA2, DMA_STREAM0);
+
+    /* Slaves first so they are ready when the master starts */
+    adc_enable(ADC3);
+    adc_enable(ADC2);
+    adc_enable(ADC1);
+    adc_start_conversion(ADC1);
+
+    return 0;
+}
+
+/**
+ * @brief Check whether a burst owns ADC1 and DMA2 Stream0
+ *
+ * @return uint8_t 1 while the burst is running, 0 otherwise
+ */
+uint8_t burst_capture_active(void)
+{
+    return (burst_state == BURST_RUNNING) ? 1 : 0;
+}
+
+/**
+ * @brief Check whether the regular path is still down for a burst
+ *
+ * @return uint8_t 1 from the start of a burst until burst_handler() has
+ *         restored regular sampling, 0 otherwise
+ */
+uint8_t burst_capture_busy(void)
+{
+    return (burst_state == BURST_RUNNING || burst_state == BURST_COMPLETE) ? 1 : 0;
+}
+
+/**
+ * @brief Burst DMA transfer complete handler (called from the DMA ISR)
+ *
+ * @details Stops all three ADCs right away. They keep converting after the
+ *          stream ends, and an unread result would set OVR, which blocks the
+ *          next DMA request.
+ */
+void burst_capture_irq_handler(void)
+{
+    ADC1->CR2 &= ~ADC_CR2_CONT;
+    adc_disable(ADC1);
+    adc_disable(ADC2);
+    adc_disable(ADC3);
+
+    ADC1->SR = 0;
+    ADC2->SR = 0;
+    ADC3->SR = 0;
+
+    burst_count++;
+    burst_state = BURST_COMPLETE;
+}
+
+/**
+ * @brief Restore the regular acquisition path after a burst
+ *
+ * @details Returns the common block to independent mode and rebuilds the regular
+ *          ADC1/DMA configuration. It then restarts the trigger timer at the rate
+ *          that was active before. This runs outside the ISR because enabling the
+ *          ADC waits for it to stabilize.
+ */
+void burst_handler(void)
+{
+    if (burst_state != BURST_COMPLETE) return;
+
+    adc_config_multimode(ADC_MODE_INDEPENDENT, ADC_MULTI_DMA_DISABLE, BURST_PHASE_DELAY);
+    adc_dma_init();
+    adc_sampling_set_rate(adc_sampling_get_rate());
+
+    burst_state = BURST_READY;
+}
+
+/**
+ * @brief Get the last completed burst
+ *
+ * @param block Filled with the burst samples in time order
+ * @return uint8_t 1 if a burst is available, 0 otherwise
+ */
+uint8_t burst_get(Current_BlockTypeDef *block)
+{
+    if (!block || burst_state != BURST_READY) return 0;
+
+    block->data = (const volatile uint16_t *)burst_buffer;
+    block->length = BURST_BUFFER_SIZE;
+    block->channels = 1;
+    block->buffer = CURRENT_BUFFER_NONE;
+    block->resolution = CURRENT_RAW_RESOLUTION;
+    block->sequence = burst_count;
+
+    return 1;
+}
+
+/**
+ * @brief Get the effective sample rate of a burst
+ *
+ * @return uint32_t Combined sample rate of the three ADCs in Hz
+ */
+uint32_t burst_get_sample_rate(void)
+{
+    return adc_get_clock_freq() / BURST_PHASE_DELAY;
+}
@@ -0,0 +1,279 @@
+/**
+ ******************************************************************************
+ * @file           : calib.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-30
+ * @brief          : ADC calibration and engineering unit conversion implementation
+ ******************************************************************************
+ * @details
+ * This file implements the calibration record and the conversions. The pin
+ * voltage is raw * VDDA / 4095, and the value is (pin mV - offset) * gain. Both
+ * steps fold into units = (raw * scale >> 16) - offset_units, with scale and
+ * offset_units recomputed per rank whenever VDDA is measured.
+ *
+ * The stored record is a magic word, the calibration of every rank and a
+ * CRC-32 over both. It sits at the start of flash sector 11, which the linker
+ * script keeps outside the FLASH region.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include "bsp.h"
+
+#define CALIB_STORE_SECTOR      11
+#define CALIB_STORE_ADDRESS     FLASH_SECTOR_11_BASE
+#define CALIB_STORE_MAGIC       0x43414C31U     /* "CAL1" */
+
+/**
+ * @brief Calibration record as stored in flash
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t count;
+    Calib_ChannelTypeDef channel[CALIB_MAX_CHANNELS];
+    uint32_t crc;
+} Calib_StoreTypeDef;
+
+static Calib_ChannelTypeDef calib_channel[CALIB_MAX_CHANNELS];
+static uint8_t calib_count = 0;
+static uint16_t calib_vdda_mv = CALIB_VREFINT_CAL_MV;
+static int32_t calib_scale_q16[CALIB_MAX_CHANNELS];    /* Units per raw count, Q16.16 */
+static int32_t calib_offset_units[CALIB_MAX_CHANNELS]; /* Offset in units */
+
+/**
+ * @brief CRC-32 (IEEE 802.3, reflected) over a word-aligned record
+ *
+ * @param data Record start
+ * @param length Length in bytes
+ * @return uint32_t CRC value
+ */
+static uint32_t calib_crc32(const uint8_t *data, uint32_t length)
+{
+    uint32_t crc = 0xFFFFFFFFU;
+
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+
+    return ~crc;
+}
+
+/**
+ * @brief Fold VDDA, offset and gain of one rank into its conversion constants
+ *
+ * @param rank Scan rank
+ */
+static void calib_compile(uint8_t rank)
+{
+    int64_t gain = calib_channel[rank].gain_q16;
+
+    calib_scale_q16[rank] = (int32_t)((gain * calib_vdda_mv + CALIB_FULL_SCALE / 2) / CALIB_FULL_SCALE);
+    calib_offset_units[rank] = (int32_t)((gain * calib_channel[rank].offset_mv + 0x8000) >> 16);
+}
+
+/**
+ * @brief Load the stored calibration
+ *
+ * @param defaults Calibration used for ranks without a stored record
+ * @param count Number of ranks (1 to CALIB_MAX_CHANNELS)
+ * @return uint8_t 1 if a stored record was loaded, 0 if the defaults are in use
+ */
+uint8_t calib_init(const Calib_ChannelTypeDef *defaults, uint8_t count)
+{
+    const Calib_StoreTypeDef *store = (const Calib_StoreTypeDef *)CALIB_STORE_ADDRESS;
+    uint8_t loaded = 0;
+
+    if (!defaults || count == 0 || count > CALIB_MAX_CHANNELS) return 0;
+
+    calib_count = count;
+    for (uint8_t i = 0; i < count; i++) {
+        calib_channel[i] = defaults[i];
+    }
+
+    /* Erased flash reads 0xFFFFFFFF, neither the magic nor a valid CRC */
+    if (store->magic == CALIB_STORE_MAGIC &&
+        store->crc == calib_crc32((const uint8_t *)store, offsetof(Calib_StoreTypeDef, crc))) {
+        for (uint8_t i = 0; i < count && i < store->count; i++) {
+            if (store->channel[i].gain_q16 > 0) {
+                calib_channel[i] = store->channel[i];
+            }
+        }
+        loaded = 1;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        calib_compile(i);
+    }
+
+    return loaded;
+}
+
+/**
+ * @brief Measure VDDA and refresh the conversion scales
+ *
+ * @details VDDA = 3.3 V * VREFINT_CAL / VREFINT, since VREFINT itself does not
+ *          move with the supply.
+ *
+ * @param vrefint_raw Averaged raw VREFINT conversion, 12-bit
+ * @return uint16_t VDDA in mV
+ */
+uint16_t calib_update_vdda(uint16_t vrefint_raw)
+{
+    if (vrefint_raw == 0) return calib_vdda_mv;
+
+    calib_vdda_mv = (uint16_t)(((uint32_t)CALIB_VREFINT_CAL_MV * CALIB_VREFINT_CAL + vrefint_raw / 2) / vrefint_raw);
+
+    for (uint8_t i = 0; i < calib_count; i++) {
+        calib_compile(i);
+    }
+
+    return calib_vdda_mv;
+}
+
+/**
+ * @brief Get the latest VDDA measurement
+ *
+ * @return uint16_t VDDA in mV
+ */
+uint16_t calib_get_vdda_mv(void)
+{
+    return calib_vdda_mv;
+}
+
+/**
+ * @brief Get the calibration of a rank
+ *
+ * @param rank Scan rank
+ * @param channel Destination
+ * @return uint8_t 0 if successful, 1 if the rank is invalid
+ */
+uint8_t calib_get_channel(uint8_t rank, Calib_ChannelTypeDef *channel)
+{
+    if (!channel || rank >= calib_count) return 1;
+
+    *channel = calib_channel[rank];
+    return 0;
+}
+
+/**
+ * @brief Replace the calibration of a rank
+ *
+ * @param rank Scan rank
+ * @param channel New calibration
+ * @return uint8_t 0 if successful, 1 if the rank or gain is invalid
+ */
+uint8_t calib_set_channel(uint8_t rank, const Calib_ChannelTypeDef *channel)
+{
+    if (!channel || rank >= calib_count || channel->gain_q16 <= 0) return 1;
+
+    calib_channel[rank] = *channel;
+    calib_channel[rank].reserved = 0;
+    calib_compile(rank);
+
+    return 0;
+}
+
+/**
+ * @brief Store the calibration in flash
+ *
+ * @return uint8_t 0 if successful, 1 on a flash error
+ */
+uint8_t calib_save(void)
+{
+    Calib_StoreTypeDef store = { 0 };
+    uint8_t status;
+
+    store.magic = CALIB_STORE_MAGIC;
+    store.count = calib_count;
+    for (uint8_t i = 0; i < calib_count; i++) {
+        store.channel[i] = calib_channel[i];
+    }
+    store.crc = calib_crc32((const uint8_t *)&store, offsetof(Calib_StoreTypeDef, crc));
+
+    if (flash_unlock()) return 1;
+
+    status = flash_erase_sector(CALIB_STORE_SECTOR);
+    if (status == 0) {
+        status = flash_program(CALIB_STORE_ADDRESS, (const uint32_t *)&store,
+                               sizeof(store) / sizeof(uint32_t));
+    }
+
+    flash_lock();
+    return status;
+}
+
+/**
+ * @brief Convert a raw count to engineering units
+ *
+ * @param rank Scan rank
+ * @param raw 12-bit raw ADC count
+ * @return int32_t mA or mV, 0 if the rank is invalid
+ */
+int32_t calib_to_units(uint8_t rank, uint16_t raw)
+{
+    if (rank >= calib_count) return 0;
+
+    return (int32_t)(((int64_t)raw * calib_scale_q16[rank] + 0x8000) >> 16) - calib_offset_units[rank];
+}
+
+/**
+ * @brief Convert a fractional raw count to thousandths of engineering units
+ *
+ * @details Same line as calib_to_units(), without rounding to whole units,
+ *          so resolution below one count survives.
+ *
+ * @param rank Scan rank
+ * @param raw Raw ADC count << frac_bits, e.g. an oversampled or block mean
+ * @param frac_bits Fraction bits of raw
+ * @return int32_t uA or uV, 0 if the rank is invalid
+ */
+int32_t calib_to_milliunits(uint8_t rank, uint32_t raw, uint8_t frac_bits)
+{
+    if (rank >= calib_count) return 0;
+
+    return (int32_t)(((int64_t)raw * calib_scale_q16[rank] * 1000 + (1LL << (15 + frac_bits))) >> (16 + frac_bits)) -
+           calib_offset_units[rank] * 1000;
+}
+
+/**
+ * @brief Convert engineering units to the raw compare value
+ *
+ * @details The division gives the estimate, the steps after it make the result
+ *          exact against calib_to_units() whatever the rounding.
+ *
+ * @param rank Scan rank
+ * @param units mA or mV
+ * @return uint16_t Largest raw count that does not exceed units
+ */
+uint16_t calib_to_raw(uint8_t rank, int32_t units)
+{
+    int64_t estimate;
+    uint16_t raw;
+
+    if (rank >= calib_count || calib_scale_q16[rank] <= 0) return CALIB_FULL_SCALE;
+
+    estimate = (((int64_t)units + calib_offset_units[rank]) << 16) / calib_scale_q16[rank];
+    if (estimate < 0) estimate = 0;
+    if (estimate > CALIB_FULL_SCALE) estimate = CALIB_FULL_SCALE;
+    raw = (uint16_t)estimate;
+
+    while (raw < CALIB_FULL_SCALE && calib_to_units(rank, (uint16_t)(raw + 1)) <= units) raw++;
+    while (raw > 0 && calib_to_units(rank, raw) > units) raw--;
+
+    return raw;
+}
+
+/**
+ * @brief Convert a raw count to the voltage at the pin
+ *
+ * @param raw 12-bit raw ADC count
+ * @return int32_t Pin voltage in mV
+ */
+int32_t calib_raw_to_mv(uint16_t raw)
+{
+    return (int32_t)(((uint32_t)raw * calib_vdda_mv + CALIB_FULL_SCALE / 2) / CALIB_FULL_SCALE);
+}
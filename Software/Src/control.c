@@ -0,0 +1,306 @@
+/**
+ ******************************************************************************
+ * @file           : control.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-09-03
+ * @brief          : Cascaded current, speed and position control implementation
+ ******************************************************************************
+ * @details
+ * This file implements the inner and outer ends of the cascade; the speed loop
+ * in between lives in speed.c. The current loop is the Q15 controller of pid.c,
+ * with current scaled by 2^CONTROL_CURRENT_SHIFT from mA and the duty as
+ * output. It runs on every injected sample, so it is synchronized to the PWM
+ * and sees one clean sample per period. The position loop is proportional
+ * only: the speed loop already integrates, and its speed setpoint limit
+ * bounds the travel speed.
+ *
+ * Speed and position setpoints pass through the jerk-limited profile of
+ * profile.c first. In position mode the speed loop gets the profile speed as
+ * feed-forward, so the position loop only corrects the following error.
+ *
+ * Inactive levels are skipped by their interrupt before any of their state is
+ * touched, so the main loop can clear a level before switching it on.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include "bsp.h"
+
+static Encoder_HandleTypeDef *control_encoder = NULL;
+static uint16_t control_divider = 1;            /* Interrupt calls per outer loop update */
+static uint16_t control_phase = 0;
+static Pid_Q15TypeDef control_current_pid;
+static uint32_t control_sample_count = 0;       /* Injected sample used by the last update */
+static volatile Control_ModeTypeDef control_mode = CONTROL_MODE_OFF;
+static volatile int32_t control_current_target = 0;
+static Profile_HandleTypeDef control_profile;   /* Speed and position setpoints, advanced by the TIM7 ISR */
+static Control_ModeTypeDef control_profile_mode = CONTROL_MODE_OFF;    /* Mode of the last profile update */
+static volatile Control_StatusTypeDef control_status;  /* Written by the ADC ISR only */
+
+/**
+ * @brief Convert mA to Q15 current, saturating at full scale
+ *
+ * @param ma Current in mA
+ * @return int16_t Q15 current
+ */
+static inline int16_t control_current_q15(int32_t ma)
+{
+    if (ma >= CONTROL_CURRENT_FULL_SCALE_MA) return INT16_MAX;
+    if (ma <= -CONTROL_CURRENT_FULL_SCALE_MA) return INT16_MIN;
+    return (int16_t)(ma * (1 << CONTROL_CURRENT_SHIFT));
+}
+
+/**
+ * @brief Set up all levels, initially off
+ *
+ * @param encoder Encoder whose observer provides speed and position
+ * @param call_rate_hz Rate at which control_irq_handler() will be called, a
+ *                     multiple of SPEED_LOOP_RATE_HZ
+ * @return uint8_t 0 if successful, 1 on an invalid rate or gain
+ */
+uint8_t control_init(Encoder_HandleTypeDef *encoder, uint32_t call_rate_hz)
+{
+    uint32_t pwm_rate = pwm_get_frequency();
+    Pid_ConfigTypeDef config = {
+        .kp = (float)CONTROL_CURRENT_KP_Q16 / 65536.0f,
+        .out_min = -(float)INT16_MAX / 32768.0f,
+        .out_max = (float)INT16_MAX / 32768.0f,
+        .antiwindup = PID_ANTIWINDUP_CLAMP,
+    };
+    Profile_InitTypeDef profile = {
+        .rate_hz = SPEED_LOOP_RATE_HZ,
+        .max_speed_mrpm = SPEED_MAX_MRPM,
+        .max_accel_rpm_s = PROFILE_MAX_ACCEL_RPM_S,
+        .max_jerk_rpm_s2 = PROFILE_MAX_JERK_RPM_S2,
+    };
+
+    if (!encoder || call_rate_hz < SPEED_LOOP_RATE_HZ || pwm_rate == 0) return 1;
+
+    control_mode = CONTROL_MODE_OFF;
+    config.ki = (float)CONTROL_CURRENT_KI_Q16 / 65536.0f / pwm_rate;
+    if (pid_q15_init(&control_current_pid, &config)) return 1;
+    if (speed_init(encoder, SPEED_LOOP_RATE_HZ)) return 1;
+    profile.counts_per_rev = encoder->CountsPerRevolution;
+    if (profile_init(&control_profile, &profile)) return 1;
+
+    control_encoder = encoder;
+    control_divider = (uint16_t)(call_rate_hz / SPEED_LOOP_RATE_HZ);
+    control_phase = 0;
+    control_current_target = 0;
+    control_profile_mode = CONTROL_MODE_OFF;
+
+    return 0;
+}
+
+/**
+ * @brief Select the outermost active level
+ *
+ * @param mode New mode
+ * @return uint8_t 0 if successful, 1 on an invalid mode or before control_init() succeeded
+ */
+uint8_t control_set_mode(Control_ModeTypeDef mode)
+{
+    Encoder_SnapshotTypeDef observer;
+
+    if (mode > CONTROL_MODE_POSITION) return 1;
+    if (!control_encoder && mode != CONTROL_MODE_OFF) return 1;
+
+    if (mode == CONTROL_MODE_POSITION && control_mode != CONTROL_MODE_POSITION &&
+        encoder_get_snapshot(control_encoder, &observer)) {
+        profile_set_position_target(&control_profile, observer.Position);
+    }
+
+    /* The speed ISR stops writing the current setpoint once this returns */
+    speed_enable(mode >= CONTROL_MODE_SPEED);
+    if (mode == CONTROL_MODE_CURRENT && control_mode != CONTROL_MODE_CURRENT) {
+        control_current_target = 0;
+    }
+
+    if (control_mode == CONTROL_MODE_OFF && mode != CONTROL_MODE_OFF) {
+        pid_q15_reset(&control_current_pid);
+    }
+    control_mode = mode;
+
+    return 0;
+}
+
+/**
+ * @brief Get the active mode
+ *
+ * @return Control_ModeTypeDef Active mode
+ */
+Control_ModeTypeDef control_get_mode(void)
+{
+    return control_mode;
+}
+
+/**
+ * @brief Current loop update (called from ADC_IRQHandler)
+ *
+ * @details Runs once per new injected sample. The JEOC interrupt shares the
+ *          vector with the watchdog trip, so a trip in the same period has
+ *          already cut the enable line and is seen here.
+ */
+void control_current_irq_handler(void)
+{
+    Inject_SampleTypeDef sample;
+    int32_t measured;
+    int16_t duty;
+
+    if (!inject_get(&sample) || sample.count == control_sample_count) return;
+    control_sample_count = sample.count;
+
+    if (control_mode == CONTROL_MODE_OFF) return;
+
+    /* The shunt sees the magnitude, the bridge direction gives the sign */
+    measured = calib_to_units(ADC_RANK_CURRENT, sample.value);
+    if (pwm_get_duty() < 0) measured = -measured;
+
+    control_status.mode = control_mode;
+    control_status.target_ma = control_current_target;
+    control_status.measured_ma = measured;
+    control_status.updates++;
+
+    if (!gpio_read(MOTOR_ENABLE_PORT, MOTOR_ENABLE_PIN) || protect_is_tripped()) {
+        pid_q15_reset(&control_current_pid);
+        control_status.saturated = 0;
+        control_status.duty = 0;
+        pwm_set_duty(0);
+        return;
+    }
+
+    duty = pid_q15_update(&control_current_pid, control_current_q15(control_status.target_ma),
+                          control_current_q15(measured));
+    control_status.saturated = control_current_pid.saturated;
+    control_status.duty = duty;
+    pwm_set_duty(duty);
+}
+
+/**
+ * @brief Position and speed loop tick (called from the observer timer interrupt)
+ *
+ * @details Runs the profile and both loops on every control_divider-th call,
+ *          outermost first, so the speed loop acts on the setpoint of the
+ *          same tick. The profile restarts from the measured state whenever
+ *          the speed loop comes on, and carries on across speed and position
+ *          mode changes.
+ */
+void control_irq_handler(void)
+{
+    Encoder_SnapshotTypeDef observer;
+    Control_ModeTypeDef mode = control_mode;
+    int64_t mrpm;
+
+    if (!control_encoder || ++control_phase < control_divider) return;
+    control_phase = 0;
+
+    if (mode >= CONTROL_MODE_SPEED && encoder_get_snapshot(control_encoder, &observer)) {
+        if (control_profile_mode < CONTROL_MODE_SPEED) {
+            profile_reset(&control_profile, observer.Position, observer.SpeedMilliRpm);
+        }
+
+        if (mode == CONTROL_MODE_POSITION) {
+            profile_update(&control_profile, PROFILE_MODE_POSITION);
+            mrpm = control_profile.speed_mrpm +
+                   ((int64_t)control_profile.position_counts - observer.Position) * CONTROL_POSITION_KP_MRPM;
+        } else {
+            profile_update(&control_profile, PROFILE_MODE_SPEED);
+            mrpm = control_profile.speed_mrpm;
+        }
+        if (mrpm > SPEED_MAX_MRPM) mrpm = SPEED_MAX_MRPM;
+        if (mrpm < -SPEED_MAX_MRPM) mrpm = -SPEED_MAX_MRPM;
+        speed_set_target((int32_t)mrpm);
+    }
+    control_profile_mode = mode;
+
+    speed_irq_handler();
+}
+
+/**
+ * @brief Set the current setpoint
+ *
+ * @param ma Setpoint in mA, limited to +-CONTROL_CURRENT_LIMIT_MA
+ */
+void control_set_current_target(int32_t ma)
+{
+    if (ma > CONTROL_CURRENT_LIMIT_MA) ma = CONTROL_CURRENT_LIMIT_MA;
+    if (ma < -CONTROL_CURRENT_LIMIT_MA) ma = -CONTROL_CURRENT_LIMIT_MA;
+
+    control_current_target = ma;
+}
+
+/**
+ * @brief Set the speed setpoint
+ *
+ * @param mrpm Setpoint in 0.001 RPM, limited to +-SPEED_MAX_MRPM
+ */
+void control_set_speed_target(int32_t mrpm)
+{
+    profile_set_speed_target(&control_profile, mrpm);
+}
+
+/**
+ * @brief Get the speed setpoint
+ *
+ * @return int32_t Setpoint in 0.001 RPM
+ */
+int32_t control_get_speed_target(void)
+{
+    return control_profile.target_mrpm;
+}
+
+/**
+ * @brief Set the position setpoint
+ *
+ * @param counts Setpoint in encoder counts, relative to the home position
+ */
+void control_set_position_target(int32_t counts)
+{
+    profile_set_position_target(&control_profile, counts);
+}
+
+/**
+ * @brief Get the position setpoint
+ *
+ * @return int32_t Setpoint in encoder counts
+ */
+int32_t control_get_position_target(void)
+{
+    return control_profile.target_counts;
+}
+
+/**
+ * @brief Copy the progress of the speed or position move
+ *
+ * @param status Destination
+ */
+void control_get_profile_status(Profile_StatusTypeDef *status)
+{
+    profile_get_status(&control_profile, status);
+}
+
+/**
+ * @brief Copy the current loop state
+ *
+ * @details Retries until no current loop update ran during the copy. The mode
+ *          is the active one, even while the loop is off.
+ *
+ * @param status Destination
+ */
+void control_get_status(Control_StatusTypeDef *status)
+{
+    uint32_t updates;
+
+    if (!status) return;
+
+    do {
+        updates = control_status.updates;
+        status->target_ma = control_status.target_ma;
+        status->measured_ma = control_status.measured_ma;
+        status->duty = control_status.duty;
+        status->saturated = control_status.saturated;
+    } while (updates != control_status.updates);
+    status->updates = updates;
+    status->mode = control_mode;
+}
@@ -0,0 +1,194 @@
+/**
+ ******************************************************************************
+ * @file           : current.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-20
+ * @brief          : Current sensing pipeline implementation
+ ******************************************************************************
+ * @details
+ * This file implements the buffer pool behind the ADC DMA stream.
+ * The stream runs in double-buffer mode. When it finishes a target it moves
+ * on to the other one, and the ISR has a full buffer time to program the
+ * finished target with a free pool buffer. If the main loop falls behind and
+ * every spare buffer is queued or held, the ISR leaves the finished buffer in
+ * place and counts an overrun. The newest data is then dropped, but the block
+ * being processed is never overwritten.
+ *
+ * Ring indices are free-running 32-bit counters. Each is written by exactly
+ * one side and is word-sized, so it is atomic on Cortex-M4.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include "bsp.h"
+
+/* Pool state shared between DMA2 Stream0 ISR and main loop */
+Current_PipelineTypeDef current_pipeline;
+
+/**
+ * @brief Get the first sample of a pool buffer
+ *
+ * @param buffer Pool buffer index
+ * @return volatile uint16_t* Buffer start inside current_adcBuffer
+ */
+static volatile uint16_t *current_pipeline_buffer(uint8_t buffer)
+{
+    return &current_adcBuffer[buffer * current_pipeline.block_length];
+}
+
+/**
+ * @brief Reset the pipeline and pick the two initial DMA targets
+ *
+ * @details Queued but not yet fetched blocks are reclaimed, while a buffer the
+ *          main loop still holds stays out of the free ring. This keeps
+ *          re-initialization after a burst capture safe mid-block.
+ *
+ * @param block_length Samples per buffer, a multiple of channels
+ * @param channels Interleaved channels per frame
+ * @return uint8_t 0 if successful, 1 if fewer than two buffers are free
+ */
+uint8_t current_pipeline_init(uint16_t block_length, uint8_t channels)
+{
+    uint32_t free_count = 0;
+
+    /* Free, queued and DMA-owned buffers are all unheld */
+    for (uint8_t i = 0; i < CURRENT_POOL_BUFFERS; i++) {
+        if (!current_pipeline.held[i]) {
+            current_pipeline.free[free_count++] = i;
+        }
+    }
+    if (free_count < 2) {
+        return 1;
+    }
+
+    current_pipeline.target[0] = current_pipeline.free[0];
+    current_pipeline.target[1] = current_pipeline.free[1];
+    current_pipeline.free_tail = 2;
+    current_pipeline.free_head = free_count;
+    current_pipeline.ready_head = 0;
+    current_pipeline.ready_tail = 0;
+    current_pipeline.published = 0;
+    current_pipeline.overrun = 0;
+    current_pipeline.block_length = block_length;
+    current_pipeline.channels = channels;
+
+    return 0;
+}
+
+/**
+ * @brief Get the address of an initial DMA target
+ *
+ * @param target 0 for M0AR, 1 for M1AR
+ * @return uint32_t Buffer address to program into the stream
+ */
+uint32_t current_pipeline_target_address(uint8_t target)
+{
+    return (uint32_t)current_pipeline_buffer(current_pipeline.target[target & 0x01]);
+}
+
+/**
+ * @brief Queue the filled buffer and refill the idle target (called from the DMA ISR)
+ *
+ * @details On transfer complete CT has already toggled, so the finished buffer
+ *          sits in the other target. That target is idle for a whole buffer
+ *          time and may be reprogrammed.
+ */
+void current_pipeline_post(void)
+{
+    uint8_t idle = dma_get_current_target(DMA2, DMA_STREAM0) ^ 0x01;
+    uint8_t filled = current_pipeline.target[idle];
+    uint8_t next;
+
+    if (current_pipeline.free_tail == current_pipeline.free_head) {
+        current_pipeline.overrun++;  /* No spare buffer left: refill the same one */
+        return;
+    }
+
+    next = current_pipeline.free[current_pipeline.free_tail & CURRENT_POOL_MASK];
+    current_pipeline.free_tail++;
+    dma_set_memory_address(DMA2, DMA_STREAM0, idle, (uint32_t)current_pipeline_buffer(next));
+    current_pipeline.target[idle] = next;
+
+    current_pipeline.sequence[filled] = ++current_pipeline.published;
+    current_pipeline.ready[current_pipeline.ready_head & CURRENT_POOL_MASK] = filled;
+    __DMB();  /* Slot contents before the index that publishes them */
+    current_pipeline.ready_head++;
+}
+
+/**
+ * @brief Fetch the oldest queued block
+ *
+ * @param block Pointer to block descriptor to fill
+ * @return uint8_t 1 if a block was returned, 0 if nothing is pending
+ */
+uint8_t current_pipeline_get(Current_BlockTypeDef *block)
+{
+    uint32_t tail = current_pipeline.ready_tail;
+    uint8_t buffer;
+
+    if (!block || tail == current_pipeline.ready_head) {
+        return 0;
+    }
+    __DMB();
+
+    buffer = current_pipeline.ready[tail & CURRENT_POOL_MASK];
+    current_pipeline.ready_tail = tail + 1;
+    current_pipeline.held[buffer] = 1;  /* Held by the caller until released */
+
+    block->data = current_pipeline_buffer(buffer);
+    block->length = current_pipeline.block_length;
+    block->channels = current_pipeline.channels;
+    block->buffer = buffer;
+    block->resolution = CURRENT_RAW_RESOLUTION;
+    block->sequence = current_pipeline.sequence[buffer];
+
+    return 1;
+}
+
+/**
+ * @brief Return a held block's buffer to the pool
+ *
+ * @param block Block obtained from current_pipeline_get()
+ * @return uint8_t 0 if the buffer was returned, 1 if the block was not held
+ */
+uint8_t current_pipeline_release(const Current_BlockTypeDef *block)
+{
+    uint8_t buffer;
+
+    if (!block || block->buffer >= CURRENT_POOL_BUFFERS) return 1;
+
+    buffer = block->buffer;
+    if (!current_pipeline.held[buffer]) return 1;
+
+    current_pipeline.held[buffer] = 0;
+    current_pipeline.free[current_pipeline.free_head & CURRENT_POOL_MASK] = buffer;
+    __DMB();
+    current_pipeline.free_head++;
+
+    return 0;
+}
+
+/**
+ * @brief Locate the sample DMA wrote most recently
+ *
+ * @details NDTR restarts at the block length when CT toggles, so a full
+ *          counter means the last sample closed the other target.
+ *
+ * @return uint16_t Index into current_adcBuffer
+ */
+uint16_t current_pipeline_last_index(void)
+{
+    uint8_t active = dma_get_current_target(DMA2, DMA_STREAM0);
+    uint16_t written = current_pipeline.block_length - dma_get_counter(DMA2, DMA_STREAM0);
+    uint8_t buffer;
+
+    if (written == 0) {
+        buffer = current_pipeline.target[active ^ 0x01];
+        written = current_pipeline.block_length;
+    } else {
+        buffer = current_pipeline.target[active];
+    }
+
+    return (uint16_t)(buffer * current_pipeline.block_length + written - 1);
+}
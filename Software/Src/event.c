@@ -20,9 +20,16 @@
 
 /* Global timer variables for periodic scanning */
 SysTick_Timer_t encoder_timer;      // Timer for encoder position/speed monitoring
-SysTick_Timer_t current_timer;      // Timer for current monitoring
+SysTick_Timer_t calib_timer;        // Timer for VDDA tracking and unit reports
 Encoder_HandleTypeDef motor_encoder; // Global encoder handle for system-wide access
 
+/* Per-edge speed: DMA ring of edge timestamps and the ripple statistics of one report period */
+static volatile uint32_t encoder_edge_buffer[ENCODER_EDGE_BUFFER_SIZE];
+static uint32_t edge_count = 0;
+static int64_t edge_sum_mrpm = 0;
+static int32_t edge_min_mrpm = 0;
+static int32_t edge_max_mrpm = 0;
+
 /* Global button variables for system control */
 Button_HandleTypeDef button_up;      // UP button (PE9)
 Button_HandleTypeDef button_down;    // DOWN button (PE10)  
@@ -35,40 +42,45 @@ Button_HandleTypeDef *button_array[] = {&button_up, &button_down, &button_enter,
  * @brief Initialize motor control system
  * 
  * @details This function performs complete motor system initialization:
- *          1. Configures motor control GPIO pins as outputs
- *          2. Sets initial motor states (enabled, forward direction)  
+ *          1. Configures the enable pin as output and starts the bridge PWM
+ *          2. Sets initial motor states (enabled, full forward duty)  
  *          3. Configures encoder GPIO pins for TIM2 input capture
  *          4. Initializes encoder with quadrature decoding
  *          5. Starts encoder counting for position feedback
+ *          6. Starts the tracking observer and the speed loop on TIM7
+ *          7. Streams the timestamp of every timed edge into the edge ring by DMA
  * 
  * @note Motor control pins:
- *       - PB0 (MOTOR_P_PIN): Motor positive control
- *       - PB1 (MOTOR_M_PIN): Motor negative control  
+ *       - PB0 (MOTOR_P_PIN): Motor positive control, TIM3_CH3 PWM
+ *       - PB1 (MOTOR_M_PIN): Motor negative control, TIM3_CH4 PWM
  *       - PE7 (MOTOR_ENABLE_PIN): Motor enable control
  *       - PB2: Additional GPIO output
  * 
  * @note Encoder pins:
- *       - PA2 (ENCODER_CH1_PIN): Encoder A phase input (TIM2_CH1)
- *       - PA3 (ENCODER_CH2_PIN): Encoder B phase input (TIM2_CH2)
+ *       - PA2 (ENCODER_CH3_PIN): Encoder A phase input (TIM2_CH3)
+ *       - PA3 (ENCODER_CH4_PIN): Encoder B phase input (TIM2_CH4)
+ *       - PB10 (ENCODER_INDEX_PIN): Encoder Z index input (TIM2_CH3), only with
+ *         ENCODER_INDEX_ENABLE since it shares the channel with PA2
  * 
  * @warning This function assumes RCC clocks are already enabled for:
- *          GPIOA, GPIOB, GPIOE, and TIM2 peripherals
+ *          GPIOA, GPIOB, GPIOE, TIM2, TIM3, TIM5, TIM7 and DMA1 peripherals
  */
 void motor_init(void)
 {
-    /* Configure motor control pins as GPIO outputs */
+    /* Configure motor control GPIO outputs */
     gpio_init(GPIOB, 2, GPIO_MODE_OUTPUT, GPIO_OTYPE_PP, GPIO_SPEED_MED, GPIO_NOPULL);    // Additional GPIO output
-    gpio_init(MOTOR_P_PORT, MOTOR_P_PIN, GPIO_MODE_OUTPUT, GPIO_OTYPE_PP, GPIO_SPEED_MED, GPIO_NOPULL);        // Motor P control
-    gpio_init(MOTOR_M_PORT, MOTOR_M_PIN, GPIO_MODE_OUTPUT, GPIO_OTYPE_PP, GPIO_SPEED_MED, GPIO_NOPULL);        // Motor M control
     gpio_init(MOTOR_ENABLE_PORT, MOTOR_ENABLE_PIN, GPIO_MODE_OUTPUT, GPIO_OTYPE_PP, GPIO_SPEED_MED, GPIO_NOPULL); // Motor enable
 
     /* Configure motor pin initial states */
     gpio_write(MOTOR_ENABLE_PORT, MOTOR_ENABLE_PIN, 1);    // Enable motor driver
-    gpio_write(MOTOR_P_PORT, MOTOR_P_PIN, 1);              // Set forward direction (P=1, M=0)
-    gpio_write(MOTOR_M_PORT, MOTOR_M_PIN, 0);              // Set forward direction (P=1, M=0)
+    pwm_init(MOTOR_PWM_FREQ_HZ);                           // P/M as PWM, full forward (P on, M off)
 
     /* Configure encoder GPIO pins for TIM2 input capture on PA2/PA3 (CH3/CH4) */
     encoder_gpio_init(ENCODER_TIM, ENCODER_CH3_PORT, ENCODER_CH3_PIN, ENCODER_CH4_PORT, ENCODER_CH4_PIN, 1);  
+#if ENCODER_INDEX_ENABLE
+    gpio_init(ENCODER_INDEX_PORT, ENCODER_INDEX_PIN, GPIO_MODE_AF, GPIO_OTYPE_PP, GPIO_SPEED_HIGH, GPIO_PULLUP);
+    gpio_set_af(ENCODER_INDEX_PORT, ENCODER_INDEX_PIN, 1);   // Z pulse latches the count in hardware
+#endif
     
     /* Initialize encoder with TIM2 */
     static Encoder_InitTypeDef encoder_config = {
@@ -76,12 +88,32 @@ void motor_init(void)
         .CountsPerRevolution = 1000,                      // Adjust based on your encoder specification
         .IC1Polarity = ENCODER_IC_POLARITY_RISING,        // A phase rising edge polarity
         .IC2Polarity = ENCODER_IC_POLARITY_RISING,        // B phase rising edge polarity
-        .MaxCount = 0xFFFF                                // 16-bit timer maximum count value
+        .MaxCount = 0,                                    // Unused: TIM2 counts the full 32-bit range
+        .TimestampTIMx = ENCODER_TS_TIM,                  // M/T speed: A edges timestamped by TIM5
+        .TimestampITR = ENCODER_TS_ITR,
+        .IndexChannel = ENCODER_INDEX_CH,                 // Revolution counting and homing on Z, if enabled
+        .IndexPolarity = ENCODER_IC_POLARITY_RISING
     };
     
     /* Initialize and start encoder counting */
     encoder_init(&motor_encoder, &encoder_config);        // Configure TIM2 in encoder mode
     encoder_start(&motor_encoder);                        // Start counting encoder pulses
+    encoder_edge_start(&motor_encoder, ENCODER_EDGE_DMA, ENCODER_EDGE_DMA_STREAM, ENCODER_EDGE_DMA_CHANNEL,
+                       encoder_edge_buffer, ENCODER_EDGE_BUFFER_SIZE);
+
+    /* Tracking observer and outer loops, updated at a fixed rate from the TIM7 interrupt */
+    uint32_t observer_rate = tim_set_frequency(ENCODER_OBS_TIM, ENCODER_OBS_RATE_HZ);
+    if (encoder_observer_init(&motor_encoder, observer_rate, ENCODER_OBS_BANDWIDTH_HZ)) {
+        SEGGER_RTT_printf(0, "Encoder observer init failed at %u Hz - control modes disabled\r\n", observer_rate);
+    } else if (control_init(&motor_encoder, observer_rate)) {   // Off until a setpoint arrives
+        SEGGER_RTT_printf(0, "Control init failed (%u CPR, %u Hz) - control modes disabled\r\n",
+                          motor_encoder.CountsPerRevolution, observer_rate);
+    }
+    tim_clear_update_flag(ENCODER_OBS_TIM);
+    tim_enable_update_interrupt(ENCODER_OBS_TIM);
+    NVIC_SetPriority(TIM7_IRQn, 2);                       // Below the ADC trip and the DMA hand-off
+    NVIC_EnableIRQ(TIM7_IRQn);
+    tim_enable(ENCODER_OBS_TIM);
 }
 
 /**
@@ -143,14 +175,30 @@ void button_system_init(void)
 }
 
 
+/**
+ * @brief Switch the control mode, reporting a refusal
+ *
+ * @param mode New mode
+ * @return uint8_t 0 if the mode is active, 1 if control did not initialize
+ */
+static uint8_t control_request_mode(Control_ModeTypeDef mode)
+{
+    if (control_set_mode(mode)) {
+        SEGGER_RTT_printf(0, "Control not initialized - see the startup log\r\n");
+        return 1;
+    }
+
+    return 0;
+}
+
 /**
  * @brief Process button state changes and handle button events
  * 
  * @details This function performs two main operations:
  *          1. Checks all buttons in the button manager when the scan timer expires
  *          2. Processes button press events to perform corresponding actions:
- *             - UP button: Could be used for navigation or increasing values
- *             - DOWN button: Could be used for navigation or decreasing values
+ *             - UP button: Raises the speed setpoint and engages the speed loop
+ *             - DOWN button: Triggers a scope capture
  *             - ENTER button: Toggles motor operation (start/stop)
  *             - RETURN button: Performs emergency stop by disabling motor
  * 
@@ -172,62 +220,148 @@ void button_handler(void)
         }
     }
     /* Handle button events for motor control */
-    // UP Button (PE9): Increase motor speed or navigate up
+    // UP Button (PE9): Raise the speed setpoint one step, back to standstill after the limit
     if (button_pressed(&button_up)) {
-        SEGGER_RTT_printf(0, "UP button pressed\r\n");
-        // Add your UP button functionality here
-        // Example: increase speed, navigate menu up, etc.
+        int32_t target = control_get_speed_target() + SPEED_STEP_MRPM;
+        if (target > SPEED_MAX_MRPM) target = 0;
+        if (!control_request_mode(CONTROL_MODE_SPEED)) {
+            control_set_speed_target(target);
+            SEGGER_RTT_printf(0, "UP pressed - speed setpoint %d RPM\r\n", target / 1000);
+        }
     }
     
-    // DOWN Button (PE10): Decrease motor speed or navigate down
+    // DOWN Button (PE10): Capture the current waveform around this moment
     if (button_pressed(&button_down)) {
-        SEGGER_RTT_printf(0, "DOWN button pressed\r\n");
-        // Add your DOWN button functionality here
-        // Example: decrease speed, navigate menu down, etc.
+        SEGGER_RTT_printf(0, "DOWN button pressed - scope trigger\r\n");
+        scope_trigger(SCOPE_SOURCE_BUTTON);
     }
     
     // ENTER Button (PE12): Confirm selection or start/stop motor
     if (button_pressed(&button_enter)) {
         static uint8_t motor_running = 1;  // Track motor state (initially running)
         motor_running = !motor_running;    // Toggle state
-        
-        gpio_write(MOTOR_ENABLE_PORT, MOTOR_ENABLE_PIN, motor_running);
-        SEGGER_RTT_printf(0, "ENTER pressed - Motor %s\r\n", motor_running ? "STARTED" : "STOPPED");
+        if (motor_running && burst_capture_busy()) {
+            motor_running = 0;             // No trip until the burst has handed ADC1 back
+            SEGGER_RTT_printf(0, "ENTER pressed - burst in progress, motor stays off\r\n");
+        } else {
+            if (motor_running) {
+                protect_rearm();           // Restart clears a latched overcurrent trip
+                scope_arm(CURRENT_SCOPE_POST_SAMPLES); // and frees the recorder for the next event
+            }
+
+            gpio_write(MOTOR_ENABLE_PORT, MOTOR_ENABLE_PIN, motor_running);
+            SEGGER_RTT_printf(0, "ENTER pressed - Motor %s\r\n", motor_running ? "STARTED" : "STOPPED");
+        }
     }
     
     // RETURN Button (PE11): Go back or emergency stop
     if (button_pressed(&button_return)) {
         // Emergency stop functionality
         gpio_write(MOTOR_ENABLE_PORT, MOTOR_ENABLE_PIN, 0);  // Immediately disable motor
-        gpio_write(MOTOR_P_PORT, MOTOR_P_PIN, 0);            // Stop both directions
-        gpio_write(MOTOR_M_PORT, MOTOR_M_PIN, 0);
+        control_set_mode(CONTROL_MODE_OFF);                  // No loop may drive again
+        control_set_speed_target(0);
+        pwm_set_duty(0);                                     // Stop both directions
         SEGGER_RTT_printf(0, "RETURN pressed - EMERGENCY STOP!\r\n");
     }
 }
 
+/**
+ * @brief Fold the per-edge speeds taken from the edge ring into the ripple statistics
+ */
+static void encoder_edge_drain(void)
+{
+    Encoder_EdgeTypeDef edges[32];
+    uint16_t n;
+
+    while ((n = encoder_edge_read(&motor_encoder, edges, 32)) != 0) {
+        for (uint16_t i = 0; i < n; i++) {
+            int32_t mrpm = edges[i].SpeedMilliRpm;
+
+            if (edge_count == 0 || mrpm < edge_min_mrpm) edge_min_mrpm = mrpm;
+            if (edge_count == 0 || mrpm > edge_max_mrpm) edge_max_mrpm = mrpm;
+            edge_sum_mrpm += mrpm;
+            edge_count++;
+        }
+    }
+}
+
 /**
  * @brief Process encoder feedback data and calculate speed
  * 
  * @details This function monitors encoder position and calculates motor speed:
- *          1. Checks if the encoder timer period has elapsed
- *          2. Reads current encoder position (total count)
- *          3. Calculates motor speed in RPM based on encoder counts
- *          4. Outputs debug information via SEGGER RTT
+ *          1. Drains the edge ring into the per-edge speed statistics, on every call
+ *          2. Checks if the encoder timer period has elapsed
+ *          3. Latches the total count of every registered encoder at once
+ *          4. Calculates the speed of each in RPM from the M/T edge timestamps,
+ *             without reading the counters again
+ *          5. Outputs debug information via SEGGER RTT, including the speed
+ *             ripple between edges over the period
  * 
  * @note This function is called periodically by scan_check()
  *       and uses the global encoder_timer to control update frequency
  */
 void encoder_handler(void)
 {
+    encoder_edge_drain();
+
     /* Check if encoder timer has expired */
     if (systick_timer_expired(&encoder_timer)) {
         // 添加调试信息来检查编码器状态
-        int32_t total_count = motor_encoder.TotalCount;
         uint32_t current_time = systick_get_ms();
-        int32_t rpm = encoder_calculate_speed_rpm(&motor_encoder, current_time);
         
-        SEGGER_RTT_printf(0, "TotalCount: %d, Time: %d ms, Speed: %d RPM\r\n",
-                         total_count, current_time, rpm);
+        /* Latch every axis together, then compute the speeds from those counts */
+        encoder_update_all();
+        for (uint8_t i = 0; i < encoder_get_instance_count(); i++) {
+            encoder_calculate_speed_latched(encoder_get_instance(i), current_time);
+        }
+        
+        int32_t total_count = motor_encoder.TotalCount;
+        int32_t rpm = motor_encoder.Speed;
+        int32_t mrpm = encoder_get_speed_mrpm(&motor_encoder);
+        Encoder_SnapshotTypeDef observer;
+        uint16_t angle;
+        
+        encoder_get_snapshot(&motor_encoder, &observer);
+        SEGGER_RTT_printf(0, "TotalCount: %d, Time: %d ms, Speed: %d RPM (%d mRPM), observer %d mRPM %d RPM/s\r\n",
+                         total_count, current_time, rpm, mrpm,
+                         observer.SpeedMilliRpm, observer.AccelRpmPerS);
+        if (encoder_get_angle(&motor_encoder, &angle)) {
+            SEGGER_RTT_printf(0, "Index: rev %d, angle %u, homed %u, deviation %d, errors %u\r\n",
+                             motor_encoder.Revolutions, angle, encoder_is_homed(&motor_encoder),
+                             motor_encoder.IndexDeviation, motor_encoder.IndexErrors);
+        }
+        Speed_StatusTypeDef speed;
+        speed_get_status(&speed);
+        if (speed.enabled) {
+            SEGGER_RTT_printf(0, "Speed loop: target %d mRPM, measured %d mRPM, current %d mA%s\r\n",
+                             speed.target_mrpm, speed.measured_mrpm, speed.current_ma,
+                             speed.saturated ? " (saturated)" : "");
+        }
+        Control_StatusTypeDef control;
+        control_get_status(&control);
+        if (control.mode != CONTROL_MODE_OFF) {
+            SEGGER_RTT_printf(0, "Current loop: target %d mA, measured %d mA, duty %d%s, position target %d\r\n",
+                             control.target_ma, control.measured_ma, control.duty,
+                             control.saturated ? " (saturated)" : "", control_get_position_target());
+        }
+        Profile_StatusTypeDef profile;
+        control_get_profile_status(&profile);
+        if (control.mode >= CONTROL_MODE_SPEED) {
+            SEGGER_RTT_printf(0, "Profile: %s target %d, reference %d counts %d mRPM, %u permille%s, moves %u\r\n",
+                             profile.mode == PROFILE_MODE_POSITION ? "position" : "speed", profile.target,
+                             profile.position_counts, profile.speed_mrpm, profile.progress_permille,
+                             profile.moving ? "" : " (settled)", profile.moves);
+        }
+        if (edge_count != 0) {
+            int32_t mean = (int32_t)(edge_sum_mrpm / (int32_t)edge_count);
+            int32_t ripple = edge_max_mrpm - edge_min_mrpm;
+            int32_t permille = (mean != 0) ? (int32_t)((int64_t)ripple * 1000 / (mean < 0 ? -mean : mean)) : 0;
+
+            SEGGER_RTT_printf(0, "Edges: %u, mean %d mRPM, ripple %d mRPM p-p (%d permille), overruns %u\r\n",
+                             edge_count, mean, ripple, permille, motor_encoder.EdgeOverruns);
+            edge_count = 0;
+            edge_sum_mrpm = 0;
+        }
     }
 }
 
@@ -235,29 +369,492 @@ void encoder_handler(void)
  * @brief Monitor motor current and perform safety shutdown if needed
  * 
  * @details This function processes ADC readings for motor current monitoring:
- *          1. Checks if the current timer period has elapsed
- *          2. When new ADC data is ready (flag set by DMA interrupt), calculates average
- *          3. Compares average current to critical threshold
- *          4. Performs emergency motor shutdown if current exceeds safe limits
+ *          1. Fetches every filled pool buffer, oldest first
+ *          2. Splits the scan frames into per-channel rings
+ *          3. Computes the block mean, RMS, peak-to-peak and crest factor of the raw
+ *             current samples and pushes them into the sliding-window backstop,
+ *             then oversamples them if enabled
+ *          4. Feeds the (oversampled) samples to the decimating filter chain,
+ *             whose output feeds the spectrum analyzer, and every
+ *             CURRENT_FINE_STATS_LENGTH of them to the fine statistics
+ *          5. Returns the buffer to the pool
+ *          6. Publishes the block statistics snapshots, raw and fine
+ *          7. Performs emergency motor shutdown if the window mean exceeds safe limits,
+ *             compared in 12-bit counts whatever the oversampling ratio, against
+ *             the mA limit compiled by adc_calibration_update()
+ *          8. Reports analog watchdog trips, which act before any of the above
+ *          9. Feeds the raw current samples to the transient recorder and
+ *             triggers it on either limit
  * 
- * @note This function relies on DMA to continuously fill the current_adcBuffer
- *       and set the current_adcAverageReady flag when buffer is full
+ * @note This function relies on DMA to continuously fill the pool buffers of
+ *       current_adcBuffer and queue each one through the current pipeline when full.
+ *       Cost per call is proportional to the block length, not the window length.
  */
 void current_handler(void)
 {
-    /* Check if current timer has expired */
-    if (systick_timer_expired(&current_timer)) {
-        if (current_adcAverageReady)
-        {
-            sum = 0;  // Reset sum before calculating new average
-            for (int i = 0; i < 200; i++) 
-                sum += current_adcBuffer[i];
-            current_adcAverage = sum / 200;  // Calculate average
-            if (current_adcAverage > CURRENT_CRITICAL_THRESHOLD) {
-                gpio_write(MOTOR_ENABLE_PORT, MOTOR_ENABLE_PIN, 0); // Disable motor
+    Current_BlockTypeDef raw;
+    Current_BlockTypeDef block;
+    Current_BlockTypeDef fine;
+    Stats_BlockTypeDef block_stats;
+    Protect_TripTypeDef trip;
+    int16_t filtered[CURRENT_ADC_BLOCK_SIZE];
+    uint16_t outputs;
+    static uint32_t reported_trips = 0;
+    static uint16_t fine_samples[CURRENT_FINE_STATS_LENGTH];
+    static uint16_t fine_count = 0;
+    static uint8_t fine_bits = 0;
+
+    /* Report hardware trips once, the watchdog ISR already cut the enable line */
+    if (protect_get_trip(&trip) && trip.count != reported_trips) {
+        reported_trips = trip.count;
+        SEGGER_RTT_printf(0, "Overcurrent trip #%u: ADC %u at index %u, block %u, %u us\r\n",
+                          trip.count, trip.value, trip.index, trip.sequence, trip.timestamp_us);
+        /* The tripping frame sits in the block that was being filled, published next */
+        scope_trigger_at(SCOPE_SOURCE_WATCHDOG, trip.sequence + 1,
+                         (uint16_t)((trip.index % current_pipeline.block_length) / current_pipeline.channels));
+    }
+
+    /* Drain the queue in order, DMA never writes the buffer being processed */
+    while (current_pipeline_get(&raw)) {
+        /* De-interleave all scan channels, block receives the current rank */
+        acquisition_split(&raw, &block);
+        scope_push_block(&block);                // Raw samples, before any processing
+        stats_block_compute(&block_stats, block.data, block.length);
+        block_stats.sequence = block.sequence;
+        stats_window_push_block(&current_stats, block.data, block.length);  // Backstop runs on raw frames at any k
+
+        /* Same block interface either way, resolution tells the consumers the scale */
+        oversample_process(&block, &fine);
+        outputs = filter_chain_process(&current_filter, fine.data, fine.length,
+                                       filtered, CURRENT_ADC_BLOCK_SIZE);
+        if (outputs > 0) {
+            current_adcFiltered = current_filter.latest;
+            fft_analyzer_push(&current_spectrum, filtered, outputs);
+        }
+
+        /* A few oversampled outputs per block, gathered until a snapshot is worth taking */
+        if (fine.resolution != CURRENT_RAW_RESOLUTION + fine_bits) {
+            fine_bits = fine.resolution - CURRENT_RAW_RESOLUTION;  // k changed, start over
+            fine_count = 0;
+        }
+        if (fine_bits == 0) {
+            current_fine_stats = block_stats;
+        } else {
+            for (uint16_t i = 0; i < fine.length; i++) {
+                fine_samples[fine_count++] = fine.data[i];
+                if (fine_count == CURRENT_FINE_STATS_LENGTH) {
+                    Stats_BlockTypeDef fine_stats;
+
+                    stats_block_compute_oversampled(&fine_stats, fine_samples, fine_count, fine_bits);
+                    fine_stats.sequence = block.sequence;
+                    current_fine_stats = fine_stats;
+                    fine_count = 0;
+                }
             }
-            current_adcAverageReady = 0;
         }
+
+        current_pipeline_release(&raw);
+
+        current_block_stats = block_stats;  // Readers always see a complete, valid snapshot
+        current_adcAverage = stats_window_mean(&current_stats);
+        if (current_adcAverage > current_adcCritical) {    // Backstop, the current loop stays below it
+            gpio_write(MOTOR_ENABLE_PORT, MOTOR_ENABLE_PIN, 0); // Disable motor
+            scope_trigger(SCOPE_SOURCE_THRESHOLD);
+        }
+    }
+}
+
+/**
+ * @brief Advance the current spectrum analysis by one bounded slice
+ * 
+ * @details The FFT of a full frame is spread over many main loop passes, so
+ *          this never delays the other handlers by more than one slice. The
+ *          strongest peak of each finished spectrum is reported over RTT.
+ */
+void spectrum_handler(void)
+{
+    if (!fft_analyzer_step(&current_spectrum) || current_spectrum.peaks == 0) return;
+
+    SEGGER_RTT_printf(0, "Spectrum #%u: peak %u mHz, amplitude %u\r\n",
+                      current_spectrum.sequence, current_spectrum.peak[0].frequency_mhz,
+                      current_spectrum.peak[0].amplitude);
+}
+
+/**
+ * @brief Report each new burst capture
+ * 
+ * @details Runs once burst_handler() has restored the regular path. The burst
+ *          goes through the same block statistics as the regular stream, and
+ *          the result is reported over RTT with the interleaved sample rate.
+ */
+static void burst_report(void)
+{
+    static uint32_t reported_bursts = 0;
+    Current_BlockTypeDef block;
+    Stats_BlockTypeDef burst_stats;
+
+    if (!burst_get(&block) || block.sequence == reported_bursts) return;
+    reported_bursts = block.sequence;
+
+    stats_block_compute(&burst_stats, block.data, block.length);
+    SEGGER_RTT_printf(0, "Burst #%u: %u samples at %u kS/s, mean %d mA, AC RMS %u/16, p-p %u counts, crest %u/256\r\n",
+                      block.sequence, block.length, burst_get_sample_rate() / 1000,
+                      calib_to_units(ADC_RANK_CURRENT, burst_stats.mean >> STATS_BLOCK_FRAC_BITS),
+                      burst_stats.rms, burst_stats.peak_to_peak, burst_stats.crest);
+}
+
+/* Scope readout progress, started by a command or a newly frozen record */
+static uint8_t scope_dump_uart = 0;
+static uint8_t scope_dump_header = 0;
+static int32_t scope_dump_offset = -1;  // -1 = no dump in progress
+
+/**
+ * @brief Start streaming the frozen scope record
+ * 
+ * @param uart 1 to send over UART, 0 over RTT
+ */
+static void scope_dump_start(uint8_t uart)
+{
+    if (scope_get_state() != SCOPE_STATE_FROZEN) return;
+
+    scope_dump_uart = uart;
+    scope_dump_header = 1;
+    scope_dump_offset = 0;
+}
+
+/**
+ * @brief Null the current sense offset and store the calibration
+ * 
+ * @details The motor must be disabled: the window mean is taken as zero
+ *          current, and the flash erase stalls every interrupt.
+ */
+static void calib_zero_current(void)
+{
+    Calib_ChannelTypeDef channel;
+
+    if (gpio_read(MOTOR_ENABLE_PORT, MOTOR_ENABLE_PIN)) {
+        SEGGER_RTT_printf(0, "Calibration refused: stop the motor first\r\n");
+        return;
+    }
+
+    calib_get_channel(ADC_RANK_CURRENT, &channel);
+    channel.offset_mv = (int16_t)calib_raw_to_mv(current_adcAverage);
+    calib_set_channel(ADC_RANK_CURRENT, &channel);
+    adc_calibration_update();
+
+    SEGGER_RTT_printf(0, "Current offset %d mV, %s\r\n", channel.offset_mv,
+                      calib_save() ? "save FAILED" : "saved");
+}
+
+/**
+ * @brief Time the PID variants and report the worst case per update
+ * 
+ * @details Uses a configuration with every feature on, so each update takes
+ *          its longest path.
+ */
+static void pid_benchmark_report(void)
+{
+    const Pid_ConfigTypeDef config = {
+        .kp = 2.0f, .ki = 0.02f, .kd = 0.5f, .kt = 0.05f, .d_pole = 0.8f,
+        .out_min = -0.9f, .out_max = 0.9f, .slew = 0.05f,
+        .antiwindup = PID_ANTIWINDUP_BACKCALC,
+    };
+    Pid_BenchmarkTypeDef result;
+
+    if (pid_benchmark(&config, PID_BENCHMARK_UPDATES, &result)) return;
+
+    SEGGER_RTT_printf(0, "PID cycles per update over %u: Q15 %u, Q31 %u, float %u\r\n",
+                      result.updates, result.q15_cycles, result.q31_cycles, result.f32_cycles);
+}
+
+/**
+ * @brief Report the cycle cost of the current filter chain
+ * 
+ * @details Cycles of the last and of the worst block since the chain was
+ *          started, and the last block's share of the core clock at the chain
+ *          input rate.
+ */
+static void filter_load_report(void)
+{
+    uint32_t rate = adc_sampling_get_rate() >> (2 * oversample_get_bits());
+
+    SEGGER_RTT_printf(0, "Filter R=%u at %u Hz in: %u cycles per %u samples, worst %u, load %u permille\r\n",
+                      current_filter.cic.decimation, rate, current_filter.last_cycles,
+                      current_filter.last_samples, current_filter.max_cycles,
+                      filter_chain_get_load_permille(&current_filter, rate));
+}
+
+/**
+ * @brief Report the oversampling setting over RTT
+ */
+static void oversampling_report(void)
+{
+    uint8_t bits = oversample_get_bits();
+
+    SEGGER_RTT_printf(0, "Oversampling k=%u: %u samples per output, %u-bit, %s rounding\r\n",
+                      bits, 1U << (2 * bits), CURRENT_RAW_RESOLUTION + bits,
+                      oversample_get_dither() ? "dithered" : "nearest");
+}
+
+/**
+ * @brief Report the ADC sampling rate and the filter rate it gives over RTT
+ */
+static void sample_rate_report(void)
+{
+    SEGGER_RTT_printf(0, "ADC sampling at %u Hz, filter R=%u\r\n",
+                      adc_sampling_get_rate(), current_filter.cic.decimation);
+}
+
+/**
+ * @brief Apply a setpoint typed after 's', 'i', 'p', 'k' or 'c'
+ * 
+ * @param command Command that started the entry
+ * @param value Signed value typed
+ */
+static void command_apply_entry(char command, int32_t value)
+{
+    switch (command) {
+    case 's':
+        if (control_request_mode(CONTROL_MODE_SPEED)) break;
+        control_set_speed_target(value * 1000);
+        SEGGER_RTT_printf(0, "Speed setpoint %d RPM\r\n", control_get_speed_target() / 1000);
+        break;
+    case 'i':
+        if (control_request_mode(CONTROL_MODE_CURRENT)) break;  // Entering current mode zeroes the setpoint
+        control_set_current_target(value);
+        SEGGER_RTT_printf(0, "Current setpoint %d mA\r\n", value);
+        break;
+    case 'k':
+        if (value < 0 || adc_oversampling_set((uint8_t)value, oversample_get_dither())) {
+            SEGGER_RTT_printf(0, "Oversampling k is 0 to %u\r\n", OVERSAMPLE_MAX_BITS);
+            break;
+        }
+        oversampling_report();
+        break;
+    case 'c':
+        if (burst_capture_busy()) {
+            SEGGER_RTT_printf(0, "Burst still in progress\r\n");
+            break;
+        }
+        if (value < ADC_SAMPLE_RATE_MIN_HZ) {
+            SEGGER_RTT_printf(0, "ADC rate is %u Hz or more\r\n", ADC_SAMPLE_RATE_MIN_HZ);
+            break;
+        }
+        adc_sampling_set_rate((uint32_t)value);  // Clamped to the conversion limit
+        sample_rate_report();
+        break;
+    case 'p':
+        if (control_request_mode(CONTROL_MODE_POSITION)) break; // Entering position mode holds the position
+        control_set_position_target(value);
+        SEGGER_RTT_printf(0, "Position setpoint %d counts\r\n", control_get_position_target());
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Poll single-character commands on USART2
+ * 
+ * @details Commands:
+ *          - 't': Trigger a scope capture
+ *          - 'a': Re-arm the scope, discarding the frozen record
+ *          - 'd': Dump the frozen record over UART
+ *          - 'r': Dump the frozen record over RTT
+ *          - 'z': Null the current offset with the motor stopped, and save
+ *          - 'h': Home the encoder, the next index pulse becomes count 0 (needs ENCODER_INDEX_ENABLE)
+ *          - '+' / '-': Step the speed setpoint by SPEED_STEP_MRPM, speed mode
+ *          - 's' [-]digits CR: Set the speed setpoint in RPM, speed mode
+ *          - 'i' [-]digits CR: Set the current setpoint in mA, current mode
+ *          - 'p' [-]digits CR: Set the position setpoint in counts, position mode
+ *          - 'o': All loops off, the duty stays where it is
+ *          - 'k' digit CR: Oversample the current by 4^k, 0 to OVERSAMPLE_MAX_BITS
+ *          - 'n': Toggle dithered rounding of the oversampler
+ *          - 'c' digits CR: Set the ADC sampling rate in Hz, from
+ *                 ADC_SAMPLE_RATE_MIN_HZ up to the conversion limit
+ *          - 'b': Benchmark the PID variants, result over RTT
+ *          - 'f': Report the filter chain cycles and CPU load over RTT
+ *          - 'x': Capture one triple-interleaved burst, statistics over RTT
+ *                 once regular sampling is back (motor stopped only: the
+ *                 trip and the current loop pause until then)
+ */
+void command_handler(void)
+{
+    static int8_t entry_sign = 0;   /* Non-zero while a setpoint is being typed */
+    static char entry_command = 0;  /* Command that started the entry */
+    static int32_t entry_value = 0;
+    int16_t c = uart_receive_char(&huart2);
+
+    if (entry_sign != 0) {
+        if (c < 0) return;
+        if (c >= '0' && c <= '9') {
+            if (entry_value < COMMAND_ENTRY_MAX / 10) entry_value = entry_value * 10 + (c - '0');
+            return;
+        }
+        if (c == '-' && entry_value == 0) {
+            entry_sign = -1;
+            return;
+        }
+        if (c == '\r' || c == '\n') {
+            command_apply_entry(entry_command, entry_sign * entry_value);
+        }
+        entry_sign = 0;             /* Anything else abandons the entry */
+        entry_value = 0;
+        return;
+    }
+
+    switch (c) {
+    case 't':
+        scope_trigger(SCOPE_SOURCE_COMMAND);
+        break;
+    case 'a':
+        scope_arm(CURRENT_SCOPE_POST_SAMPLES);
+        break;
+    case 'd':
+        scope_dump_start(1);
+        break;
+    case 'r':
+        scope_dump_start(0);
+        break;
+    case 'z':
+        calib_zero_current();
+        break;
+    case 'h':
+        if (encoder_home_start(&motor_encoder)) {
+            SEGGER_RTT_printf(0, "No index channel, see ENCODER_INDEX_ENABLE\r\n");
+        }
+        break;
+    case '+':
+        if (!control_request_mode(CONTROL_MODE_SPEED)) {
+            control_set_speed_target(control_get_speed_target() + SPEED_STEP_MRPM);
+        }
+        break;
+    case '-':
+        if (!control_request_mode(CONTROL_MODE_SPEED)) {
+            control_set_speed_target(control_get_speed_target() - SPEED_STEP_MRPM);
+        }
+        break;
+    case 's':
+    case 'i':
+    case 'p':
+    case 'k':
+    case 'c':
+        entry_sign = 1;
+        entry_command = (char)c;
+        entry_value = 0;
+        break;
+    case 'o':
+        control_set_mode(CONTROL_MODE_OFF);
+        break;
+    case 'n':
+        adc_oversampling_set(oversample_get_bits(), !oversample_get_dither());
+        oversampling_report();
+        break;
+    case 'b':
+        pid_benchmark_report();
+        break;
+    case 'f':
+        filter_load_report();
+        break;
+    case 'x':
+        switch (burst_capture_start()) {
+        case 0:
+            break;
+        case 1:
+            SEGGER_RTT_printf(0, "Burst still in progress\r\n");
+            break;
+        default:
+            SEGGER_RTT_printf(0, "Stop the motor first, a burst pauses the overcurrent trip\r\n");
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Stream a frozen scope record
+ * 
+ * @details A newly frozen record dumps itself over RTT. Over UART a line is
+ *          formatted only once the previous one has been handed to the UART,
+ *          and the TXE interrupt sends it, so a dump never stalls the main
+ *          loop. Over RTT as many lines go out as fit without skipping.
+ */
+void scope_handler(void)
+{
+    static uint32_t reported_records = 0;
+    static char uart_text[SCOPE_TEXT_SIZE];    // Read by the USART2 interrupt until sent
+    Scope_RecordTypeDef record;
+    char rtt_text[SCOPE_TEXT_SIZE];
+    char *text;
+    uint16_t length;
+    uint16_t consumed;
+    uint8_t lines = 0;
+
+    if (scope_get_record(&record) && record.count != reported_records) {
+        reported_records = record.count;
+        scope_dump_start(0);
+    }
+    text = scope_dump_uart ? uart_text : rtt_text;
+
+    while (scope_dump_offset >= 0 && lines < 8) {
+        if (scope_get_state() != SCOPE_STATE_FROZEN) {
+            scope_dump_offset = -1;             // Re-armed mid-dump
+            break;
+        }
+        if (scope_dump_uart ? uart_tx_busy(&huart2) : SEGGER_RTT_GetAvailWriteSpace(0) < SCOPE_TEXT_SIZE) break;
+
+        if (scope_dump_header) {
+            length = scope_format_header(text);
+            scope_dump_header = 0;
+        } else {
+            length = scope_format_samples((uint16_t)scope_dump_offset, text, &consumed);
+            scope_dump_offset = (consumed > 0) ? scope_dump_offset + consumed : -1;
+        }
+
+        if (length > 0) {
+            if (scope_dump_uart) {
+                uart_transmit_it(&huart2, (const uint8_t *)text, length);
+                break;                          // Next line once this one is out
+            }
+            SEGGER_RTT_Write(0, text, length);
+        }
+        lines++;
+    }
+}
+
+/**
+ * @brief Track VDDA and report the monitored values in engineering units
+ * 
+ * @details Every calibration period VDDA is measured through VREFINT and the
+ *          current limits are recompiled to raw counts. The window mean current
+ *          and the bus voltage are reported over RTT, and with oversampling on
+ *          the mean and RMS of the oversampled stream below one count.
+ */
+void calib_handler(void)
+{
+    uint16_t vdda_mv;
+    int32_t current_ma;
+
+    if (!systick_timer_expired(&calib_timer)) return;
+
+    vdda_mv = adc_calibration_update();
+    current_ma = calib_to_units(ADC_RANK_CURRENT, current_adcAverage);
+#if ADC_SCAN_MONITOR_ENABLE
+    SEGGER_RTT_printf(0, "VDDA %u mV, current %d mA, bus %d mV, limits %u/%u counts\r\n",
+                      vdda_mv, current_ma,
+                      calib_to_units(ADC_RANK_BUS_VOLTAGE, acquisition_get_latest(ADC_RANK_BUS_VOLTAGE)),
+                      current_adcCritical, current_adcTrip);
+#else
+    SEGGER_RTT_printf(0, "VDDA %u mV, current %d mA, limits %u/%u counts\r\n",
+                      vdda_mv, current_ma, current_adcCritical, current_adcTrip);
+#endif
+    if (current_fine_stats.extra_bits > 0) {
+        SEGGER_RTT_printf(0, "Fine current (k=%u): mean %d uA, AC RMS %u/16 counts\r\n",
+                          current_fine_stats.extra_bits,
+                          calib_to_milliunits(ADC_RANK_CURRENT, current_fine_stats.mean, STATS_BLOCK_FRAC_BITS),
+                          current_fine_stats.rms);
     }
 }
 
@@ -266,9 +863,11 @@ void current_handler(void)
  * 
  * @details This function initializes the timer system for periodic scanning:
  *          1. Encoder scanning timer (100ms period, auto-reload)
- *          2. Current monitoring timer (1ms period, auto-reload)
+ *          2. Calibration timer (1s period, auto-reload) for VDDA tracking
  *          3. Button scanning timer (5ms period, auto-reload) for shared button manager
  *          
+ * @note Current monitoring has no timer: it is driven by DMA buffer-complete events
+ *          
  * @note These timers control the periodic execution of handler functions
  *       which are called by scan_check() in the main loop
  */
@@ -278,10 +877,10 @@ void scan_init(void)
     systick_timer_init(&encoder_timer, 100, 1);          // 100ms auto-reload timer
     systick_timer_start(&encoder_timer);                // Start timer for periodic updates
 
-    /*Initialize current timer*/
-    systick_timer_init(&current_timer, 1, 1);          // 1ms auto-reload timer
-    systick_timer_start(&current_timer);                // Start timer
 
+    /* Initialize calibration timer, VDDA drifts slowly */
+    systick_timer_init(&calib_timer, 1000, 1);          // 1s auto-reload timer
+    systick_timer_start(&calib_timer);
 
     /* Initialize shared timer for all buttons */
     systick_timer_init(&button_manager.scan_timer, 5, 1);
@@ -294,7 +893,11 @@ void scan_init(void)
  * @details This function serves as the central control point for all periodic tasks:
  *          1. Calls encoder_handler() to monitor encoder position and speed
  *          2. Calls current_handler() to monitor motor current and perform safety checks
- *          3. Calls button_handler() to process user button inputs
+ *          3. Calls spectrum_handler(), command_handler(), scope_handler() and
+ *             calib_handler() for analysis, commands and engineering units
+ *          4. Calls burst_handler() to resume regular sampling after a burst,
+ *             then reports the burst
+ *          5. Calls button_handler() to process user button inputs
  * 
  * @note This function should be called repeatedly in the main loop
  *       Each handler has its own timer and will only execute when its timer expires
@@ -303,6 +906,12 @@ void scan_check(void)
 {
     encoder_handler();  // Handle encoder events
     current_handler();  // Handle current monitoring events
+    spectrum_handler(); // Run one slice of the current spectrum analysis
+    command_handler();  // Poll UART commands
+    scope_handler();    // Stream a frozen scope record
+    calib_handler();    // Track VDDA, keep the limits in step
+    burst_handler();    // Restore regular sampling after a burst capture
+    burst_report();     // and report what it captured
     
     /* Check button states using optimized manager (all 4 buttons scanned with single timer) */
     button_handler();
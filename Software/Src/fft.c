@@ -0,0 +1,485 @@
+/**
+ ******************************************************************************
+ * @file           : fft.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-26
+ * @brief          : Incremental Q15 FFT spectrum analyzer implementation
+ ******************************************************************************
+ * @details
+ * This file implements the spectrum analyzer as a small state machine. The
+ * transform is a decimation-in-frequency FFT on packed Q15 complex samples.
+ * Every radix-4 butterfly halves twice and every radix-2 butterfly halves
+ * once, so the output is the DFT divided by N and no stage can overflow.
+ * The halving instructions round down. Left alone, that bias adds up over
+ * the stages and lands in the low bins, so the radix-4 butterfly adds one
+ * LSB to two of its inputs. The first halving then rounds up, the second
+ * down, and the two cancel. Twiddle products, window and magnitude round to
+ * nearest.
+ *
+ * Each radix-4 butterfly stores its two middle outputs swapped. This makes
+ * the final order plain bit reversal for radix-4 and mixed radix-2/4
+ * transforms alike, and the magnitude pass reads the bins through a
+ * reversed index instead of permuting the buffer.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include <math.h>
+#include "fft.h"
+
+#define FFT_TABLE_MASK  (FFT_MAX_POINTS - 1)
+
+/* One full sine period in Q15, FFT_MAX_POINTS entries, shared by all analyzers */
+static int16_t fft_sin_table[FFT_MAX_POINTS];
+static uint8_t fft_table_ready = 0;
+
+#if FFT_USE_SIMD
+#define fft_hadd(a, b)  __SHADD16((a), (b))     /* (a + b) / 2 per halfword */
+#define fft_hsub(a, b)  __SHSUB16((a), (b))     /* (a - b) / 2 per halfword */
+#define fft_hsax(a, b)  __SHSAX((a), (b))       /* (a - j*b) / 2 */
+#define fft_hasx(a, b)  __SHASX((a), (b))       /* (a + j*b) / 2 */
+#define fft_bias(a)     __QADD16((a), 0x00010001UL) /* a + 1 + j, saturated */
+#else
+/**
+ * @brief Pack a complex sample
+ */
+static inline uint32_t fft_pack(int32_t re, int32_t im)
+{
+    return (uint16_t)re | ((uint32_t)(uint16_t)im << 16);
+}
+
+static inline int32_t fft_re(uint32_t x) { return (int16_t)(x & 0xFFFF); }
+static inline int32_t fft_im(uint32_t x) { return (int16_t)(x >> 16); }
+
+/* Portable equivalents of the halving SIMD instructions, same rounding (floor) */
+static inline uint32_t fft_hadd(uint32_t a, uint32_t b)
+{
+    return fft_pack((fft_re(a) + fft_re(b)) >> 1, (fft_im(a) + fft_im(b)) >> 1);
+}
+
+static inline uint32_t fft_hsub(uint32_t a, uint32_t b)
+{
+    return fft_pack((fft_re(a) - fft_re(b)) >> 1, (fft_im(a) - fft_im(b)) >> 1);
+}
+
+static inline uint32_t fft_hsax(uint32_t a, uint32_t b)
+{
+    return fft_pack((fft_re(a) + fft_im(b)) >> 1, (fft_im(a) - fft_re(b)) >> 1);
+}
+
+static inline uint32_t fft_hasx(uint32_t a, uint32_t b)
+{
+    return fft_pack((fft_re(a) - fft_im(b)) >> 1, (fft_im(a) + fft_re(b)) >> 1);
+}
+
+/* Saturating a + 1 + j, same as QADD16 with one in each halfword */
+static inline uint32_t fft_bias(uint32_t a)
+{
+    return fft_pack((fft_re(a) < INT16_MAX) ? fft_re(a) + 1 : INT16_MAX,
+                    (fft_im(a) < INT16_MAX) ? fft_im(a) + 1 : INT16_MAX);
+}
+#endif
+
+/**
+ * @brief Get the packed twiddle factor W^index = cos - j*sin
+ *
+ * @param index Angle in units of 2*pi / FFT_MAX_POINTS
+ * @return uint32_t Cosine in the low halfword, minus sine in the high halfword
+ */
+static inline uint32_t fft_twiddle(uint32_t index)
+{
+    int16_t s = fft_sin_table[index & FFT_TABLE_MASK];
+    int16_t c = fft_sin_table[(index + FFT_MAX_POINTS / 4) & FFT_TABLE_MASK];
+
+    return (uint16_t)c | ((uint32_t)(uint16_t)(-s) << 16);
+}
+
+/**
+ * @brief Multiply a packed sample by a packed twiddle factor
+ *
+ * @param x Complex sample
+ * @param w Twiddle factor from fft_twiddle()
+ * @return uint32_t Rotated sample, saturated
+ */
+static inline uint32_t fft_cmul(uint32_t x, uint32_t w)
+{
+#if FFT_USE_SIMD
+    int32_t re = (int32_t)__SMUSD(x, w);        /* xr*wr - xi*wi */
+    int32_t im = (int32_t)__SMUADX(x, w);       /* xr*wi + xi*wr */
+    return __PKHBT((uint32_t)__SSAT((re + (1 << 14)) >> 15, 16),
+                   (uint32_t)__SSAT((im + (1 << 14)) >> 15, 16), 16);
+#else
+    int32_t re = (fft_re(x) * fft_re(w) - fft_im(x) * fft_im(w) + (1 << 14)) >> 15;
+    int32_t im = (fft_re(x) * fft_im(w) + fft_im(x) * fft_re(w) + (1 << 14)) >> 15;
+    if (re > INT16_MAX) re = INT16_MAX;
+    if (re < INT16_MIN) re = INT16_MIN;
+    if (im > INT16_MAX) im = INT16_MAX;
+    if (im < INT16_MIN) im = INT16_MIN;
+    return fft_pack(re, im);
+#endif
+}
+
+/**
+ * @brief Reverse the low bits of an index
+ *
+ * @param index Value to reverse
+ * @param bits Number of bits
+ * @return uint32_t Bit-reversed index
+ */
+static inline uint32_t fft_bit_reverse(uint32_t index, uint8_t bits)
+{
+#if defined(__arm__)
+    return __RBIT(index) >> (32 - bits);
+#else
+    uint32_t result = 0;
+    for (uint8_t i = 0; i < bits; i++) {
+        result = (result << 1) | (index & 1);
+        index >>= 1;
+    }
+    return result;
+#endif
+}
+
+/**
+ * @brief Integer square root
+ *
+ * @param value Radicand
+ * @return uint32_t floor(sqrt(value))
+ */
+static uint32_t fft_isqrt32(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (value > root) ? root + 1 : root;  /* Remainder past root + 1/2 rounds up */
+}
+
+/**
+ * @brief Apply mean removal and the Hann window to a slice of the frame
+ *
+ * @param analyzer Pointer to analyzer structure
+ * @param end One past the last sample of the slice
+ */
+static void fft_window(FFT_AnalyzerTypeDef *analyzer, uint16_t end)
+{
+    int32_t mean = (analyzer->sum + (1 << (analyzer->log2_points - 1))) >> analyzer->log2_points;
+    uint32_t stride = FFT_MAX_POINTS >> analyzer->log2_points;
+
+    for (uint16_t n = analyzer->position; n < end; n++) {
+        /* w(n) = (1 - cos(2*pi*n/N)) / 2 */
+        int32_t c = fft_sin_table[(n * stride + FFT_MAX_POINTS / 4) & FFT_TABLE_MASK];
+        int32_t w = (INT16_MAX - c) >> 1;
+        int32_t x = (int16_t)(analyzer->work[n] & 0xFFFF) - mean;
+
+        if (x > INT16_MAX) x = INT16_MAX;
+        if (x < INT16_MIN) x = INT16_MIN;
+        analyzer->work[n] = (uint16_t)((x * w + (1 << 14)) >> 15);  /* Imaginary part zero */
+    }
+}
+
+/**
+ * @brief Run a slice of the leading radix-2 stage
+ *
+ * @param analyzer Pointer to analyzer structure
+ * @param end One past the last butterfly of the slice
+ */
+static void fft_radix2(FFT_AnalyzerTypeDef *analyzer, uint16_t end)
+{
+    uint32_t *x = analyzer->work;
+    uint16_t half = analyzer->points >> 1;
+    uint32_t stride = FFT_MAX_POINTS >> analyzer->log2_points;
+
+    for (uint16_t j = analyzer->position; j < end; j++) {
+        uint32_t a = x[j];
+        uint32_t b = x[j + half];
+
+        x[j] = fft_hadd(a, b);
+        x[j + half] = fft_cmul(fft_hsub(a, b), fft_twiddle(j * stride));
+    }
+}
+
+/**
+ * @brief Run a slice of one radix-4 stage
+ *
+ * @details Butterflies are numbered across the whole stage, so a slice may
+ *          start and end in the middle of a group.
+ *
+ * @param analyzer Pointer to analyzer structure
+ * @param end One past the last butterfly of the slice
+ */
+static void fft_radix4(FFT_AnalyzerTypeDef *analyzer, uint16_t end)
+{
+    uint32_t *x = analyzer->work;
+    uint16_t quarter = analyzer->span >> 2;
+    uint32_t stride = FFT_MAX_POINTS / analyzer->span;
+
+    for (uint16_t j = analyzer->position; j < end; j++) {
+        uint16_t k = j % quarter;
+        uint32_t *p = &x[(j - k) * 4 + k];
+        uint32_t x0 = fft_bias(p[0]);
+        uint32_t x1 = fft_bias(p[quarter]);
+        uint32_t x2 = p[2 * quarter];
+        uint32_t x3 = p[3 * quarter];
+        uint32_t s02 = fft_hadd(x0, x2);
+        uint32_t d02 = fft_hsub(x0, x2);
+        uint32_t s13 = fft_hadd(x1, x3);
+        uint32_t d13 = fft_hsub(x1, x3);
+
+        /* Middle outputs swapped: X2 goes to the second slot, X1 to the third */
+        p[0] = fft_hadd(s02, s13);
+        p[quarter] = fft_cmul(fft_hsub(s02, s13), fft_twiddle(2 * k * stride));
+        p[2 * quarter] = fft_cmul(fft_hsax(d02, d13), fft_twiddle(k * stride));
+        p[3 * quarter] = fft_cmul(fft_hasx(d02, d13), fft_twiddle(3 * k * stride));
+    }
+}
+
+/**
+ * @brief Compute a slice of the bin magnitudes
+ *
+ * @param analyzer Pointer to analyzer structure
+ * @param end One past the last bin of the slice
+ */
+static void fft_magnitude(FFT_AnalyzerTypeDef *analyzer, uint16_t end)
+{
+    for (uint16_t k = analyzer->position; k < end; k++) {
+        uint32_t x = analyzer->work[fft_bit_reverse(k, analyzer->log2_points)];
+        int32_t re = (int16_t)(x & 0xFFFF);
+        int32_t im = (int16_t)(x >> 16);
+
+        analyzer->magnitude[k] = (uint16_t)fft_isqrt32((uint32_t)(re * re) + (uint32_t)(im * im));
+    }
+}
+
+/**
+ * @brief Pick the strongest local maxima of the magnitude spectrum
+ *
+ * @details The fractional bin offset comes from a parabola through the peak
+ *          and its neighbours. A full-scale sine of amplitude A gives A/4 in
+ *          its bin: 1/2 for the one-sided spectrum and 1/2 for the Hann
+ *          coherent gain.
+ *
+ * @param analyzer Pointer to analyzer structure
+ */
+static void fft_peaks(FFT_AnalyzerTypeDef *analyzer)
+{
+    const uint16_t *m = analyzer->magnitude;
+    uint16_t bins = analyzer->points >> 1;
+    uint8_t count = 0;
+
+    for (uint16_t k = FFT_PEAK_MIN_BIN; k + 1 < bins; k++) {
+        uint8_t slot;
+
+        if (m[k] == 0 || m[k] <= m[k - 1] || m[k] < m[k + 1]) continue;
+
+        /* Insertion into the list sorted by magnitude, largest first */
+        slot = count;
+        while (slot > 0 && analyzer->peak[slot - 1].magnitude < m[k]) {
+            if (slot < FFT_MAX_PEAKS) {
+                analyzer->peak[slot] = analyzer->peak[slot - 1];
+            }
+            slot--;
+        }
+        if (slot >= FFT_MAX_PEAKS) continue;
+
+        {
+            int32_t left = m[k - 1];
+            int32_t right = m[k + 1];
+            int32_t curvature = 2 * (int32_t)m[k] - left - right;
+            int32_t offset_q8 = (curvature > 0) ? ((right - left) * 128) / curvature : 0;
+            uint64_t bin_q8 = ((uint64_t)k << 8) + offset_q8;
+
+            analyzer->peak[slot].bin = k;
+            analyzer->peak[slot].magnitude = m[k];
+            analyzer->peak[slot].amplitude = (uint32_t)m[k] << 2;
+            analyzer->peak[slot].frequency_mhz = (uint32_t)((bin_q8 * analyzer->sample_rate_hz * 1000) >>
+                                                            (analyzer->log2_points + 8));
+        }
+        if (count < FFT_MAX_PEAKS) count++;
+    }
+
+    analyzer->peaks = count;
+}
+
+/**
+ * @brief Initialize a spectrum analyzer
+ *
+ * @param analyzer Pointer to analyzer structure
+ * @param points Transform length, power of two from FFT_MIN_POINTS to FFT_MAX_POINTS
+ * @param sample_rate_hz Rate of the samples that will be pushed
+ * @return uint8_t 0 if successful, 1 if a parameter is out of range
+ */
+uint8_t fft_analyzer_init(FFT_AnalyzerTypeDef *analyzer, uint16_t points, uint32_t sample_rate_hz)
+{
+    uint8_t log2_points = 0;
+
+    if (!analyzer || points < FFT_MIN_POINTS || points > FFT_MAX_POINTS ||
+        (points & (points - 1)) != 0 || sample_rate_hz == 0) {
+        return 1;
+    }
+
+    while ((1U << log2_points) < points) {
+        log2_points++;
+    }
+
+    if (!fft_table_ready) {
+        for (uint32_t i = 0; i < FFT_MAX_POINTS; i++) {
+            float s = sinf(6.28318530718f * (float)i / (float)FFT_MAX_POINTS) * 32768.0f;
+            int32_t q = (int32_t)(s + ((s < 0.0f) ? -0.5f : 0.5f));
+            if (q > INT16_MAX) q = INT16_MAX;
+            if (q < -INT16_MAX) q = -INT16_MAX;  /* Keeps -sin representable */
+            fft_sin_table[i] = (int16_t)q;
+        }
+        fft_table_ready = 1;
+    }
+
+    analyzer->points = points;
+    analyzer->log2_points = log2_points;
+    analyzer->sample_rate_hz = sample_rate_hz;
+    analyzer->state = FFT_STATE_COLLECT;
+    analyzer->fill = 0;
+    analyzer->sum = 0;
+    analyzer->position = 0;
+    analyzer->peaks = 0;
+    analyzer->sequence = 0;
+
+    for (uint16_t i = 0; i < FFT_MAX_POINTS / 2; i++) {
+        analyzer->magnitude[i] = 0;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Feed samples into the frame being collected
+ *
+ * @param analyzer Pointer to analyzer structure
+ * @param samples Signed Q15 samples
+ * @param length Number of samples
+ */
+void fft_analyzer_push(FFT_AnalyzerTypeDef *analyzer, const int16_t *samples, uint16_t length)
+{
+    if (!analyzer || !samples || analyzer->points == 0) return;
+
+    for (uint16_t i = 0; i < length && analyzer->state == FFT_STATE_COLLECT; i++) {
+        analyzer->work[analyzer->fill] = (uint16_t)samples[i];
+        analyzer->sum += samples[i];
+
+        if (++analyzer->fill == analyzer->points) {
+            analyzer->state = FFT_STATE_WINDOW;
+            analyzer->position = 0;
+        }
+    }
+}
+
+/**
+ * @brief Run one bounded slice of the analysis
+ *
+ * @param analyzer Pointer to analyzer structure
+ * @return uint8_t 1 if this call finished a spectrum, 0 otherwise
+ */
+uint8_t fft_analyzer_step(FFT_AnalyzerTypeDef *analyzer)
+{
+    uint16_t items;
+    uint16_t end;
+
+    if (!analyzer || analyzer->state == FFT_STATE_COLLECT) return 0;
+
+    switch (analyzer->state) {
+    case FFT_STATE_WINDOW:
+        items = analyzer->points;
+        break;
+    case FFT_STATE_RADIX2:
+        items = analyzer->points >> 1;
+        break;
+    case FFT_STATE_RADIX4:
+        items = analyzer->points >> 2;
+        break;
+    case FFT_STATE_MAGNITUDE:
+        items = analyzer->points >> 1;
+        break;
+    default:
+        items = 0;
+        break;
+    }
+
+    end = analyzer->position + FFT_STEP_ITEMS;
+    if (end > items) end = items;
+
+    switch (analyzer->state) {
+    case FFT_STATE_WINDOW:
+        fft_window(analyzer, end);
+        break;
+    case FFT_STATE_RADIX2:
+        fft_radix2(analyzer, end);
+        break;
+    case FFT_STATE_RADIX4:
+        fft_radix4(analyzer, end);
+        break;
+    case FFT_STATE_MAGNITUDE:
+        fft_magnitude(analyzer, end);
+        break;
+    default:
+        fft_peaks(analyzer);
+        break;
+    }
+
+    analyzer->position = end;
+    if (end < items) return 0;
+
+    /* Phase finished: pick the next one */
+    analyzer->position = 0;
+    switch (analyzer->state) {
+    case FFT_STATE_WINDOW:
+        if (analyzer->log2_points & 1) {
+            analyzer->state = FFT_STATE_RADIX2;
+            analyzer->span = analyzer->points >> 1;  /* Radix-4 stages then work on each half */
+        } else {
+            analyzer->state = FFT_STATE_RADIX4;
+            analyzer->span = analyzer->points;
+        }
+        return 0;
+    case FFT_STATE_RADIX2:
+        analyzer->state = FFT_STATE_RADIX4;
+        return 0;
+    case FFT_STATE_RADIX4:
+        analyzer->span >>= 2;
+        if (analyzer->span < 4) {
+            analyzer->state = FFT_STATE_MAGNITUDE;
+        }
+        return 0;
+    case FFT_STATE_MAGNITUDE:
+        analyzer->state = FFT_STATE_PEAKS;
+        return 0;
+    default:
+        /* Spectrum complete, start collecting the next frame */
+        analyzer->sequence++;
+        analyzer->fill = 0;
+        analyzer->sum = 0;
+        analyzer->state = FFT_STATE_COLLECT;
+        return 1;
+    }
+}
+
+/**
+ * @brief Get the frequency resolution
+ *
+ * @param analyzer Pointer to analyzer structure
+ * @return uint32_t Bin spacing in mHz, 0 if not initialized
+ */
+uint32_t fft_analyzer_get_resolution_mhz(const FFT_AnalyzerTypeDef *analyzer)
+{
+    if (!analyzer || analyzer->points == 0) return 0;
+
+    return (uint32_t)(((uint64_t)analyzer->sample_rate_hz * 1000) >> analyzer->log2_points);
+}
@@ -0,0 +1,168 @@
+/**
+ ******************************************************************************
+ * @file           : inject.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-28
+ * @brief          : PWM-synchronized injected current sampling implementation
+ ******************************************************************************
+ * @details
+ * This file implements the injected current sample. The PWM trigger channel
+ * fires half a sampling window before the valley, so the capacitor tracks the
+ * input symmetrically around the on-time center. The trigger is a rising
+ * edge, so only the down-counting crossing starts a conversion, exactly once
+ * per period.
+ *
+ * Each sample costs one conversion time of the ADC. It also aborts the
+ * regular conversion in progress, which starts over once the injected one is
+ * done, so in the worst case the slowest regular rank is lost as well. Both
+ * are taken away from the regular group, and adc_sampling_set_rate() accounts
+ * for them through inject_get_adc_load().
+ *
+ * Slow channels borrow the group now and then: the PWM trigger is switched
+ * off, one software-started conversion runs, and the current channel and its
+ * trigger are put back. The interrupt ignores the group meanwhile.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include "bsp.h"
+
+static volatile Inject_SampleTypeDef inject_sample;  /* Written by the ISR only */
+static uint32_t inject_conversion_cycles = 0;
+static uint32_t inject_channel = 0;
+static uint32_t inject_sampling_time = 0;
+static volatile uint8_t inject_borrowed = 0;        /* 1 while inject_convert() owns the group */
+
+/**
+ * @brief Start PWM-synchronized sampling of one channel
+ *
+ * @param channel ADC1 channel carrying the motor current (ADC_CHANNEL_x)
+ * @param sampling_time Sample time selection (ADC_SAMPLETIME_xxx)
+ */
+void inject_init(uint32_t channel, uint32_t sampling_time)
+{
+    uint32_t conversion = adc_get_conversion_cycles(ADC1, sampling_time);
+    /* Sampling part only: drop the conversion cycles, which do not depend on the sample time */
+    uint32_t window = conversion - adc_get_conversion_cycles(ADC1, ADC_SAMPLETIME_3CYCLES) + 3;
+    uint32_t tim_clock = tim_get_clock_freq(MOTOR_PWM_TIM);
+    uint32_t adc_clock = adc_get_clock_freq();
+
+    inject_conversion_cycles = conversion;
+    inject_channel = channel;
+    inject_sampling_time = sampling_time;
+
+    /* Half the sampling window ahead of the valley, in PWM timer ticks */
+    pwm_set_trigger_lead((uint16_t)((window * tim_clock / adc_clock + 1) / 2));
+
+    adc_config_injected(ADC1, channel, sampling_time,
+                        ADC_INJECTEDTRIG_T3_CC2, ADC_INJECTEDTRIGCONV_RISING);
+    adc_injected_enable_interrupt(ADC1);
+
+    /* Same vector as the watchdog trip, highest priority keeps latency bounded */
+    NVIC_SetPriority(ADC_IRQn, 0);
+    NVIC_EnableIRQ(ADC_IRQn);
+}
+
+/**
+ * @brief Injected end-of-conversion handler (called from ADC_IRQHandler)
+ *
+ * @details The latency is read first, before any other work in the handler.
+ *          It covers sampling, conversion and interrupt entry.
+ */
+void inject_irq_handler(void)
+{
+    uint16_t latency;
+
+    if (inject_borrowed || !(ADC1->SR & ADC_SR_JEOC)) return;
+
+    latency = pwm_get_ticks_since_trigger();
+    ADC1->SR = (uint32_t)~(ADC_SR_JEOC | ADC_SR_JSTRT);
+
+    inject_sample.value = adc_get_injected_value(ADC1);
+    inject_sample.latency = latency;
+    if (latency > inject_sample.max_latency) {
+        inject_sample.max_latency = latency;
+    }
+    inject_sample.count++;
+}
+
+/**
+ * @brief Convert one slow channel on the borrowed injected group
+ *
+ * @details Waits for a PWM-triggered conversion still running, converts the
+ *          channel once by software start and restores the current sampling.
+ *          The PWM periods and regular triggers falling into the conversion
+ *          are lost, so call it rarely.
+ *
+ * @param channel ADC1 channel (ADC_CHANNEL_x)
+ * @param sampling_time Sample time selection (ADC_SAMPLETIME_xxx)
+ * @param value Destination for the raw result
+ * @return uint8_t 0 if successful, 1 if ADC1 is off or not set up, or on timeout
+ */
+uint8_t inject_convert(uint32_t channel, uint32_t sampling_time, uint16_t *value)
+{
+    uint32_t timeout = INJECT_CONVERT_TIMEOUT;
+
+    if (!value || inject_conversion_cycles == 0 || !(ADC1->CR2 & ADC_CR2_ADON)) return 1;
+
+    inject_borrowed = 1;
+    adc_injected_disable_interrupt(ADC1);
+    ADC1->CR2 &= ~ADC_CR2_JEXTEN;
+
+    /* A started conversion without its end flag is still running */
+    while ((ADC1->SR & (ADC_SR_JSTRT | ADC_SR_JEOC)) == ADC_SR_JSTRT && --timeout) { }
+
+    adc_config_injected(ADC1, channel, sampling_time, 0, ADC_INJECTEDTRIGCONV_NONE);
+    adc_start_injected_conversion(ADC1);
+    while (!(ADC1->SR & ADC_SR_JEOC) && --timeout) { }
+    *value = adc_get_injected_value(ADC1);
+
+    /* Also clears the flags of the borrowed conversion */
+    adc_config_injected(ADC1, inject_channel, inject_sampling_time,
+                        ADC_INJECTEDTRIG_T3_CC2, ADC_INJECTEDTRIGCONV_RISING);
+    adc_injected_enable_interrupt(ADC1);
+    inject_borrowed = 0;
+
+    return (timeout != 0) ? 0 : 1;
+}
+
+/**
+ * @brief Copy the latest synchronized sample
+ *
+ * @details Retries until no interrupt updated the record during the copy.
+ *
+ * @param sample Destination
+ * @return uint8_t 1 if at least one sample was taken, 0 otherwise
+ */
+uint8_t inject_get(Inject_SampleTypeDef *sample)
+{
+    uint32_t count;
+
+    if (!sample) return 0;
+
+    do {
+        count = inject_sample.count;
+        sample->value = inject_sample.value;
+        sample->latency = inject_sample.latency;
+        sample->max_latency = inject_sample.max_latency;
+    } while (count != inject_sample.count);
+    sample->count = count;
+
+    return (count != 0) ? 1 : 0;
+}
+
+/**
+ * @brief Get the ADC time used by injected conversions
+ *
+ * @details Worst case per trigger: the injected conversion plus the longest
+ *          regular rank, which it may interrupt just before the end.
+ *
+ * @return uint32_t ADCCLK cycles per second taken from the regular group
+ */
+uint32_t inject_get_adc_load(void)
+{
+    if (inject_conversion_cycles == 0) return 0;
+
+    return (inject_conversion_cycles + acquisition_get_rank_cycles()) * pwm_get_frequency();
+}
@@ -19,28 +19,44 @@
 /**
  * @brief DMA2 Stream0 interrupt handler
  * 
- * This interrupt is triggered when DMA completes transferring data.
- * Only sets flags and clears interrupt flags to minimize interrupt processing time.
+ * This interrupt is triggered when DMA fills one double-buffer target, or when a
+ * triple-interleaved burst has filled the burst buffer.
+ * Only swaps in a free pool buffer and queues the filled one to minimize interrupt processing time.
  */
 void DMA2_Stream0_IRQHandler(void)
 {
-    // Half-transfer complete interrupt
-    if (DMA2->LISR & DMA_LISR_HTIF0) {
-        // Clear half-transfer complete flag
-        DMA2->LIFCR = DMA_LIFCR_CHTIF0;
-        // No processing here - moved to main loop
+    // Burst capture borrows this stream: only its single transfer complete matters
+    if (burst_capture_active()) {
+        if (DMA2->LISR & DMA_LISR_TCIF0) {
+            DMA2->LIFCR = DMA_LIFCR_CTCIF0;
+            burst_capture_irq_handler();
+        }
+        return;
     }
     
-    // Transfer complete interrupt
+    // Transfer complete interrupt: one double-buffer target is full, DMA switched to the other
     if (DMA2->LISR & DMA_LISR_TCIF0) {
         // Clear transfer complete flag
         DMA2->LIFCR = DMA_LIFCR_CTCIF0;
-        
-        // Set flag to notify main loop that new data is ready
-        current_adcAverageReady = 1;
+        current_pipeline_post();
     }
 }
 
+/**
+ * @brief ADC1/ADC2/ADC3 global interrupt handler
+ * 
+ * This interrupt is triggered by the ADC1 analog watchdog when a current sample
+ * exceeds the trip threshold, and by the end of each PWM-synchronized injected
+ * conversion. Runs at the highest priority to cut the motor enable line
+ * immediately; the trip is always handled first, the current loop last.
+ */
+void ADC_IRQHandler(void)
+{
+    protect_irq_handler();
+    inject_irq_handler();
+    control_current_irq_handler();  // Current loop on the sample just taken
+}
+
 /**
  * @brief SysTick interrupt handler
  * 
@@ -54,14 +70,76 @@ void SysTick_Handler(void)
 }
 
 /**
- * @brief TIM2 interrupt handler for encoder
+ * @brief TIM7 interrupt handler for the encoder tracking observers and outer loops
+ * 
+ * This interrupt is triggered by the TIM7 update event at ENCODER_OBS_RATE_HZ.
+ * Advances the observer of every registered encoder by one fixed step, then
+ * lets the position and speed loops run on their own divided rate.
+ */
+void TIM7_IRQHandler(void)
+{
+    if (tim_get_update_flag(ENCODER_OBS_TIM)) {
+        tim_clear_update_flag(ENCODER_OBS_TIM);
+        encoder_observer_update_all();
+        control_irq_handler();  // Position and speed loops every SPEED_LOOP_RATE_HZ, on the fresh estimate
+    }
+}
+
+/**
+ * @brief USART2 interrupt handler
+ * 
+ * Only TXE is enabled, while a scope readout line is being sent.
+ */
+void USART2_IRQHandler(void)
+{
+    uart_irq_handler(&huart2);
+}
+
+/**
+ * @brief Encoder timer interrupt handlers
  * 
- * This interrupt is triggered by TIM2 CC3/CC4 events for encoder input capture.
- * Calls the encoder interrupt handler to process quadrature signals.
+ * Each vector hands its timer to the encoder registry, which finds the handle
+ * registered by encoder_init(). TIM2 and TIM5 count over the full 32-bit range,
+ * so encoder_init() leaves their update interrupt disabled and only an index
+ * capture reaches their vector. TIM1 and TIM8 share their update vector with
+ * TIM10 and TIM13, which are not used, and take the index on their CC vector.
  */
+void TIM1_UP_TIM10_IRQHandler(void)
+{
+    encoder_irq_dispatch(TIM1);
+}
+
+void TIM1_CC_IRQHandler(void)
+{
+    encoder_irq_dispatch(TIM1);
+}
+
 void TIM2_IRQHandler(void)
 {
-    // Call encoder interrupt handler with global motor encoder handle
-    extern Encoder_HandleTypeDef motor_encoder;
-    encoder_tim2_irq_handler(&motor_encoder);
+    encoder_irq_dispatch(TIM2);
+}
+
+void TIM3_IRQHandler(void)
+{
+    encoder_irq_dispatch(TIM3);
+}
+
+void TIM4_IRQHandler(void)
+{
+    encoder_irq_dispatch(TIM4);
+}
+
+void TIM5_IRQHandler(void)
+{
+    encoder_irq_dispatch(TIM5);
+}
+
+void TIM8_UP_TIM13_IRQHandler(void)
+{
+    encoder_irq_dispatch(TIM8);
+}
+
+void TIM8_CC_IRQHandler(void)
+{
+    encoder_irq_dispatch(TIM8);
 }
@@ -0,0 +1,134 @@
+/**
+ ******************************************************************************
+ * @file           : oversample.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-27
+ * @brief          : Oversample-and-decimate stage implementation
+ ******************************************************************************
+ * @details
+ * This file implements the oversampling stage. Plain mode adds half an output
+ * LSB before the shift, which rounds to nearest. Dither mode adds a uniform
+ * pseudo-random offset below one output LSB instead. The result is then
+ * unbiased on average, and a slowly moving input does not step in a fixed
+ * pattern. This is requantization dither only. Dither at the ADC input would
+ * need an analog injection path that the board does not have.
+ *
+ * The STM32F407 ADC has no hardware oversampler, so accumulation runs here on
+ * the current rank. It costs one addition per input sample.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include "bsp.h"
+
+/* Every input block yields at most one output per 4 samples, plus a carried one */
+#define OVERSAMPLE_BUFFER_SIZE  (CURRENT_ADC_BLOCK_SIZE / 4 + 1)
+
+static uint16_t oversample_buffer[OVERSAMPLE_BUFFER_SIZE];
+static uint32_t oversample_sum = 0;
+static uint16_t oversample_count = 0;
+static uint8_t oversample_bits = CURRENT_OVERSAMPLE_BITS;
+static uint8_t oversample_dither = CURRENT_OVERSAMPLE_DITHER;
+static uint32_t oversample_lfsr = 0x12345678;
+
+/**
+ * @brief Advance the dither generator
+ *
+ * @return uint32_t Next xorshift32 value
+ */
+static uint32_t oversample_random(void)
+{
+    uint32_t x = oversample_lfsr;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    oversample_lfsr = x;
+
+    return x;
+}
+
+/**
+ * @brief Select the oversampling ratio
+ *
+ * @param extra_bits k, 0 (bypass) to OVERSAMPLE_MAX_BITS; the ratio is 4^k
+ * @param dither 1 to round with a pseudo-random offset, 0 to round to nearest
+ * @return uint8_t 0 if successful, 1 if extra_bits is out of range
+ */
+uint8_t oversample_configure(uint8_t extra_bits, uint8_t dither)
+{
+    if (extra_bits > OVERSAMPLE_MAX_BITS) {
+        return 1;
+    }
+
+    oversample_bits = extra_bits;
+    oversample_dither = dither ? 1 : 0;
+    oversample_sum = 0;
+    oversample_count = 0;
+
+    return 0;
+}
+
+/**
+ * @brief Get the configured number of extra bits
+ *
+ * @return uint8_t k, 0 when the stage is bypassed
+ */
+uint8_t oversample_get_bits(void)
+{
+    return oversample_bits;
+}
+
+/**
+ * @brief Get the configured rounding
+ *
+ * @return uint8_t 1 if dithered, 0 if rounded to nearest
+ */
+uint8_t oversample_get_dither(void)
+{
+    return oversample_dither;
+}
+
+/**
+ * @brief Oversample one contiguous block
+ *
+ * @param in Single-channel block, e.g. from acquisition_split()
+ * @param out Decimated block, may be empty while the accumulator fills
+ */
+void oversample_process(const Current_BlockTypeDef *in, Current_BlockTypeDef *out)
+{
+    uint8_t bits = oversample_bits;
+    uint16_t ratio = (uint16_t)(1U << (2 * bits));
+    uint32_t mask = (1UL << bits) - 1;
+    uint16_t produced = 0;
+
+    if (!in || !out) return;
+
+    if (bits == 0) {
+        *out = *in;
+        return;
+    }
+
+    for (uint16_t i = 0; i < in->length; i++) {
+        uint32_t offset;
+
+        oversample_sum += in->data[i];
+        if (++oversample_count < ratio) continue;
+
+        /* 4^k * 4095 + offset >> k stays below 2^(12 + k), no clamp needed */
+        offset = oversample_dither ? (oversample_random() & mask) : (1UL << (bits - 1));
+        if (produced < OVERSAMPLE_BUFFER_SIZE) {
+            oversample_buffer[produced++] = (uint16_t)((oversample_sum + offset) >> bits);
+        }
+        oversample_sum = 0;
+        oversample_count = 0;
+    }
+
+    out->data = oversample_buffer;
+    out->length = produced;
+    out->channels = 1;
+    out->buffer = CURRENT_BUFFER_NONE;
+    out->resolution = in->resolution + bits;
+    out->sequence = in->sequence;
+}
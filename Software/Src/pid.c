@@ -0,0 +1,515 @@
+/**
+ ******************************************************************************
+ * @file           : pid.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-09-02
+ * @brief          : PID controller library implementation
+ ******************************************************************************
+ * @details
+ * This file implements the three PID variants. Each one runs the same steps in
+ * the same order, so the variants only differ by rounding:
+ *
+ *   1. error = setpoint - measurement
+ *   2. integral += ki * error, limited to the output range
+ *   3. derivative += (1 - d_pole) * (-kd * dmeasurement - derivative)
+ *   4. output = kp * error + integral + derivative, limited, then slewed
+ *   5. anti-windup: undo step 2 if the output is limited in the direction of
+ *      the error (clamp), or add kt * (applied - unlimited output) to the
+ *      integral (back-calculation)
+ *
+ * The fixed-point updates have no data-dependent loops or divisions. The Q15
+ * update stays within 32x32 bit products, and the Q31 update uses 32x32->64
+ * bit products. Both saturate the error and the measurement step to their
+ * word size, so no intermediate result can overflow.
+ *
+ * The benchmark uses the DWT cycle counter, which only exists on the target.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include "pid.h"
+
+#define PID_Q15_ONE             32768.0f
+#define PID_Q31_ONE             2147483648.0f
+#define PID_Q15_GAIN_LIMIT      32767.5f        /* Rounds to INT16_MAX at most */
+#define PID_Q31_GAIN_LIMIT      2147483520.0f   /* Largest float below 2^31 */
+#define PID_BENCH_PERIOD        64              /* Updates per setpoint half-period */
+
+/**
+ * @brief Start the DWT cycle counter
+ */
+static void pid_cycle_counter_init(void)
+{
+#if defined(__arm__)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+/**
+ * @brief Read the DWT cycle counter
+ *
+ * @return uint32_t Core cycles, always 0 on targets without DWT
+ */
+static inline uint32_t pid_cycles(void)
+{
+#if defined(__arm__)
+    return DWT->CYCCNT;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Limit a value to a range
+ */
+static inline int32_t pid_clamp32(int32_t value, int32_t min, int32_t max)
+{
+    if (value > max) return max;
+    if (value < min) return min;
+    return value;
+}
+
+/**
+ * @brief Limit a value to a range
+ */
+static inline int64_t pid_clamp64(int64_t value, int64_t min, int64_t max)
+{
+    if (value > max) return max;
+    if (value < min) return min;
+    return value;
+}
+
+/**
+ * @brief Limit a value to a range
+ */
+static inline float pid_clampf(float value, float min, float max)
+{
+    if (value > max) return max;
+    if (value < min) return min;
+    return value;
+}
+
+/**
+ * @brief Check the parts of a configuration common to all variants
+ *
+ * @param config Configuration
+ * @return uint8_t 1 if usable, 0 otherwise
+ */
+static uint8_t pid_config_valid(const Pid_ConfigTypeDef *config)
+{
+    if (!config) return 0;
+
+    if (config->kp < 0.0f || config->ki < 0.0f || config->kd < 0.0f || config->kt < 0.0f) return 0;
+    if (config->d_pole < 0.0f || config->d_pole >= 1.0f) return 0;
+    if (config->slew < 0.0f || config->out_min > config->out_max) return 0;
+    if (config->antiwindup != PID_ANTIWINDUP_CLAMP && config->antiwindup != PID_ANTIWINDUP_BACKCALC) return 0;
+
+    return 1;
+}
+
+/**
+ * @brief Find the smallest gain exponent that fits every gain in a word
+ *
+ * @param config Configuration
+ * @param one Value of 1.0 in the word format
+ * @param limit Largest scaled gain that still fits
+ * @param max_shift Largest allowed exponent
+ * @return int8_t Exponent, -1 if the gains are too large
+ */
+static int8_t pid_gain_shift(const Pid_ConfigTypeDef *config, float one, float limit, uint8_t max_shift)
+{
+    float largest = config->kp;
+
+    if (config->ki > largest) largest = config->ki;
+    if (config->kd > largest) largest = config->kd;
+    if (config->kt > largest) largest = config->kt;
+
+    for (uint8_t shift = 0; shift <= max_shift; shift++) {
+        if (largest * one < limit) return (int8_t)shift;
+        one *= 0.5f;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Set up a Q15 controller
+ *
+ * @param pid Pointer to controller state
+ * @param config Configuration
+ * @return uint8_t 0 if successful, 1 if a gain or limit does not fit Q15
+ */
+uint8_t pid_q15_init(Pid_Q15TypeDef *pid, const Pid_ConfigTypeDef *config)
+{
+    int8_t shift;
+    float scale;
+
+    if (!pid || !pid_config_valid(config)) return 1;
+    if (config->out_min < -1.0f || config->out_max > 1.0f) return 1;
+
+    shift = pid_gain_shift(config, PID_Q15_ONE, PID_Q15_GAIN_LIMIT, PID_Q15_MAX_SHIFT);
+    if (shift < 0) return 1;
+
+    scale = PID_Q15_ONE / (float)(1U << shift);
+    pid->shift = (uint8_t)shift;
+    pid->kp = (int16_t)(config->kp * scale + 0.5f);
+    pid->ki = (int16_t)(config->ki * scale + 0.5f);
+    pid->kd = (int16_t)(config->kd * scale + 0.5f);
+    pid->kt = (int16_t)(config->kt * scale + 0.5f);
+    pid->beta = (int32_t)((1.0f - config->d_pole) * PID_Q15_ONE + 0.5f);
+    pid->antiwindup = config->antiwindup;
+
+    pid->out_min = pid_clamp32((int32_t)(config->out_min * PID_Q15_ONE), INT16_MIN, INT16_MAX);
+    pid->out_max = pid_clamp32((int32_t)(config->out_max * PID_Q15_ONE), INT16_MIN, INT16_MAX);
+    pid->slew = 0;
+    if (config->slew > 0.0f) {
+        /* Any step beyond twice full scale is as good as no limit */
+        pid->slew = (int32_t)(pid_clampf(config->slew, 0.0f, 2.0f) * PID_Q15_ONE);
+        if (pid->slew == 0) pid->slew = 1;
+    }
+
+    pid_q15_reset(pid);
+    return 0;
+}
+
+/**
+ * @brief Clear the integrator, derivative and output history
+ *
+ * @param pid Pointer to controller state
+ */
+void pid_q15_reset(Pid_Q15TypeDef *pid)
+{
+    if (!pid) return;
+
+    pid->integral = 0;
+    pid->derivative = 0;
+    pid->last_measurement = 0;
+    pid->output = (int16_t)pid_clamp32(0, pid->out_min, pid->out_max);
+    pid->primed = 0;
+    pid->saturated = 0;
+}
+
+/**
+ * @brief Run one Q15 update
+ *
+ * @details Products are at most 2^30 and the terms at most 2^22, so all but
+ *          the back-calculation product stay in 32 bits.
+ *
+ * @param pid Pointer to controller state
+ * @param setpoint Setpoint in Q15
+ * @param measurement Measurement in Q15
+ * @return int16_t Output in Q15
+ */
+int16_t pid_q15_update(Pid_Q15TypeDef *pid, int16_t setpoint, int16_t measurement)
+{
+    int32_t error, delta, raw, step, previous, unlimited, output;
+
+    if (!pid) return 0;
+
+    if (!pid->primed) {
+        pid->last_measurement = measurement;
+        pid->primed = 1;
+    }
+
+    error = pid_clamp32((int32_t)setpoint - measurement, INT16_MIN, INT16_MAX);
+
+    /* Integral in Q23: Q15 error times Q(15 - shift) gain is Q(30 - shift) */
+    previous = pid->integral;
+    step = (error * pid->ki) >> (7 - pid->shift);
+    pid->integral = pid_clamp32(previous + step, pid->out_min * 256, pid->out_max * 256);
+
+    /* Derivative on the measurement, limited to full scale before filtering */
+    delta = pid_clamp32((int32_t)measurement - pid->last_measurement, INT16_MIN, INT16_MAX);
+    pid->last_measurement = measurement;
+    raw = pid_clamp32(-((delta * pid->kd) >> (15 - pid->shift)), INT16_MIN, INT16_MAX);
+    pid->derivative += ((raw - pid->derivative) * pid->beta + (1 << 14)) >> 15;
+
+    unlimited = ((error * pid->kp) >> (15 - pid->shift)) + (pid->integral >> 8) + pid->derivative;
+    output = pid_clamp32(unlimited, pid->out_min, pid->out_max);
+    if (pid->slew) {
+        output = pid_clamp32(output, pid->output - pid->slew, pid->output + pid->slew);
+    }
+    pid->saturated = (output != unlimited);
+
+    if (pid->antiwindup == PID_ANTIWINDUP_BACKCALC) {
+        /* The correction can exceed 32 bits, but beyond the integral range it is all the same */
+        step = (int32_t)pid_clamp64(((int64_t)(output - unlimited) * pid->kt) >> (7 - pid->shift),
+                                    -(1 << 25), 1 << 25);
+        pid->integral = pid_clamp32(pid->integral + step, pid->out_min * 256, pid->out_max * 256);
+    } else if ((unlimited > output && step > 0) || (unlimited < output && step < 0)) {
+        pid->integral = previous;
+    }
+
+    pid->output = (int16_t)output;
+    return pid->output;
+}
+
+/**
+ * @brief Set up a Q31 controller
+ *
+ * @param pid Pointer to controller state
+ * @param config Configuration
+ * @return uint8_t 0 if successful, 1 if a gain or limit does not fit Q31
+ */
+uint8_t pid_q31_init(Pid_Q31TypeDef *pid, const Pid_ConfigTypeDef *config)
+{
+    int8_t shift;
+    float scale;
+
+    if (!pid || !pid_config_valid(config)) return 1;
+    if (config->out_min < -1.0f || config->out_max > 1.0f) return 1;
+
+    shift = pid_gain_shift(config, PID_Q31_ONE, PID_Q31_GAIN_LIMIT, PID_Q31_MAX_SHIFT);
+    if (shift < 0) return 1;
+
+    scale = PID_Q31_ONE / (float)(1U << shift);
+    pid->shift = (uint8_t)shift;
+    pid->kp = (int32_t)(config->kp * scale);
+    pid->ki = (int32_t)(config->ki * scale);
+    pid->kd = (int32_t)(config->kd * scale);
+    pid->kt = (int32_t)(config->kt * scale);
+    pid->beta = (uint32_t)((1.0f - config->d_pole) * PID_Q31_ONE);
+    pid->antiwindup = config->antiwindup;
+
+    pid->out_min = pid_clamp64((int64_t)(config->out_min * PID_Q31_ONE), INT32_MIN, INT32_MAX);
+    pid->out_max = pid_clamp64((int64_t)(config->out_max * PID_Q31_ONE), INT32_MIN, INT32_MAX);
+    pid->slew = 0;
+    if (config->slew > 0.0f) {
+        pid->slew = (int64_t)(pid_clampf(config->slew, 0.0f, 2.0f) * PID_Q31_ONE);
+        if (pid->slew == 0) pid->slew = 1;
+    }
+
+    pid_q31_reset(pid);
+    return 0;
+}
+
+/**
+ * @brief Clear the integrator, derivative and output history
+ *
+ * @param pid Pointer to controller state
+ */
+void pid_q31_reset(Pid_Q31TypeDef *pid)
+{
+    if (!pid) return;
+
+    pid->integral = 0;
+    pid->derivative = 0;
+    pid->last_measurement = 0;
+    pid->output = (int32_t)pid_clamp64(0, pid->out_min, pid->out_max);
+    pid->primed = 0;
+    pid->saturated = 0;
+}
+
+/**
+ * @brief Run one Q31 update
+ *
+ * @details Products are at most 2^62 and the terms at most 2^46, so the whole
+ *          update stays in 64 bits.
+ *
+ * @param pid Pointer to controller state
+ * @param setpoint Setpoint in Q31
+ * @param measurement Measurement in Q31
+ * @return int32_t Output in Q31
+ */
+int32_t pid_q31_update(Pid_Q31TypeDef *pid, int32_t setpoint, int32_t measurement)
+{
+    int64_t error, delta, raw, step, previous, unlimited, output;
+
+    if (!pid) return 0;
+
+    if (!pid->primed) {
+        pid->last_measurement = measurement;
+        pid->primed = 1;
+    }
+
+    error = pid_clamp64((int64_t)setpoint - measurement, INT32_MIN, INT32_MAX);
+
+    /* Integral in Q47: Q31 error times Q(31 - shift) gain is Q(62 - shift) */
+    previous = pid->integral;
+    step = (error * pid->ki) >> (15 - pid->shift);
+    pid->integral = pid_clamp64(previous + step, pid->out_min * 65536, pid->out_max * 65536);
+
+    /* Derivative on the measurement, limited to full scale before filtering */
+    delta = pid_clamp64((int64_t)measurement - pid->last_measurement, INT32_MIN, INT32_MAX);
+    pid->last_measurement = measurement;
+    raw = pid_clamp64(-((delta * pid->kd) >> (31 - pid->shift)), INT32_MIN, INT32_MAX);
+    pid->derivative += (int32_t)(((raw - pid->derivative) * pid->beta + (1LL << 30)) >> 31);
+
+    unlimited = ((error * pid->kp) >> (31 - pid->shift)) + (pid->integral >> 16) + pid->derivative;
+    output = pid_clamp64(unlimited, pid->out_min, pid->out_max);
+    if (pid->slew) {
+        output = pid_clamp64(output, pid->output - pid->slew, pid->output + pid->slew);
+    }
+    pid->saturated = (output != unlimited);
+
+    if (pid->antiwindup == PID_ANTIWINDUP_BACKCALC) {
+        step = output - unlimited;
+        if (step >= INT32_MIN && step <= INT32_MAX) {
+            step = (step * pid->kt) >> (15 - pid->shift);
+        } else {
+            /* Beyond full scale drop 16 bits of the excess, and stop at twice the integral range */
+            step = pid_clamp64((step >> 16) * pid->kt, -(1LL << (48 - pid->shift)), 1LL << (48 - pid->shift));
+            step *= 2LL << pid->shift;
+        }
+        pid->integral = pid_clamp64(pid->integral + step, pid->out_min * 65536, pid->out_max * 65536);
+    } else if ((unlimited > output && step > 0) || (unlimited < output && step < 0)) {
+        pid->integral = previous;
+    }
+
+    pid->output = (int32_t)output;
+    return pid->output;
+}
+
+/**
+ * @brief Set up a float controller
+ *
+ * @param pid Pointer to controller state
+ * @param config Configuration
+ * @return uint8_t 0 if successful, 1 if the limits are inverted
+ */
+uint8_t pid_f32_init(Pid_F32TypeDef *pid, const Pid_ConfigTypeDef *config)
+{
+    if (!pid || !pid_config_valid(config)) return 1;
+
+    pid->config = *config;
+    pid->beta = 1.0f - config->d_pole;
+
+    pid_f32_reset(pid);
+    return 0;
+}
+
+/**
+ * @brief Clear the integrator, derivative and output history
+ *
+ * @param pid Pointer to controller state
+ */
+void pid_f32_reset(Pid_F32TypeDef *pid)
+{
+    if (!pid) return;
+
+    pid->integral = 0.0f;
+    pid->derivative = 0.0f;
+    pid->last_measurement = 0.0f;
+    pid->output = pid_clampf(0.0f, pid->config.out_min, pid->config.out_max);
+    pid->primed = 0;
+    pid->saturated = 0;
+}
+
+/**
+ * @brief Run one float update
+ *
+ * @param pid Pointer to controller state
+ * @param setpoint Setpoint
+ * @param measurement Measurement
+ * @return float Output
+ */
+float pid_f32_update(Pid_F32TypeDef *pid, float setpoint, float measurement)
+{
+    const Pid_ConfigTypeDef *config;
+    float error, step, previous, unlimited, output;
+
+    if (!pid) return 0.0f;
+    config = &pid->config;
+
+    if (!pid->primed) {
+        pid->last_measurement = measurement;
+        pid->primed = 1;
+    }
+
+    error = setpoint - measurement;
+
+    previous = pid->integral;
+    step = config->ki * error;
+    pid->integral = pid_clampf(previous + step, config->out_min, config->out_max);
+
+    pid->derivative += pid->beta * (-config->kd * (measurement - pid->last_measurement) - pid->derivative);
+    pid->last_measurement = measurement;
+
+    unlimited = config->kp * error + pid->integral + pid->derivative;
+    output = pid_clampf(unlimited, config->out_min, config->out_max);
+    if (config->slew > 0.0f) {
+        output = pid_clampf(output, pid->output - config->slew, pid->output + config->slew);
+    }
+    pid->saturated = (output != unlimited);
+
+    if (config->antiwindup == PID_ANTIWINDUP_BACKCALC) {
+        pid->integral = pid_clampf(pid->integral + config->kt * (output - unlimited),
+                                   config->out_min, config->out_max);
+    } else if ((unlimited > output && step > 0.0f) || (unlimited < output && step < 0.0f)) {
+        pid->integral = previous;
+    }
+
+    pid->output = output;
+    return output;
+}
+
+/**
+ * @brief Time the three variants on the same input sequence
+ *
+ * @details Each variant closes the loop around a first-order plant,
+ *          y += (u - y) / 8, while the setpoint steps between +-1/2 every
+ *          PID_BENCH_PERIOD updates, so the limits and the anti-windup are
+ *          exercised. Only the update call is timed, with interrupts masked,
+ *          and the slowest update is kept.
+ *
+ * @param config Configuration used for all three
+ * @param updates Updates to time per variant
+ * @param result Destination
+ * @return uint8_t 0 if successful, 1 if the configuration is invalid
+ */
+uint8_t pid_benchmark(const Pid_ConfigTypeDef *config, uint16_t updates, Pid_BenchmarkTypeDef *result)
+{
+    Pid_Q15TypeDef q15;
+    Pid_Q31TypeDef q31;
+    Pid_F32TypeDef f32;
+    int16_t y15 = 0;
+    int32_t y31 = 0;
+    float yf = 0.0f;
+    uint32_t start, cycles;
+
+    if (!result) return 1;
+    if (pid_q15_init(&q15, config) || pid_q31_init(&q31, config) || pid_f32_init(&f32, config)) return 1;
+
+    pid_cycle_counter_init();
+    result->q15_cycles = 0;
+    result->q31_cycles = 0;
+    result->f32_cycles = 0;
+    result->updates = updates;
+
+    for (uint16_t i = 0; i < updates; i++) {
+        uint8_t high = (i / PID_BENCH_PERIOD) & 1;
+        int16_t u15;
+        int32_t u31;
+        float uf;
+#if defined(__arm__)
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+#endif
+
+        start = pid_cycles();
+        u15 = pid_q15_update(&q15, high ? 16384 : -16384, y15);
+        cycles = pid_cycles() - start;
+        if (cycles > result->q15_cycles) result->q15_cycles = cycles;
+
+        start = pid_cycles();
+        u31 = pid_q31_update(&q31, high ? 0x40000000 : -0x40000000, y31);
+        cycles = pid_cycles() - start;
+        if (cycles > result->q31_cycles) result->q31_cycles = cycles;
+
+        start = pid_cycles();
+        uf = pid_f32_update(&f32, high ? 0.5f : -0.5f, yf);
+        cycles = pid_cycles() - start;
+        if (cycles > result->f32_cycles) result->f32_cycles = cycles;
+
+#if defined(__arm__)
+        __set_PRIMASK(primask);
+#endif
+        y15 += (int16_t)((u15 - y15) >> 3);
+        y31 += (int32_t)(((int64_t)u31 - y31) >> 3);
+        yf += (uf - yf) * 0.125f;
+    }
+
+    return 0;
+}
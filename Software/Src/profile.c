@@ -0,0 +1,403 @@
+/**
+ ******************************************************************************
+ * @file           : profile.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-09-04
+ * @brief          : Jerk-limited motion profile generator implementation
+ ******************************************************************************
+ * @details
+ * This file implements the profile as an online generator. Each tick picks the
+ * jerk, +-j_max or 0, from the present state alone:
+ *
+ *   - Speed: ramping the acceleration to zero from now at full jerk still
+ *     adds (a|a| + a j) / 2j of speed. While that falls short of the speed
+ *     target the acceleration grows towards the target, otherwise it shrinks.
+ *     Acceleration and speed then integrate with their limits, which gives the
+ *     seven-segment S-curve, or fewer segments for short changes.
+ *   - Position: each tick tries to keep accelerating towards the speed limit,
+ *     then to hold the acceleration, and otherwise brakes at full jerk. A
+ *     choice is kept only if braking from the state it leads to still stops
+ *     within the remaining distance. That braking distance is exact in closed
+ *     form for the jerk-limited ramps, so the reference arrives without
+ *     overshoot. Only a target moved closer than the reference can stop in
+ *     is passed, and then approached from the far side.
+ *
+ * A reference within one jerk step of its target is snapped onto it, which
+ * ends the move without limit cycling.
+ *
+ * Internal units are counts and ticks with up to PROFILE_FRACTION_BITS_MAX
+ * fraction bits. The more counts per revolution, the larger the same limits
+ * are in counts, so init takes as many fraction bits as keep every product
+ * within 64 bits.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include "profile.h"
+
+#define PROFILE_ONE(profile)    (1LL << (profile)->fraction_bits)
+#define PROFILE_INTERNAL_LIMIT  (1L << 28)      /* Largest speed, or speed swept by a jerk ramp */
+#define PROFILE_ACCEL_LIMIT     (1L << 19)      /* Largest acceleration, keeps cubes below 2^61 */
+
+/**
+ * @brief Integer square root
+ *
+ * @details Bit-by-bit, always 32 rounds.
+ *
+ * @param x Radicand
+ * @return uint32_t floor(sqrt(x))
+ */
+static uint32_t profile_isqrt(uint64_t x)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+
+    for (uint8_t i = 0; i < 32; i++) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)root;
+}
+
+/**
+ * @brief Limit a value to a symmetric range
+ */
+static inline int64_t profile_clamp(int64_t value, int64_t limit)
+{
+    if (value > limit) return limit;
+    if (value < -limit) return -limit;
+    return value;
+}
+
+/**
+ * @brief Step a speed and acceleration one tick towards a target speed
+ *
+ * @param profile Pointer to profile handle
+ * @param target Speed to reach, within +-v_max
+ * @param velocity Speed, updated
+ * @param accel Acceleration, updated
+ */
+static void profile_step(const Profile_HandleTypeDef *profile, int32_t target, int32_t *velocity, int32_t *accel)
+{
+    int64_t a = *accel;
+    int64_t j = profile->j_max;
+    int64_t error = (int64_t)target - *velocity;
+    /* 2j times the speed still gained while a ramps to zero */
+    int64_t coast = a * (a < 0 ? -a : a) + a * j;
+
+    /* Close enough to finish on this tick */
+    if ((error < 0 ? -error : error) <= j && (a < 0 ? -a : a) <= j) {
+        *accel = 0;
+        *velocity = target;
+        return;
+    }
+
+    if (2 * j * error > coast) {
+        a += j;
+    } else if (2 * j * error < coast) {
+        a -= j;
+    }
+
+    *accel = (int32_t)profile_clamp(a, profile->a_max);
+    *velocity = (int32_t)profile_clamp((int64_t)*velocity + *accel, profile->v_max);
+}
+
+/**
+ * @brief Distance covered while braking to standstill at full jerk
+ *
+ * @details Acceleration ramps down to -a_peak, holds there if a_peak reached
+ *          a_max, and ramps back to zero as the speed runs out. From the
+ *          speed swept by the two ramps, a_peak^2 = j v + a^2 / 2. If the
+ *          present deceleration already exceeds that, the speed runs out
+ *          while it ramps back up instead.
+ *
+ * @param profile Pointer to profile handle
+ * @param v Speed, 0 or more
+ * @param a Acceleration
+ * @return int64_t Distance, internal units
+ */
+static int64_t profile_brake_distance(const Profile_HandleTypeDef *profile, int64_t v, int64_t a)
+{
+    int64_t j = profile->j_max;
+    int64_t peak_sq = j * v + a * a / 2;
+    int64_t peak, ramp, v1, v2;
+
+    if (a < 0 && peak_sq <= a * a) {
+        /* Stops at t = ramp / j while a ramps up from a */
+        ramp = -a - profile_isqrt((uint64_t)(a * a - 2 * j * v));
+        return v * ramp / j + (3 * a * ramp * ramp + ramp * ramp * ramp) / (6 * j * j);
+    }
+
+    peak = profile_isqrt((uint64_t)peak_sq);
+    if (peak > profile->a_max) peak = profile->a_max;
+
+    /* Ramp from a down to -peak, hold -peak from v1 to v2, ramp -peak back to zero */
+    ramp = a + peak;
+    v1 = v + (a * a - peak * peak) / (2 * j);
+    v2 = peak * peak / (2 * j);
+    if (v1 < v2) v1 = v2;
+
+    return (v + v1) * ramp / (2 * j) + ramp * ramp * ramp / (12 * j * j) +
+           (v1 * v1 - v2 * v2) / (2 * peak) + peak * peak * peak / (6 * j * j);
+}
+
+/**
+ * @brief Move the reference one tick towards a position
+ *
+ * @details Works in the direction of the goal. Of cruising on towards
+ *          v_max, holding the acceleration and braking at full jerk, the
+ *          first one that can still stop within the remaining distance is
+ *          taken, braking if none can.
+ *
+ * @param profile Pointer to profile handle
+ * @param goal Position to reach, internal units
+ */
+static void profile_approach(Profile_HandleTypeDef *profile, int64_t goal)
+{
+    int64_t distance = goal - profile->position;
+    int32_t sign = distance < 0 ? -1 : 1;
+    int32_t v = profile->velocity * sign;
+    int32_t a = profile->accel * sign;
+    int32_t next_v = v, next_a = a;
+
+    distance *= sign;
+
+    profile_step(profile, profile->v_max, &next_v, &next_a);
+    if (next_v > 0 && next_v + profile_brake_distance(profile, next_v, next_a) > distance) {
+        /* Nearly at rest and even the smallest step would overshoot: arrived */
+        if (v <= profile->j_max && v >= -profile->j_max && a <= profile->j_max && a >= -profile->j_max) {
+            profile->position = goal;
+            profile->velocity = 0;
+            profile->accel = 0;
+            return;
+        }
+
+        next_a = a;
+        next_v = (int32_t)profile_clamp((int64_t)v + a, profile->v_max);
+        if (next_v > 0 && next_v + profile_brake_distance(profile, next_v, next_a) > distance) {
+            next_a = (int32_t)profile_clamp((int64_t)a - profile->j_max, profile->a_max);
+            next_v = (int32_t)profile_clamp((int64_t)v + next_a, profile->v_max);
+        }
+    }
+
+    profile->accel = next_a * sign;
+    profile->velocity = next_v * sign;
+    profile->position += profile->velocity;
+}
+
+/**
+ * @brief Set the limits and units of a profile
+ *
+ * @param profile Pointer to profile handle
+ * @param init Limits and units
+ * @return uint8_t 0 if successful, 1 if the limits are out of range
+ */
+uint8_t profile_init(Profile_HandleTypeDef *profile, const Profile_InitTypeDef *init)
+{
+    float ticks_per_min, v, a, j;
+    uint8_t bits;
+
+    if (!profile || !init || init->rate_hz == 0 || init->counts_per_rev == 0 ||
+        init->max_speed_mrpm <= 0 || init->max_accel_rpm_s == 0 || init->max_jerk_rpm_s2 == 0) return 1;
+
+    /* RPM to counts per tick, then per tick again for each derivative */
+    ticks_per_min = 60.0f * init->rate_hz;
+    v = init->max_speed_mrpm / 1000.0f * init->counts_per_rev / ticks_per_min;
+    a = v / (init->max_speed_mrpm / 1000.0f) * init->max_accel_rpm_s / init->rate_hz;
+    j = a / init->max_accel_rpm_s * init->max_jerk_rpm_s2 / init->rate_hz;
+    if (a > v || j > a) return 1;
+
+    /* Each fraction bit doubles all three, take the most that still fit */
+    for (bits = PROFILE_FRACTION_BITS_MAX; bits > PROFILE_FRACTION_BITS_MIN; bits--) {
+        float one = (float)(1UL << bits);
+
+        if (v * one < PROFILE_INTERNAL_LIMIT && a * one < PROFILE_ACCEL_LIMIT &&
+            a * a / j * one < PROFILE_INTERNAL_LIMIT) break;
+    }
+    v *= (float)(1UL << bits);
+    a *= (float)(1UL << bits);
+    j *= (float)(1UL << bits);
+    if (v >= PROFILE_INTERNAL_LIMIT || a >= PROFILE_ACCEL_LIMIT || a * a / j >= PROFILE_INTERNAL_LIMIT ||
+        a < 1.0f || j < 1.0f) return 1;
+
+    profile->fraction_bits = bits;
+    profile->v_max = (int32_t)v;
+    profile->a_max = (int32_t)a;
+    profile->j_max = (int32_t)j;
+
+    profile->to_mrpm_q8 = (uint32_t)(((uint64_t)init->rate_hz * 60000 << 8) / init->counts_per_rev);
+    profile->from_mrpm_q16 = (uint32_t)(((uint64_t)init->counts_per_rev << (bits + 16)) /
+                                        ((uint64_t)init->rate_hz * 60000));
+
+    profile->target_mrpm = 0;
+    profile->target_counts = 0;
+    profile->moves = 0;
+    profile_reset(profile, 0, 0);
+
+    return 0;
+}
+
+/**
+ * @brief Restart the reference from a measured state
+ *
+ * @param profile Pointer to profile handle
+ * @param position Position in counts
+ * @param speed_mrpm Speed in 0.001 RPM
+ */
+void profile_reset(Profile_HandleTypeDef *profile, int32_t position, int32_t speed_mrpm)
+{
+    if (!profile) return;
+
+    profile->position = (int64_t)position * PROFILE_ONE(profile);
+    profile->velocity = (int32_t)profile_clamp(((int64_t)speed_mrpm * profile->from_mrpm_q16) >> 16, profile->v_max);
+    profile->accel = 0;
+    profile->position_counts = position;
+    profile->speed_mrpm = speed_mrpm;
+
+    /* The next update plans a move from here */
+    profile->mode = PROFILE_MODE_SPEED;
+    profile->planned = 0;
+    profile->goal = 0;
+    profile->start = profile->velocity;
+    profile->moving = 1;
+    profile->updates = 0;
+}
+
+/**
+ * @brief Advance the reference by one tick
+ *
+ * @details A target or mode that differs from the planned one starts a new
+ *          move from the present state. Progress is measured from there.
+ *
+ * @param profile Pointer to profile handle
+ * @param mode Target to move towards
+ */
+void profile_update(Profile_HandleTypeDef *profile, Profile_ModeTypeDef mode)
+{
+    int32_t target;
+    int64_t goal, here;
+
+    if (!profile) return;
+
+    if (mode == PROFILE_MODE_POSITION) {
+        target = profile->target_counts;
+        goal = (int64_t)target * PROFILE_ONE(profile);
+        profile_approach(profile, goal);
+        here = profile->position;
+    } else {
+        target = profile->target_mrpm;
+        goal = profile_clamp(((int64_t)target * profile->from_mrpm_q16) >> 16, profile->v_max);
+        profile_step(profile, (int32_t)goal, &profile->velocity, &profile->accel);
+        profile->position += profile->velocity;
+        here = profile->velocity;
+    }
+
+    if (mode != profile->mode || target != profile->planned) {
+        profile->mode = mode;
+        profile->planned = target;
+        profile->start = here;
+        profile->moving = 1;
+    }
+    profile->goal = goal;
+
+    if (profile->moving && here == goal && profile->accel == 0 &&
+        (mode == PROFILE_MODE_SPEED || profile->velocity == 0)) {
+        profile->moving = 0;
+        profile->moves++;
+    }
+
+    profile->position_counts = (int32_t)((profile->position + PROFILE_ONE(profile) / 2) >> profile->fraction_bits);
+    profile->speed_mrpm = (int32_t)(((int64_t)profile->velocity * profile->to_mrpm_q8) >> (profile->fraction_bits + 8));
+    profile->updates++;
+}
+
+/**
+ * @brief Set the speed target
+ *
+ * @param profile Pointer to profile handle
+ * @param mrpm Target in 0.001 RPM, limited to the speed limit
+ */
+void profile_set_speed_target(Profile_HandleTypeDef *profile, int32_t mrpm)
+{
+    int32_t limit;
+
+    if (!profile) return;
+
+    limit = (int32_t)(((int64_t)profile->v_max * profile->to_mrpm_q8) >> (profile->fraction_bits + 8));
+    if (mrpm > limit) mrpm = limit;
+    if (mrpm < -limit) mrpm = -limit;
+
+    profile->target_mrpm = mrpm;
+}
+
+/**
+ * @brief Set the position target
+ *
+ * @param profile Pointer to profile handle
+ * @param counts Target in counts
+ */
+void profile_set_position_target(Profile_HandleTypeDef *profile, int32_t counts)
+{
+    if (!profile) return;
+
+    profile->target_counts = counts;
+}
+
+/**
+ * @brief Copy the progress of the current move
+ *
+ * @details Retries until no update ran during the copy. Only the counter is
+ *          volatile, so barriers keep the field reads between its two reads.
+ *          Progress is the share of the distance, or of the speed change,
+ *          already covered.
+ *
+ * @param profile Pointer to profile handle
+ * @param status Destination
+ */
+void profile_get_status(Profile_HandleTypeDef *profile, Profile_StatusTypeDef *status)
+{
+    uint32_t updates;
+    int64_t start, goal, here, total, left;
+
+    if (!profile || !status) return;
+
+    do {
+        updates = profile->updates;
+        __DMB();
+        status->mode = profile->mode;
+        status->moving = profile->moving;
+        status->target = profile->planned;
+        status->position_counts = profile->position_counts;
+        status->speed_mrpm = profile->speed_mrpm;
+        status->moves = profile->moves;
+        start = profile->start;
+        goal = profile->goal;
+        here = (profile->mode == PROFILE_MODE_POSITION) ? profile->position : profile->velocity;
+        __DMB();
+    } while (updates != profile->updates);
+
+    total = goal - start;
+    left = goal - here;
+    if (total < 0) {
+        total = -total;
+        left = -left;
+    }
+
+    /* Passing the target on a reversal reads as nearly done, never as done */
+    if (!status->moving) {
+        status->progress_permille = 1000;
+    } else if (total == 0 || left >= total) {
+        status->progress_permille = 0;
+    } else if (left <= 0) {
+        status->progress_permille = 999;
+    } else {
+        status->progress_permille = (uint16_t)(1000 - (left * 1000 + total - 1) / total);
+    }
+}
@@ -0,0 +1,119 @@
+/**
+ ******************************************************************************
+ * @file           : protect.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-24
+ * @brief          : Analog watchdog overcurrent trip implementation
+ ******************************************************************************
+ * @details
+ * This file implements the analog watchdog trip. The ADC raises AWD as soon as
+ * one current conversion exceeds the high threshold. ADC_IRQn runs at the
+ * highest priority, so the enable line drops a few hundred nanoseconds later.
+ * The handler then disables its own interrupt, because every further sample
+ * above the threshold would re-enter it, and records where the sample sits in
+ * the sample pool.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include "bsp.h"
+
+static Protect_TripTypeDef protect_trip;     /* Written by the ISR only while armed */
+static volatile uint8_t protect_tripped = 0;
+
+/**
+ * @brief Arm the analog watchdog on the current channel
+ *
+ * @param channel ADC1 channel carrying the motor current (ADC_CHANNEL_x)
+ * @param threshold High threshold in raw ADC counts
+ */
+void protect_init(uint32_t channel, uint16_t threshold)
+{
+    adc_config_watchdog(ADC1, channel, 0, threshold);  /* Low side never trips */
+    
+    if (!protect_tripped) {
+        adc_watchdog_enable_interrupt(ADC1);
+    }
+    
+    /* Above DMA2 Stream0 so a trip is never delayed by block hand-off */
+    NVIC_SetPriority(ADC_IRQn, 0);
+    NVIC_EnableIRQ(ADC_IRQn);
+}
+
+/**
+ * @brief Move the trip threshold without touching the trip state
+ *
+ * @param threshold High threshold in raw ADC counts
+ */
+void protect_set_threshold(uint16_t threshold)
+{
+    ADC1->HTR = threshold & 0x0FFF;  /* Compared from the next conversion on */
+}
+
+/**
+ * @brief Analog watchdog interrupt handler (called from ADC_IRQHandler)
+ *
+ * @details The offending conversion was the latest one of its channel, so its
+ *          position is the frame start just before the DMA write position
+ *          inside whichever pool buffer is being filled.
+ */
+void protect_irq_handler(void)
+{
+    uint8_t channels = current_pipeline.channels;
+    uint16_t index;
+    
+    if (!(ADC1->SR & ADC_SR_AWD)) return;
+    
+    /* Cut the enable line first, bookkeeping afterwards */
+    gpio_write(MOTOR_ENABLE_PORT, MOTOR_ENABLE_PIN, 0);
+    adc_watchdog_disable_interrupt(ADC1);
+    ADC1->SR = (uint32_t)~ADC_SR_AWD;
+    protect_tripped = 1;
+    
+    /* Blocks hold whole frames, so rounding down finds the frame start */
+    index = current_pipeline_last_index();
+    index -= index % channels;
+    
+    protect_trip.count++;
+    protect_trip.timestamp_us = systick_get_us();
+    protect_trip.sequence = current_pipeline.published;
+    protect_trip.index = index;
+    protect_trip.value = current_adcBuffer[index];
+}
+
+/**
+ * @brief Check whether the trip is latched
+ *
+ * @return uint8_t 1 if tripped and not yet re-armed, 0 otherwise
+ */
+uint8_t protect_is_tripped(void)
+{
+    return protect_tripped;
+}
+
+/**
+ * @brief Copy the most recent trip record
+ *
+ * @param trip Destination record
+ * @return uint8_t 1 if at least one trip occurred, 0 otherwise
+ */
+uint8_t protect_get_trip(Protect_TripTypeDef *trip)
+{
+    if (!trip || protect_trip.count == 0) return 0;
+    
+    /* The interrupt stays disabled until protect_rearm(), so the record is stable */
+    *trip = protect_trip;
+    
+    return 1;
+}
+
+/**
+ * @brief Clear the latched trip and re-enable the watchdog interrupt
+ */
+void protect_rearm(void)
+{
+    ADC1->SR = (uint32_t)~ADC_SR_AWD;
+    protect_tripped = 0;
+    adc_watchdog_enable_interrupt(ADC1);
+}
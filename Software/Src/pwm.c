@@ -0,0 +1,163 @@
+/**
+ ******************************************************************************
+ * @file           : pwm.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-28
+ * @brief          : Motor bridge PWM implementation
+ ******************************************************************************
+ * @details
+ * This file implements the bridge PWM on MOTOR_PWM_TIM in center-aligned mode
+ * 1. The counter runs 0 -> ARR -> 0. In PWM mode 1 an output is active while
+ * CNT < CCR, so each on-time is centered on the valley at CNT = 0.
+ *
+ * The trigger channel also runs PWM mode 1, with CCR equal to the lead. Its
+ * OCREF rises only when the down-counting counter drops below the lead, so
+ * there is exactly one rising edge per period, a lead ahead of the valley.
+ * The ADC injected trigger is set to that edge.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include "bsp.h"
+
+static uint32_t pwm_frequency_hz = 0;
+static int16_t pwm_duty = 0;
+static uint16_t pwm_trigger_lead = 1;
+
+/**
+ * @brief Convert a Q15 magnitude to a compare value
+ *
+ * @param duty Duty magnitude, 0 to 32767
+ * @return uint32_t CCR value, ARR + 1 for full on
+ */
+static uint32_t pwm_duty_to_ccr(uint32_t duty)
+{
+    return (duty * (MOTOR_PWM_TIM->ARR + 1) + (1UL << 14)) >> 15;
+}
+
+/**
+ * @brief Start the bridge PWM
+ *
+ * @param freq_hz PWM frequency in Hz (one full up/down counter cycle)
+ * @return uint32_t Achieved frequency in Hz, 0 if it cannot be generated
+ */
+uint32_t pwm_init(uint32_t freq_hz)
+{
+    uint32_t clock = tim_get_clock_freq(MOTOR_PWM_TIM);
+    uint32_t arr;
+    TIM_InitTypeDef tim_config;
+    TIM_PWM_ConfigTypeDef pwm_config;
+
+    if (freq_hz == 0) return 0;
+
+    /* Up and down count per period: ARR = clock / (2 * f), full resolution without prescaler */
+    arr = (clock + freq_hz) / (2 * freq_hz);
+    if (arr < 2 || arr > 0xFFFF) return 0;
+
+    tim_disable(MOTOR_PWM_TIM);
+
+    tim_config.Prescaler = 0;
+    tim_config.Period = arr;
+    tim_config.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    tim_config.CounterMode = TIM_COUNTERMODE_CENTERALIGNED1;
+    tim_init(MOTOR_PWM_TIM, &tim_config);
+
+    pwm_config.OCMode = TIM_OCMODE_PWM1;
+    pwm_config.OCPolarity = TIM_OCPOLARITY_HIGH;
+    pwm_config.Pulse = 0;
+    pwm_config.Channel = MOTOR_PWM_CH_P;
+    tim_pwm_config(MOTOR_PWM_TIM, &pwm_config);
+    pwm_config.Channel = MOTOR_PWM_CH_M;
+    tim_pwm_config(MOTOR_PWM_TIM, &pwm_config);
+    pwm_config.Channel = MOTOR_PWM_CH_TRIGGER;  /* No pin in AF mode, drives the ADC only */
+    pwm_config.Pulse = pwm_trigger_lead;
+    tim_pwm_config(MOTOR_PWM_TIM, &pwm_config);
+
+    /* Pins switch from static GPIO levels to the timer outputs */
+    gpio_init(MOTOR_P_PORT, MOTOR_P_PIN, GPIO_MODE_AF, GPIO_OTYPE_PP, GPIO_SPEED_HIGH, GPIO_NOPULL);
+    gpio_set_af(MOTOR_P_PORT, MOTOR_P_PIN, MOTOR_PWM_AF);
+    gpio_init(MOTOR_M_PORT, MOTOR_M_PIN, GPIO_MODE_AF, GPIO_OTYPE_PP, GPIO_SPEED_HIGH, GPIO_NOPULL);
+    gpio_set_af(MOTOR_M_PORT, MOTOR_M_PIN, MOTOR_PWM_AF);
+
+    pwm_frequency_hz = clock / (2 * arr);
+    pwm_set_duty(INT16_MAX);
+
+    MOTOR_PWM_TIM->EGR = TIM_EGR_UG;  /* Load the preloaded compare values */
+    tim_enable(MOTOR_PWM_TIM);
+
+    return pwm_frequency_hz;
+}
+
+/**
+ * @brief Set the signed bridge duty cycle
+ *
+ * @param duty Q15 duty, positive drives the P input, negative the M input
+ */
+void pwm_set_duty(int16_t duty)
+{
+    uint32_t magnitude = (duty < 0) ? (uint32_t)(-(int32_t)duty) : (uint32_t)duty;
+    uint32_t ccr;
+
+    if (magnitude > INT16_MAX) magnitude = INT16_MAX;
+    ccr = pwm_duty_to_ccr(magnitude);
+
+    /* Preloaded: both inputs change together at the next update event */
+    tim_set_pwm_duty(MOTOR_PWM_TIM, MOTOR_PWM_CH_P, (duty > 0) ? ccr : 0);
+    tim_set_pwm_duty(MOTOR_PWM_TIM, MOTOR_PWM_CH_M, (duty < 0) ? ccr : 0);
+    pwm_duty = duty;
+}
+
+/**
+ * @brief Get the signed bridge duty cycle
+ *
+ * @return int16_t Q15 duty as last set
+ */
+int16_t pwm_get_duty(void)
+{
+    return pwm_duty;
+}
+
+/**
+ * @brief Place the ADC trigger ahead of the counter valley
+ *
+ * @param ticks Timer ticks before the valley, at least 1
+ */
+void pwm_set_trigger_lead(uint16_t ticks)
+{
+    if (ticks == 0) ticks = 1;
+    if (ticks >= MOTOR_PWM_TIM->ARR) ticks = (uint16_t)(MOTOR_PWM_TIM->ARR - 1);
+
+    pwm_trigger_lead = ticks;
+    tim_set_pwm_duty(MOTOR_PWM_TIM, MOTOR_PWM_CH_TRIGGER, ticks);
+}
+
+/**
+ * @brief Get the PWM frequency
+ *
+ * @return uint32_t Frequency in Hz, 0 before pwm_init()
+ */
+uint32_t pwm_get_frequency(void)
+{
+    return pwm_frequency_hz;
+}
+
+/**
+ * @brief Get the time elapsed since the last ADC trigger
+ *
+ * @details The trigger fires at CNT = lead while counting down. Down-counting
+ *          ticks left until the valley, plus up-counting ticks after it, give
+ *          the elapsed time.
+ *
+ * @return uint16_t Timer ticks since the trigger, valid within half a PWM period
+ */
+uint16_t pwm_get_ticks_since_trigger(void)
+{
+    uint16_t count = (uint16_t)MOTOR_PWM_TIM->CNT;
+
+    if (MOTOR_PWM_TIM->CR1 & TIM_CR1_DIR) {
+        return (count <= pwm_trigger_lead) ? (uint16_t)(pwm_trigger_lead - count) : 0;
+    }
+
+    return (uint16_t)(pwm_trigger_lead + count);
+}
@@ -0,0 +1,307 @@
+/**
+ ******************************************************************************
+ * @file           : scope.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-29
+ * @brief          : Pre/post-trigger transient recorder implementation
+ ******************************************************************************
+ * @details
+ * This file implements the transient recorder as a ring over CCM RAM. The
+ * write position counts samples since arming. A trigger fixes the position
+ * where the record ends, trigger sample plus the post window, and the ring
+ * freezes when the write position gets there. The pre-trigger part is whatever
+ * history the ring still holds at that point.
+ *
+ * A trigger never applies to samples already in the ring. A watchdog trip is
+ * reported while its block is still being filled, so the trigger waits for the
+ * block with the matching sequence number and then points at the exact frame.
+ *
+ * Everything runs in the main loop, no interrupt touches the recorder.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include "bsp.h"
+
+#define SCOPE_RECORD_MASK   (SCOPE_RECORD_SIZE - 1)
+
+/* NOLOAD section, not cleared at startup: only samples written since arming are read back */
+static uint16_t scope_buffer[SCOPE_RECORD_SIZE] __attribute__((section(".ccmram")));
+
+static Scope_StateTypeDef scope_state = SCOPE_STATE_ARMED;
+static uint16_t scope_post = CURRENT_SCOPE_POST_SAMPLES;
+static uint32_t scope_written = 0;      /* Samples since arming, wraps */
+static uint16_t scope_filled = 0;       /* Valid samples in the ring, saturates at the size */
+static uint32_t scope_end = 0;          /* Write position that freezes the record */
+
+static Scope_SourceTypeDef scope_pending = SCOPE_SOURCE_NONE;
+static uint8_t scope_pending_exact = 0;
+static uint32_t scope_pending_sequence = 0;
+static uint16_t scope_pending_frame = 0;
+static uint8_t scope_pending_blocks = 0;
+
+static Scope_RecordTypeDef scope_record;
+
+/**
+ * @brief Write an unsigned decimal number
+ *
+ * @param text Destination
+ * @param value Number
+ * @return uint16_t Characters written
+ */
+static uint16_t scope_format_uint(char *text, uint32_t value)
+{
+    char digits[10];
+    uint16_t count = 0;
+    uint16_t length = 0;
+
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    while (count > 0) {
+        text[length++] = digits[--count];
+    }
+
+    return length;
+}
+
+/**
+ * @brief Write a string without its terminator
+ *
+ * @param text Destination
+ * @param str Null-terminated string
+ * @return uint16_t Characters written
+ */
+static uint16_t scope_format_string(char *text, const char *str)
+{
+    uint16_t length = 0;
+
+    while (str[length] != '\0') {
+        text[length] = str[length];
+        length++;
+    }
+
+    return length;
+}
+
+/**
+ * @brief Fix the trigger sample and start the post-trigger window
+ *
+ * @param block Block holding the trigger sample
+ * @param position Write position of the trigger sample
+ */
+static void scope_start_post(const Current_BlockTypeDef *block, uint32_t position)
+{
+    scope_record.source = scope_pending;
+    scope_record.sequence = block->sequence;
+    scope_record.sample_rate_hz = adc_sampling_get_rate();
+    scope_record.resolution = block->resolution;
+
+    scope_end = position + scope_post;
+    scope_pending = SCOPE_SOURCE_NONE;
+    scope_state = SCOPE_STATE_TRIGGERED;
+}
+
+/**
+ * @brief Start a new record
+ *
+ * @param post_samples Samples to take after the trigger, including the trigger
+ *                     sample, 1 to SCOPE_RECORD_SIZE
+ */
+void scope_arm(uint16_t post_samples)
+{
+    if (post_samples == 0) post_samples = 1;
+    if (post_samples > SCOPE_RECORD_SIZE) post_samples = SCOPE_RECORD_SIZE;
+
+    scope_post = post_samples;
+    scope_written = 0;
+    scope_filled = 0;
+    scope_pending = SCOPE_SOURCE_NONE;
+    scope_state = SCOPE_STATE_ARMED;
+}
+
+/**
+ * @brief Append the samples of one single-channel block
+ *
+ * @param block Current block, e.g. from acquisition_split()
+ */
+void scope_push_block(const Current_BlockTypeDef *block)
+{
+    if (!block || block->length == 0 || scope_state == SCOPE_STATE_FROZEN) return;
+
+    if (scope_pending != SCOPE_SOURCE_NONE) {
+        if (!scope_pending_exact) {
+            scope_start_post(block, scope_written);
+        } else if (block->sequence == scope_pending_sequence) {
+            uint16_t frame = scope_pending_frame;
+            if (frame >= block->length) frame = (uint16_t)(block->length - 1);
+            scope_start_post(block, scope_written + frame);
+        } else if ((int32_t)(block->sequence - scope_pending_sequence) > 0 ||
+                   ++scope_pending_blocks > CURRENT_POOL_BUFFERS) {
+            /* Block dropped or numbering restarted: take the nearest sample we still get */
+            scope_start_post(block, scope_written);
+        }
+    }
+
+    for (uint16_t i = 0; i < block->length; i++) {
+        scope_buffer[scope_written & SCOPE_RECORD_MASK] = block->data[i];
+        scope_written++;
+        if (scope_filled < SCOPE_RECORD_SIZE) scope_filled++;
+
+        if (scope_state == SCOPE_STATE_TRIGGERED && scope_written == scope_end) {
+            scope_record.count++;
+            scope_record.length = scope_filled;
+            scope_record.pre = (uint16_t)(scope_filled - scope_post);
+            scope_state = SCOPE_STATE_FROZEN;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Trigger on the next sample
+ *
+ * @param source Trigger source
+ */
+void scope_trigger(Scope_SourceTypeDef source)
+{
+    if (scope_state != SCOPE_STATE_ARMED || scope_pending != SCOPE_SOURCE_NONE) return;
+
+    scope_pending = source;
+    scope_pending_exact = 0;
+}
+
+/**
+ * @brief Trigger on a sample that may still be in flight
+ *
+ * @param source Trigger source
+ * @param sequence Pool block sequence number holding the trigger sample
+ * @param frame Frame index of the trigger sample within that block
+ */
+void scope_trigger_at(Scope_SourceTypeDef source, uint32_t sequence, uint16_t frame)
+{
+    if (scope_state != SCOPE_STATE_ARMED || scope_pending != SCOPE_SOURCE_NONE) return;
+
+    scope_pending = source;
+    scope_pending_exact = 1;
+    scope_pending_sequence = sequence;
+    scope_pending_frame = frame;
+    scope_pending_blocks = 0;
+}
+
+/**
+ * @brief Get the recorder state
+ *
+ * @return Scope_StateTypeDef Current state
+ */
+Scope_StateTypeDef scope_get_state(void)
+{
+    return scope_state;
+}
+
+/**
+ * @brief Describe the frozen record
+ *
+ * @param record Destination
+ * @return uint8_t 1 if a record is frozen, 0 otherwise
+ */
+uint8_t scope_get_record(Scope_RecordTypeDef *record)
+{
+    if (!record || scope_state != SCOPE_STATE_FROZEN) return 0;
+
+    *record = scope_record;
+    return 1;
+}
+
+/**
+ * @brief Copy samples out of the frozen record
+ *
+ * @param offset First sample, 0 is the oldest
+ * @param dst Destination
+ * @param count Samples requested
+ * @return uint16_t Samples copied, 0 past the end or while not frozen
+ */
+uint16_t scope_read(uint16_t offset, uint16_t *dst, uint16_t count)
+{
+    uint32_t start;
+
+    if (!dst || scope_state != SCOPE_STATE_FROZEN || offset >= scope_record.length) return 0;
+
+    if (count > scope_record.length - offset) count = (uint16_t)(scope_record.length - offset);
+    start = scope_end - scope_record.length + offset;
+
+    for (uint16_t i = 0; i < count; i++) {
+        dst[i] = scope_buffer[(start + i) & SCOPE_RECORD_MASK];
+    }
+
+    return count;
+}
+
+/**
+ * @brief Format the record description as one line of text
+ *
+ * @details Example: "SCOPE #1 src=2 seq=815 rate=19736 bits=12 pre=12288 len=16384"
+ *
+ * @param text Destination, at least SCOPE_TEXT_SIZE bytes
+ * @return uint16_t Characters written, 0 while not frozen
+ */
+uint16_t scope_format_header(char *text)
+{
+    uint16_t n = 0;
+
+    if (!text || scope_state != SCOPE_STATE_FROZEN) return 0;
+
+    n += scope_format_string(&text[n], "SCOPE #");
+    n += scope_format_uint(&text[n], scope_record.count);
+    n += scope_format_string(&text[n], " src=");
+    n += scope_format_uint(&text[n], scope_record.source);
+    n += scope_format_string(&text[n], " seq=");
+    n += scope_format_uint(&text[n], scope_record.sequence);
+    n += scope_format_string(&text[n], " rate=");
+    n += scope_format_uint(&text[n], scope_record.sample_rate_hz);
+    n += scope_format_string(&text[n], " bits=");
+    n += scope_format_uint(&text[n], scope_record.resolution);
+    n += scope_format_string(&text[n], " pre=");
+    n += scope_format_uint(&text[n], scope_record.pre);
+    n += scope_format_string(&text[n], " len=");
+    n += scope_format_uint(&text[n], scope_record.length);
+    n += scope_format_string(&text[n], "\r\n");
+    text[n] = '\0';
+
+    return n;
+}
+
+/**
+ * @brief Format up to SCOPE_TEXT_SAMPLES samples as one line of text
+ *
+ * @details Comma-separated decimal values, one line per call.
+ *
+ * @param offset First sample, 0 is the oldest
+ * @param text Destination, at least SCOPE_TEXT_SIZE bytes
+ * @param consumed Receives the number of samples formatted
+ * @return uint16_t Characters written, 0 past the end or while not frozen
+ */
+uint16_t scope_format_samples(uint16_t offset, char *text, uint16_t *consumed)
+{
+    uint16_t samples[SCOPE_TEXT_SAMPLES];
+    uint16_t count;
+    uint16_t n = 0;
+
+    if (!text || !consumed) return 0;
+
+    count = scope_read(offset, samples, SCOPE_TEXT_SAMPLES);
+    *consumed = count;
+    if (count == 0) return 0;
+
+    for (uint16_t i = 0; i < count; i++) {
+        if (i > 0) text[n++] = ',';
+        n += scope_format_uint(&text[n], samples[i]);
+    }
+    n += scope_format_string(&text[n], "\r\n");
+    text[n] = '\0';
+
+    return n;
+}
@@ -0,0 +1,173 @@
+/**
+ ******************************************************************************
+ * @file           : speed.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-09-01
+ * @brief          : Closed-loop motor speed control implementation
+ ******************************************************************************
+ * @details
+ * This file implements the PI speed loop on the Q31 controller of pid.c. Speed
+ * is scaled by 2^SPEED_Q31_SHIFT into Q31, so full scale is 2^23 mRPM (about
+ * 8389 RPM). The Q31 output is the current setpoint relative to
+ * CONTROL_CURRENT_FULL_SCALE_MA, which makes it Q15 current with 16 more
+ * fraction bits. The bsp.h gains in Q16 current per mRPM then map onto the
+ * normalized gains by a single power of two.
+ *
+ * The controller uses clamping anti-windup: the integrator is limited to the
+ * duty range, and it stops growing while the output is saturated in the
+ * direction of the error. A large setpoint step then does not leave a
+ * wound-up integrator to overshoot with.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include "bsp.h"
+
+#define SPEED_Q31_SHIFT         8                           /* mRPM to Q31 speed */
+#define SPEED_Q31_LIMIT_MRPM    (((int32_t)1 << (31 - SPEED_Q31_SHIFT)) - 1)
+
+static Encoder_HandleTypeDef *speed_encoder = NULL;
+static uint16_t speed_divider = 1;          /* Interrupt calls per loop update */
+static uint16_t speed_phase = 0;
+static Pid_Q31TypeDef speed_pid;
+static volatile int32_t speed_target = 0;
+static volatile uint8_t speed_enabled = 0;
+static volatile Speed_StatusTypeDef speed_status;   /* Written by the ISR only */
+
+/**
+ * @brief Set up the speed loop, initially off
+ *
+ * @param encoder Encoder whose observer provides the speed
+ * @param call_rate_hz Rate at which speed_irq_handler() will be called, a
+ *                     multiple of SPEED_LOOP_RATE_HZ
+ * @return uint8_t 0 if successful, 1 if the rate is too low
+ */
+uint8_t speed_init(Encoder_HandleTypeDef *encoder, uint32_t call_rate_hz)
+{
+    /* Q16 current is Q31 current, and Q31 speed is mRPM times 2^SPEED_Q31_SHIFT */
+    Pid_ConfigTypeDef config = {
+        .kp = (float)SPEED_KP_Q16 / (1 << SPEED_Q31_SHIFT),
+        .ki = (float)SPEED_KI_Q16 / (1 << SPEED_Q31_SHIFT) / SPEED_LOOP_RATE_HZ,
+        .out_min = -(float)CONTROL_CURRENT_LIMIT_MA / CONTROL_CURRENT_FULL_SCALE_MA,
+        .out_max = (float)CONTROL_CURRENT_LIMIT_MA / CONTROL_CURRENT_FULL_SCALE_MA,
+        .antiwindup = PID_ANTIWINDUP_CLAMP,
+    };
+
+    if (!encoder || call_rate_hz < SPEED_LOOP_RATE_HZ) return 1;
+
+    speed_enabled = 0;
+    if (pid_q31_init(&speed_pid, &config)) return 1;
+
+    speed_encoder = encoder;
+    speed_divider = (uint16_t)(call_rate_hz / SPEED_LOOP_RATE_HZ);
+    speed_phase = 0;
+    speed_target = 0;
+
+    return 0;
+}
+
+/**
+ * @brief Speed loop update (called from control_irq_handler())
+ *
+ * @details Runs the loop on every speed_divider-th call. The observer update
+ *          of the same interrupt has completed, so the snapshot read cannot
+ *          fail here.
+ */
+void speed_irq_handler(void)
+{
+    Encoder_SnapshotTypeDef observer;
+    int32_t measured, current;
+
+    if (!speed_encoder || ++speed_phase < speed_divider) return;
+    speed_phase = 0;
+
+    encoder_get_snapshot(speed_encoder, &observer);
+    speed_status.measured_mrpm = observer.SpeedMilliRpm;
+    speed_status.target_mrpm = speed_target;
+    speed_status.enabled = speed_enabled;
+    speed_status.updates++;
+
+    if (!speed_enabled) return;
+
+    if (!gpio_read(MOTOR_ENABLE_PORT, MOTOR_ENABLE_PIN) || protect_is_tripped()) {
+        pid_q31_reset(&speed_pid);
+        speed_status.saturated = 0;
+        speed_status.current_ma = 0;
+        control_set_current_target(0);
+        return;
+    }
+
+    measured = observer.SpeedMilliRpm;
+    if (measured > SPEED_Q31_LIMIT_MRPM) measured = SPEED_Q31_LIMIT_MRPM;
+    if (measured < -SPEED_Q31_LIMIT_MRPM) measured = -SPEED_Q31_LIMIT_MRPM;
+
+    current = pid_q31_update(&speed_pid, speed_target * (1 << SPEED_Q31_SHIFT),
+                             measured * (1 << SPEED_Q31_SHIFT)) >> (16 + CONTROL_CURRENT_SHIFT);
+    speed_status.saturated = speed_pid.saturated;
+    speed_status.current_ma = current;
+    control_set_current_target(current);
+}
+
+/**
+ * @brief Turn the closed loop on or off
+ *
+ * @details Switching on starts from an empty integrator.
+ *
+ * @param enable 1 to drive the current setpoint from the loop, 0 to leave it alone
+ */
+void speed_enable(uint8_t enable)
+{
+    /* The ISR leaves the integrator alone while the loop is off */
+    if (enable && !speed_enabled) {
+        pid_q31_reset(&speed_pid);
+    }
+    speed_enabled = enable ? 1 : 0;
+}
+
+/**
+ * @brief Set the speed setpoint
+ *
+ * @param mrpm Setpoint in 0.001 RPM, limited to +-SPEED_MAX_MRPM
+ */
+void speed_set_target(int32_t mrpm)
+{
+    if (mrpm > SPEED_MAX_MRPM) mrpm = SPEED_MAX_MRPM;
+    if (mrpm < -SPEED_MAX_MRPM) mrpm = -SPEED_MAX_MRPM;
+
+    speed_target = mrpm;
+}
+
+/**
+ * @brief Get the speed setpoint
+ *
+ * @return int32_t Setpoint in 0.001 RPM
+ */
+int32_t speed_get_target(void)
+{
+    return speed_target;
+}
+
+/**
+ * @brief Copy the loop state
+ *
+ * @details Retries until no loop update ran during the copy.
+ *
+ * @param status Destination
+ */
+void speed_get_status(Speed_StatusTypeDef *status)
+{
+    uint32_t updates;
+
+    if (!status) return;
+
+    do {
+        updates = speed_status.updates;
+        status->target_mrpm = speed_status.target_mrpm;
+        status->measured_mrpm = speed_status.measured_mrpm;
+        status->current_ma = speed_status.current_ma;
+        status->enabled = speed_status.enabled;
+        status->saturated = speed_status.saturated;
+    } while (updates != speed_status.updates);
+    status->updates = updates;
+}
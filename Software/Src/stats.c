@@ -0,0 +1,291 @@
+/**
+ ******************************************************************************
+ * @file           : stats.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-21
+ * @brief          : Streaming sample statistics implementation
+ ******************************************************************************
+ * @details
+ * This file implements the sliding-window statistics stage. Each pushed sample
+ * updates the running sum (add newest, subtract the one leaving the window) and
+ * the monotonic min/max queues. Every sample enters and leaves each queue at
+ * most once, so the amortized cost per sample is constant.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include "stats.h"
+
+/**
+ * @brief Push one sample into the window
+ *
+ * @param win Pointer to window structure
+ * @param value New sample
+ */
+static void stats_window_push(Stats_WindowTypeDef *win, uint16_t value)
+{
+    uint32_t pos = win->position;
+    uint16_t pos16 = (uint16_t)pos;
+
+    /* Running sum: drop the sample leaving the window, add the new one */
+    if (win->count == win->window) {
+        win->sum -= win->samples[(pos - win->window) & STATS_WINDOW_MASK];
+    } else {
+        win->count++;
+    }
+    win->samples[pos & STATS_WINDOW_MASK] = value;
+    win->sum += value;
+
+    /* Expire queue fronts that fell out of the window */
+    if (win->min_size && (uint16_t)(pos16 - win->min_queue[win->min_head]) >= win->window) {
+        win->min_head = (win->min_head + 1) & STATS_WINDOW_MASK;
+        win->min_size--;
+    }
+    if (win->max_size && (uint16_t)(pos16 - win->max_queue[win->max_head]) >= win->window) {
+        win->max_head = (win->max_head + 1) & STATS_WINDOW_MASK;
+        win->max_size--;
+    }
+
+    /* Pop tail entries the new sample dominates, then append it */
+    while (win->min_size &&
+           win->samples[win->min_queue[(win->min_head + win->min_size - 1) & STATS_WINDOW_MASK] & STATS_WINDOW_MASK] >= value) {
+        win->min_size--;
+    }
+    win->min_queue[(win->min_head + win->min_size) & STATS_WINDOW_MASK] = pos16;
+    win->min_size++;
+
+    while (win->max_size &&
+           win->samples[win->max_queue[(win->max_head + win->max_size - 1) & STATS_WINDOW_MASK] & STATS_WINDOW_MASK] <= value) {
+        win->max_size--;
+    }
+    win->max_queue[(win->max_head + win->max_size) & STATS_WINDOW_MASK] = pos16;
+    win->max_size++;
+
+    win->position = pos + 1;
+}
+
+/**
+ * @brief Initialize a sliding window
+ *
+ * @param win Pointer to window structure
+ * @param window Window length in samples (1 to STATS_WINDOW_MAX, clamped)
+ */
+void stats_window_init(Stats_WindowTypeDef *win, uint32_t window)
+{
+    if (!win) return;
+
+    if (window == 0) window = 1;
+    if (window > STATS_WINDOW_MAX) window = STATS_WINDOW_MAX;
+
+    win->min_head = 0;
+    win->min_size = 0;
+    win->max_head = 0;
+    win->max_size = 0;
+    win->position = 0;
+    win->window = window;
+    win->count = 0;
+    win->sum = 0;
+}
+
+/**
+ * @brief Push a block of new samples into the window
+ *
+ * @param win Pointer to window structure
+ * @param data Pointer to new samples
+ * @param length Number of new samples
+ */
+void stats_window_push_block(Stats_WindowTypeDef *win, const volatile uint16_t *data, uint16_t length)
+{
+    if (!win || !data) return;
+
+    for (uint16_t i = 0; i < length; i++) {
+        stats_window_push(win, data[i]);
+    }
+}
+
+/**
+ * @brief Get the mean of the samples in the window
+ *
+ * @param win Pointer to window structure
+ * @return uint16_t Mean value, 0 if the window is empty
+ */
+uint16_t stats_window_mean(const Stats_WindowTypeDef *win)
+{
+    if (!win || win->count == 0) return 0;
+
+    return (uint16_t)(win->sum / win->count);
+}
+
+/**
+ * @brief Get the minimum sample in the window
+ *
+ * @param win Pointer to window structure
+ * @return uint16_t Minimum value, 0 if the window is empty
+ */
+uint16_t stats_window_min(const Stats_WindowTypeDef *win)
+{
+    if (!win || win->min_size == 0) return 0;
+
+    return win->samples[win->min_queue[win->min_head] & STATS_WINDOW_MASK];
+}
+
+/**
+ * @brief Get the maximum sample in the window
+ *
+ * @param win Pointer to window structure
+ * @return uint16_t Maximum value, 0 if the window is empty
+ */
+uint16_t stats_window_max(const Stats_WindowTypeDef *win)
+{
+    if (!win || win->max_size == 0) return 0;
+
+    return win->samples[win->max_queue[win->max_head] & STATS_WINDOW_MASK];
+}
+
+/**
+ * @brief Get the number of samples currently in the window
+ *
+ * @param win Pointer to window structure
+ * @return uint32_t Sample count (saturates at the window length)
+ */
+uint32_t stats_window_count(const Stats_WindowTypeDef *win)
+{
+    if (!win) return 0;
+
+    return win->count;
+}
+
+/**
+ * @brief Integer square root
+ *
+ * @param value Radicand
+ * @return uint32_t floor(sqrt(value))
+ *
+ * @note Fixed 32 iterations, bit-by-bit method without division
+ */
+static uint32_t stats_isqrt64(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)root;
+}
+
+/**
+ * @brief Compute mean, AC RMS, peak-to-peak and crest factor of one block
+ *
+ * @details A single pass accumulates sum, sum of squares, min and max. With
+ *          the DSP extension two samples are handled per step: SMLAD for the
+ *          sum, SMLALD for the 64-bit sum of squares, and USUB16/SEL for packed
+ *          min/max. The variance then comes from the exact integer identity
+ *          N^2 * var = N * sum(x^2) - sum(x)^2.
+ *
+ * @param result Snapshot to fill (sequence is left to the caller)
+ * @param data Samples, at most 12 bits each
+ * @param length Number of samples
+ */
+void stats_block_compute(Stats_BlockTypeDef *result, const volatile uint16_t *data, uint16_t length)
+{
+    stats_block_compute_oversampled(result, data, length, 0);
+}
+
+/**
+ * @brief Compute the block statistics of an oversampled stream
+ *
+ * @details Same pass as stats_block_compute(). k extra bits take the place
+ *          of k fraction bits, so mean and RMS keep the raw-count scale. The
+ *          signed halfword MACs need samples below 2^15, so 16-bit samples
+ *          take the scalar path.
+ *
+ * @param result Snapshot to fill (sequence is left to the caller)
+ * @param data Samples with extra_bits more bits than the raw 12
+ * @param length Number of samples
+ * @param extra_bits Oversampling k, at most STATS_BLOCK_FRAC_BITS
+ */
+void stats_block_compute_oversampled(Stats_BlockTypeDef *result, const volatile uint16_t *data,
+                                     uint16_t length, uint8_t extra_bits)
+{
+    const uint16_t *samples = (const uint16_t *)data;  /* Block is stable while processed */
+    uint8_t frac_bits;
+    uint32_t sum = 0;
+    uint64_t sum_sq = 0;
+    uint16_t min = 0xFFFF;
+    uint16_t max = 0;
+    uint16_t i = 0;
+    uint64_t variance_n2;
+    int32_t above;
+    int32_t below;
+    uint32_t peak;
+
+    if (!result) return;
+    if (extra_bits > STATS_BLOCK_FRAC_BITS) extra_bits = STATS_BLOCK_FRAC_BITS;
+    frac_bits = STATS_BLOCK_FRAC_BITS - extra_bits;
+    result->length = length;
+    result->extra_bits = extra_bits;
+    if (!data || length == 0) {
+        result->mean = result->rms = result->min = result->max = 0;
+        result->peak_to_peak = result->crest = 0;
+        return;
+    }
+
+#if STATS_USE_SIMD
+    if (12 + extra_bits <= 15) {                        /* Signed halfwords */
+        uint32_t min2 = 0xFFFFFFFF;
+        uint32_t max2 = 0;
+
+        for (; i + 1 < length; i += 2) {
+            uint32_t pair = __UNALIGNED_UINT32_READ(&samples[i]);
+
+            sum = __SMLAD(pair, 0x00010001, sum);       /* lo*1 + hi*1 */
+            sum_sq = __SMLALD(pair, pair, sum_sq);      /* lo*lo + hi*hi, 64-bit */
+            __USUB16(pair, max2);                       /* GE where pair >= max */
+            max2 = __SEL(pair, max2);
+            __USUB16(min2, pair);                       /* GE where min >= pair */
+            min2 = __SEL(pair, min2);
+        }
+
+        min = (uint16_t)((min2 & 0xFFFF) < (min2 >> 16) ? (min2 & 0xFFFF) : (min2 >> 16));
+        max = (uint16_t)((max2 & 0xFFFF) > (max2 >> 16) ? (max2 & 0xFFFF) : (max2 >> 16));
+    }
+#endif
+
+    /* Scalar path, or the odd tail sample of the SIMD path */
+    for (; i < length; i++) {
+        uint16_t x = samples[i];
+
+        sum += x;
+        sum_sq += (uint32_t)x * x;
+        if (x < min) min = x;
+        if (x > max) max = x;
+    }
+
+    variance_n2 = (uint64_t)length * sum_sq - (uint64_t)sum * sum;
+
+    result->mean = (uint16_t)((((uint64_t)sum << frac_bits) + length / 2) / length);
+    result->rms = (uint16_t)(stats_isqrt64(variance_n2 << (2 * frac_bits)) / length);
+    result->min = min;
+    result->max = max;
+    result->peak_to_peak = max - min;
+
+    /* Crest factor about the mean, both terms in the same fixed-point scale */
+    above = ((int32_t)max << frac_bits) - result->mean;
+    below = result->mean - ((int32_t)min << frac_bits);
+    peak = (uint32_t)((above > below) ? above : below);
+    if (result->rms == 0) {
+        result->crest = 0;
+    } else {
+        uint32_t crest = (peak << 8) / result->rms;
+        result->crest = (crest > 0xFFFF) ? 0xFFFF : (uint16_t)crest;
+    }
+}
@@ -0,0 +1,33 @@
+/**
+ ******************************************************************************
+ * @file           : host_cmsis.h
+ * @author         : Haoyi Chen
+ * @date           : 2025-09-02
+ * @brief          : Host build shim for the CMSIS device header
+ ******************************************************************************
+ * @details
+ * This file is force-included ahead of every test source, so the drivers and
+ * the application modules build with the native compiler of the test host.
+ * The device header is pulled in with the memory barrier renamed, and the
+ * barrier, whose ARM instruction the host cannot assemble, becomes a full
+ * compiler and CPU barrier. Unused inline intrinsics are never emitted, so the
+ * rest of the ARM assembly does not matter.
+ *
+ * Peripheral base addresses are not mapped on the host. Tests hand the
+ * drivers register blocks of their own and never call code that touches a
+ * fixed peripheral, such as RCC or NVIC.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#ifndef HOST_CMSIS_H
+#define HOST_CMSIS_H
+
+#define __DMB   __DMB_target
+#include "stm32f407xx.h"
+#undef __DMB
+
+#define __DMB() __sync_synchronize()
+
+#endif /* HOST_CMSIS_H */
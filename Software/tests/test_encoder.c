@@ -0,0 +1,195 @@
+/**
+ ******************************************************************************
+ * @file           : test_encoder.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-09-02
+ * @brief          : Host test of the 16- and 32-bit encoder count paths
+ ******************************************************************************
+ * @details
+ * This file drives the encoder driver through simulated counter wraps. The
+ * timer is a plain register block in memory. A move updates CNT and DIR the
+ * way the encoder interface would and raises UIF on a wrap. The update
+ * interrupt is then either run right away or left pending, as happens while
+ * the vector is on its way or blocked by a higher priority. After every move
+ * TotalCount must equal the true position.
+ *
+ * SR is rc_w0 on the target: writing 0 clears a flag and writing 1 leaves it.
+ * Plain memory cannot do that, so the test applies the write afterwards.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "encoder.h"
+
+#define ENCODER_TEST_MOVES      200000  /**< Random moves per scenario */
+
+static TIM_TypeDef encoder_tim;
+static Encoder_HandleTypeDef encoder;
+static int64_t encoder_truth;
+static uint32_t encoder_random_state = 1;
+static int failures = 0;
+
+/**
+ * @brief xorshift32, the same sequence on every host
+ *
+ * @return uint32_t Next pseudo-random value
+ */
+static uint32_t test_random(void)
+{
+    uint32_t x = encoder_random_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    encoder_random_state = x;
+    return x;
+}
+
+/**
+ * @brief Set up the handle the way encoder_init() does, on the fake timer
+ *
+ * @param wide 1 for a 32-bit counter, 0 for a 16-bit one
+ * @param max_count ARR + 1 of a 16-bit counter
+ */
+static void test_setup(uint8_t wide, uint32_t max_count)
+{
+    memset(&encoder_tim, 0, sizeof(encoder_tim));
+    memset(&encoder, 0, sizeof(encoder));
+
+    encoder_tim.ARR = wide ? 0xFFFFFFFFU : max_count - 1;
+    encoder.TIMx = &encoder_tim;
+    encoder.Wide = wide;
+    encoder.CountsPerRevolution = 4000;
+    encoder.IndexChannel = ENCODER_INDEX_NONE;
+    encoder.HomeState = ENCODER_HOME_IDLE;
+    encoder_truth = 0;
+}
+
+/**
+ * @brief Run the update interrupt, with the rc_w0 semantics of SR
+ */
+static void test_irq(void)
+{
+    uint32_t before = encoder_tim.SR;
+
+    encoder_timer_irq_handler(&encoder);
+    encoder_tim.SR = before & encoder_tim.SR;
+}
+
+/**
+ * @brief Move the shaft like the encoder interface counts it
+ *
+ * @param delta Counts to move, less than one counter range
+ */
+static void test_move(int32_t delta)
+{
+    uint64_t range = (uint64_t)encoder_tim.ARR + 1;
+    int64_t count = (int64_t)encoder_tim.CNT + delta;
+
+    if (delta < 0) {
+        encoder_tim.CR1 |= TIM_CR1_DIR;
+    } else if (delta > 0) {
+        encoder_tim.CR1 &= ~TIM_CR1_DIR;
+    }
+
+    if (count < 0) {
+        count += range;
+        encoder_tim.SR |= TIM_SR_UIF;
+    } else if ((uint64_t)count >= range) {
+        count -= range;
+        encoder_tim.SR |= TIM_SR_UIF;
+    }
+
+    encoder_tim.CNT = (uint32_t)count;
+    encoder_truth += delta;
+}
+
+/**
+ * @brief Compare TotalCount with the true position
+ *
+ * @param scenario Name printed on a mismatch
+ * @param move Move number printed on a mismatch
+ * @return uint8_t 1 if they match
+ */
+static uint8_t test_check(const char *scenario, uint32_t move)
+{
+    encoder_update(&encoder);
+
+    if (encoder.TotalCount != (int32_t)encoder_truth) {
+        printf("%s: move %u, TotalCount %d, expected %d (CNT %u, wraps %d, UIF %u)\n",
+               scenario, move, encoder.TotalCount, (int32_t)encoder_truth, encoder_tim.CNT,
+               encoder.WrapCount, (encoder_tim.SR & TIM_SR_UIF) ? 1U : 0U);
+        failures++;
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Random walk over many wraps
+ *
+ * @param scenario Name printed on a mismatch
+ * @param wide 1 for a 32-bit counter, 0 for a 16-bit one
+ * @param max_count ARR + 1 of a 16-bit counter
+ * @param max_step Largest move between two interrupts
+ * @param deferred 1 to read the count once more while the interrupt is still pending
+ */
+static void test_walk(const char *scenario, uint8_t wide, uint32_t max_count,
+                      uint32_t max_step, uint8_t deferred)
+{
+    uint32_t wraps = 0;
+
+    test_setup(wide, max_count);
+
+    for (uint32_t move = 0; move < ENCODER_TEST_MOVES; move++) {
+        int32_t delta = (int32_t)(test_random() % (2 * max_step + 1)) - (int32_t)max_step;
+
+        test_move(delta);
+        if (encoder_tim.SR & TIM_SR_UIF) {
+            wraps++;
+            if (wide) encoder_tim.SR &= ~TIM_SR_UIF;    /* No update interrupt on 32-bit timers */
+        }
+
+        if (deferred && !test_check(scenario, move)) return;
+        if (!wide) test_irq();
+        if (!test_check(scenario, move)) return;
+    }
+
+    printf("%s: %u moves, %u wraps, final count %d\n", scenario, ENCODER_TEST_MOVES, wraps,
+           encoder.TotalCount);
+}
+
+/**
+ * @brief Cross the 32-bit boundary in both directions
+ */
+static void test_wide_boundary(void)
+{
+    test_setup(1, 0);
+
+    /* Down through zero: CNT becomes 0xFFFFFF.., TotalCount goes negative */
+    for (uint32_t move = 0; move < 1000; move++) {
+        test_move(-7);
+        if (!test_check("32-bit below zero", move)) return;
+    }
+    for (uint32_t move = 0; move < 2000; move++) {
+        test_move(7);
+        if (!test_check("32-bit back above zero", move)) return;
+    }
+
+    printf("32-bit zero crossing: final count %d\n", encoder.TotalCount);
+}
+
+int main(void)
+{
+    test_walk("16-bit, interrupt at once", 0, 0x10000, 20000, 0);
+    test_walk("16-bit, interrupt pending", 0, 0x10000, 20000, 1);
+    test_walk("16-bit ARR 3999, interrupt pending", 0, 4000, 1500, 1);
+    test_walk("32-bit", 1, 0, 0x40000000, 0);
+    test_wide_boundary();
+
+    return failures ? 1 : 0;
+}
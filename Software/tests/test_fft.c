@@ -0,0 +1,131 @@
+/**
+ ******************************************************************************
+ * @file           : test_fft.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-08-26
+ * @brief          : Host accuracy test of the Q15 FFT spectrum analyzer
+ ******************************************************************************
+ * @details
+ * This file runs the spectrum analyzer on the host for every supported
+ * transform length and compares each bin magnitude with a double-precision
+ * DFT of the same mean-removed, Hann-windowed frame, divided by N. Signals
+ * are a DC offset, two tones at random fractional bins and uniform noise, at
+ * the levels the filter chain delivers. Every bin must be within
+ * FFT_TEST_MAX_ERROR output LSB.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "fft.h"
+
+#define FFT_TEST_MAX_ERROR      3.0     /**< Allowed magnitude error in output LSB */
+#define FFT_TEST_FRAMES         8       /**< Random signals per transform length */
+
+static FFT_AnalyzerTypeDef analyzer;
+static int16_t signal_q15[FFT_MAX_POINTS];
+static double window_ref[FFT_MAX_POINTS];
+static double cos_ref[FFT_MAX_POINTS];
+static double sin_ref[FFT_MAX_POINTS];
+
+/**
+ * @brief Uniform random number
+ *
+ * @return double Value in [-1, 1]
+ */
+static double test_random(void)
+{
+    return 2.0 * (double)rand() / (double)RAND_MAX - 1.0;
+}
+
+/**
+ * @brief Run one frame through the analyzer and the reference DFT
+ *
+ * @param points Transform length
+ * @param dc DC offset
+ * @param tone Amplitudes of the two tones
+ * @param noise Amplitude of the uniform noise
+ * @return double Largest magnitude error over all bins
+ */
+static double test_frame(uint16_t points, double dc, const double tone[2], double noise)
+{
+    double bin[2];
+    double phase[2];
+    double mean = 0.0;
+    double worst = 0.0;
+
+    for (uint8_t i = 0; i < 2; i++) {
+        bin[i] = FFT_PEAK_MIN_BIN + (0.5 + 0.5 * test_random()) * (points / 2 - 2 * FFT_PEAK_MIN_BIN);
+        phase[i] = M_PI * test_random();
+    }
+
+    for (uint16_t n = 0; n < points; n++) {
+        double x = dc + noise * test_random();
+        for (uint8_t i = 0; i < 2; i++) {
+            x += tone[i] * sin(2.0 * M_PI * bin[i] * n / points + phase[i]);
+        }
+        signal_q15[n] = (int16_t)lrint(x);
+        mean += signal_q15[n];
+    }
+    mean /= points;
+
+    if (fft_analyzer_init(&analyzer, points, 10000)) {
+        printf("fft_analyzer_init(%u) failed\n", points);
+        return INFINITY;
+    }
+    fft_analyzer_push(&analyzer, signal_q15, points);
+    while (!fft_analyzer_step(&analyzer)) {
+    }
+
+    for (uint16_t n = 0; n < points; n++) {
+        window_ref[n] = (signal_q15[n] - mean) * (0.5 - 0.5 * cos(2.0 * M_PI * n / points));
+        cos_ref[n] = cos(2.0 * M_PI * n / points);
+        sin_ref[n] = sin(2.0 * M_PI * n / points);
+    }
+
+    for (uint16_t k = 0; k < points / 2; k++) {
+        double re = 0.0;
+        double im = 0.0;
+        double error;
+
+        for (uint32_t n = 0; n < points; n++) {
+            uint32_t angle = (k * n) & (points - 1);
+            re += window_ref[n] * cos_ref[angle];
+            im -= window_ref[n] * sin_ref[angle];
+        }
+        error = fabs(sqrt(re * re + im * im) / points - analyzer.magnitude[k]);
+        if (error > worst) worst = error;
+    }
+
+    return worst;
+}
+
+int main(void)
+{
+    static const double tones[][2] = {
+        {12000.0, 2500.0},      /* Supply harmonic and a sideband */
+        {28000.0, 0.0},         /* Near full scale */
+        {1500.0, 400.0},        /* Small signal */
+    };
+    int failures = 0;
+
+    srand(1);
+
+    for (uint16_t points = FFT_MIN_POINTS; points <= FFT_MAX_POINTS; points <<= 1) {
+        double worst = 0.0;
+
+        for (uint8_t frame = 0; frame < FFT_TEST_FRAMES; frame++) {
+            const double *tone = tones[frame % (sizeof(tones) / sizeof(tones[0]))];
+            double error = test_frame(points, 2000.0 * test_random(), tone, 300.0);
+            if (error > worst) worst = error;
+        }
+
+        printf("N=%4u: max error %.2f LSB\n", points, worst);
+        if (worst > FFT_TEST_MAX_ERROR) failures++;
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,217 @@
+/**
+ ******************************************************************************
+ * @file           : test_pid.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-09-02
+ * @brief          : Host cross-check of the Q15, Q31 and float PID variants
+ ******************************************************************************
+ * @details
+ * This file runs the three controllers side by side for PID_TEST_STEPS
+ * updates. Each one closes its own loop around a first-order plant,
+ * y += (u - y) / 8, with the same measurement noise so the derivative path
+ * has work to do. The setpoint steps between levels beyond the output limits,
+ * so the clamp, the slew limit and the anti-windup all engage. A shared plant
+ * would leave the fixed-point integrators open-loop, and one clamp decision
+ * taken a step apart would then never be corrected.
+ *
+ * The fixed-point gains, filter pole, limits and slew are rounded at init;
+ * that is a property of the format, not an error, so each fixed-point variant
+ * is compared with a float controller of its own that uses the rounded
+ * values and sees the measurement at the same resolution. The Q31 pair must
+ * then agree to a fraction of a Q15 LSB. The Q15 pair also differs wherever
+ * the two plants round to neighbouring measurement codes, which the loop
+ * amplifies by about kp + kd, so its limit scales with the gains.
+ *
+ * The error must stay within full scale, which the fixed-point variants
+ * saturate, so the setpoint levels and output limits are chosen to keep it
+ * there.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include "pid.h"
+
+#define PID_TEST_STEPS          20000   /**< Updates per configuration */
+#define PID_TEST_PERIOD         400     /**< Updates between setpoint steps */
+#define PID_TEST_NOISE          0.002   /**< Peak measurement noise */
+#define PID_TEST_TOL_Q15        8.0     /**< Q15 output error limit, in LSB per unit of kp + kd + 1 */
+#define PID_TEST_TOL_Q31        (1.0 / 16.0)        /**< Q31 output error limit, in Q15 LSB */
+
+static uint32_t pid_random_state = 1;
+static int failures = 0;
+
+/**
+ * @brief xorshift32, the same sequence on every host
+ *
+ * @return uint32_t Next pseudo-random value
+ */
+static uint32_t test_random(void)
+{
+    uint32_t x = pid_random_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    pid_random_state = x;
+    return x;
+}
+
+/**
+ * @brief Round a value to Q15 with saturation
+ *
+ * @param value Normalized value
+ * @return int16_t Q15 value
+ */
+static int16_t test_q15(double value)
+{
+    long q = lround(value * 32768.0);
+
+    if (q > INT16_MAX) return INT16_MAX;
+    if (q < INT16_MIN) return INT16_MIN;
+    return (int16_t)q;
+}
+
+/**
+ * @brief Float configuration with the values a fixed-point controller really uses
+ *
+ * @param config Requested configuration
+ * @param kp, ki, kd, kt Scaled gains
+ * @param shift Gain exponent
+ * @param beta Filter coefficient
+ * @param out_min, out_max, slew Scaled limits
+ * @param one Value of 1.0 in the word format
+ * @return Pid_ConfigTypeDef Float equivalent
+ */
+static Pid_ConfigTypeDef test_effective(const Pid_ConfigTypeDef *config, double kp, double ki,
+                                       double kd, double kt, uint8_t shift, double beta,
+                                       double out_min, double out_max, double slew, double one)
+{
+    Pid_ConfigTypeDef effective = *config;
+    double gain = (double)(1U << shift) / one;
+
+    effective.kp = (float)(kp * gain);
+    effective.ki = (float)(ki * gain);
+    effective.kd = (float)(kd * gain);
+    effective.kt = (float)(kt * gain);
+    effective.d_pole = (float)(1.0 - beta / one);
+    effective.out_min = (float)(out_min / one);
+    effective.out_max = (float)(out_max / one);
+    effective.slew = (float)(slew / one);
+
+    return effective;
+}
+
+/**
+ * @brief Run one configuration and compare each fixed-point output with its reference
+ *
+ * @param name Name printed with the result
+ * @param config Configuration used for all three
+ */
+static void test_config(const char *name, const Pid_ConfigTypeDef *config)
+{
+    static const double levels[] = { 0.45, -0.45, 0.1, -0.2, 0.0, 0.35 };
+    Pid_Q15TypeDef q15;
+    Pid_Q31TypeDef q31;
+    Pid_F32TypeDef f32;       /* Requested values, shows how often the limits engage */
+    Pid_F32TypeDef ref15;
+    Pid_F32TypeDef ref31;
+    Pid_ConfigTypeDef effective;
+    double plant = 0.0;
+    double plant15 = 0.0;
+    double plant31 = 0.0;
+    double plant_ref15 = 0.0;
+    double plant_ref31 = 0.0;
+    double worst15 = 0.0;
+    double worst31 = 0.0;
+    double tol15 = PID_TEST_TOL_Q15 * (config->kp + config->kd + 1.0) / 32768.0;
+    uint32_t saturated = 0;
+
+    if (pid_q15_init(&q15, config) || pid_q31_init(&q31, config) || pid_f32_init(&f32, config)) {
+        printf("%s: init failed\n", name);
+        failures++;
+        return;
+    }
+
+    effective = test_effective(config, q15.kp, q15.ki, q15.kd, q15.kt, q15.shift, q15.beta,
+                               q15.out_min, q15.out_max, q15.slew, 32768.0);
+    pid_f32_init(&ref15, &effective);
+    effective = test_effective(config, q31.kp, q31.ki, q31.kd, q31.kt, q31.shift, q31.beta,
+                               q31.out_min, q31.out_max, q31.slew, 2147483648.0);
+    pid_f32_init(&ref31, &effective);
+
+    for (uint32_t step = 0; step < PID_TEST_STEPS; step++) {
+        double level = levels[(step / PID_TEST_PERIOD) % (sizeof(levels) / sizeof(levels[0]))];
+        double noise = ((double)(test_random() % 2001) / 1000.0 - 1.0) * PID_TEST_NOISE;
+        int16_t setpoint = test_q15(level);
+        float sp = setpoint / 32768.0f;
+        double out15, out31, outf, ref_out15, ref_out31, error15, error31;
+
+        /* Q15 and its reference see Q15 measurements, Q31 and its reference full resolution */
+        out15 = pid_q15_update(&q15, setpoint, test_q15(plant15 + noise)) / 32768.0;
+        ref_out15 = pid_f32_update(&ref15, sp, test_q15(plant_ref15 + noise) / 32768.0f);
+        out31 = pid_q31_update(&q31, (int32_t)setpoint * 65536,
+                               (int32_t)lround((plant31 + noise) * 2147483648.0)) / 2147483648.0;
+        ref_out31 = pid_f32_update(&ref31, sp, (float)(plant_ref31 + noise));
+        outf = pid_f32_update(&f32, sp, test_q15(plant + noise) / 32768.0f);
+
+        error15 = fabs(out15 - ref_out15);
+        error31 = fabs(out31 - ref_out31);
+        if (error15 > worst15) worst15 = error15;
+        if (error31 > worst31) worst31 = error31;
+        if (f32.saturated) saturated++;
+
+        if (error15 > tol15 || error31 > PID_TEST_TOL_Q31 / 32768.0) {
+            printf("%s: step %u, float %.6f, Q15 %.6f (ref %.6f), Q31 %.6f (ref %.6f)\n", name, step,
+                   outf, out15, ref_out15, out31, ref_out31);
+            failures++;
+            return;
+        }
+
+        plant += (outf - plant) / 8.0;
+        plant15 += (out15 - plant15) / 8.0;
+        plant31 += (out31 - plant31) / 8.0;
+        plant_ref15 += (ref_out15 - plant_ref15) / 8.0;
+        plant_ref31 += (ref_out31 - plant_ref31) / 8.0;
+    }
+
+    printf("%s: %u steps, %u saturated, worst Q15 %.2f LSB, Q31 %.4f Q15 LSB\n", name,
+           PID_TEST_STEPS, saturated, worst15 * 32768.0, worst31 * 32768.0);
+}
+
+int main(void)
+{
+    Pid_ConfigTypeDef config = {
+        .kp = 0.8f,
+        .ki = 0.02f,
+        .kd = 0.0f,
+        .kt = 0.0f,
+        .d_pole = 0.0f,
+        .out_min = -0.3f,
+        .out_max = 0.3f,
+        .slew = 0.0f,
+        .antiwindup = PID_ANTIWINDUP_CLAMP,
+    };
+
+    test_config("PI, clamp", &config);
+
+    config.kd = 1.5f;
+    config.d_pole = 0.7f;
+    test_config("PID, clamp", &config);
+
+    config.antiwindup = PID_ANTIWINDUP_BACKCALC;
+    config.kt = 0.1f;
+    test_config("PID, back-calculation", &config);
+
+    config.slew = 0.01f;
+    test_config("PID, back-calculation, slew", &config);
+
+    config.antiwindup = PID_ANTIWINDUP_CLAMP;
+    config.kp = 3.0f;
+    config.kd = 6.0f;
+    test_config("PID, clamp, slew, gains above 1", &config);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,252 @@
+/**
+ ******************************************************************************
+ * @file           : test_profile.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-09-04
+ * @brief          : Host test of the jerk-limited profile generator
+ ******************************************************************************
+ * @details
+ * This file runs the profile with the limits of bsp.h over encoders from a
+ * few counts to 65535 counts per revolution. For each one it checks that
+ * profile_init() accepts the limits and then drives three kinds of move:
+ *
+ *   - A long position move, which must arrive exactly, never overshoot and
+ *     take at most 5% longer than the ideal S-curve.
+ *   - A move whose target is pulled back to the present reference while it
+ *     accelerates. The reference must pass it, come back and settle on it.
+ *   - Random retargets in position and speed mode, settled at the end.
+ *
+ * On every tick the internal speed, acceleration and jerk must stay within
+ * the limits profile_init() derived.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include <stdio.h>
+#include "bsp.h"
+
+#define PROFILE_TEST_SETTLE_TICKS   200000  /**< Give up on a move after this many ticks */
+#define PROFILE_TEST_RETARGETS      200     /**< Random retargets per encoder */
+
+static Profile_HandleTypeDef profile;
+static int32_t profile_last_accel;
+static uint32_t profile_random_state = 1;
+static int failures = 0;
+
+/**
+ * @brief xorshift32, the same sequence on every host
+ *
+ * @return uint32_t Next pseudo-random value
+ */
+static uint32_t test_random(void)
+{
+    uint32_t x = profile_random_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    profile_random_state = x;
+    return x;
+}
+
+/**
+ * @brief One tick, checking the limits
+ *
+ * @param name Scenario printed on a violation
+ * @param mode Target to move towards
+ * @return uint8_t 1 if the limits held
+ */
+static uint8_t test_tick(const char *name, Profile_ModeTypeDef mode)
+{
+    int32_t jerk;
+
+    profile_update(&profile, mode);
+    jerk = profile.accel - profile_last_accel;
+    profile_last_accel = profile.accel;
+
+    if (profile.velocity > profile.v_max || profile.velocity < -profile.v_max ||
+        profile.accel > profile.a_max || profile.accel < -profile.a_max ||
+        jerk > profile.j_max || jerk < -profile.j_max) {
+        printf("%s: limit exceeded, v %d/%d, a %d/%d, jerk %d/%d\n", name, profile.velocity, profile.v_max,
+               profile.accel, profile.a_max, jerk, profile.j_max);
+        failures++;
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Run until the reference settles
+ *
+ * @param name Scenario printed on a failure
+ * @param mode Target to move towards
+ * @return uint32_t Ticks taken, 0 on a failure
+ */
+static uint32_t test_settle(const char *name, Profile_ModeTypeDef mode)
+{
+    Profile_StatusTypeDef status;
+
+    for (uint32_t tick = 1; tick <= PROFILE_TEST_SETTLE_TICKS; tick++) {
+        if (!test_tick(name, mode)) return 0;
+
+        profile_get_status(&profile, &status);
+        if (!status.moving) {
+            if (mode == PROFILE_MODE_POSITION && status.position_counts != profile.target_counts) {
+                printf("%s: settled at %d, target %d\n", name, status.position_counts, profile.target_counts);
+                failures++;
+                return 0;
+            }
+            if (status.progress_permille != 1000 || profile.accel != 0) {
+                printf("%s: settled with progress %u, accel %d\n", name, status.progress_permille, profile.accel);
+                failures++;
+                return 0;
+            }
+            return tick;
+        }
+    }
+
+    printf("%s: not settled after %u ticks\n", name, PROFILE_TEST_SETTLE_TICKS);
+    failures++;
+    return 0;
+}
+
+/**
+ * @brief Long move in one direction: exact arrival, no overshoot, near-ideal time
+ *
+ * @param name Scenario printed on a failure
+ * @param counts_per_rev Encoder resolution
+ */
+static void test_long_move(const char *name, uint16_t counts_per_rev)
+{
+    int32_t target = 20 * (int32_t)counts_per_rev;
+    int64_t goal = (int64_t)target << profile.fraction_bits;
+    double v = profile.v_max, a = profile.a_max, j = profile.j_max;
+    double ideal = (double)goal / v + v / a + a / j;
+    uint32_t ticks = 0;
+
+    profile_set_position_target(&profile, target);
+    do {
+        if (!test_tick(name, PROFILE_MODE_POSITION)) return;
+        if (profile.position > goal) {
+            printf("%s: overshoot by %lld\n", name, (long long)(profile.position - goal));
+            failures++;
+            return;
+        }
+        ticks++;
+    } while (profile.moving && ticks < PROFILE_TEST_SETTLE_TICKS);
+
+    if (profile.position != goal || profile.velocity != 0 || ticks > ideal * 1.05 + 5) {
+        printf("%s: %u ticks for %.0f ideal, position %lld of %lld\n", name, ticks, ideal,
+               (long long)profile.position, (long long)goal);
+        failures++;
+    }
+}
+
+/**
+ * @brief Pull the target back to the reference while it accelerates
+ *
+ * @param name Scenario printed on a failure
+ * @param counts_per_rev Encoder resolution
+ */
+static void test_retarget_closer(const char *name, uint16_t counts_per_rev)
+{
+    int32_t start = profile.position_counts;
+    int32_t passed = start;
+
+    profile_set_position_target(&profile, start + 20 * (int32_t)counts_per_rev);
+    while (profile.velocity < profile.v_max / 2) {
+        if (!test_tick(name, PROFILE_MODE_POSITION)) return;
+    }
+
+    profile_set_position_target(&profile, profile.position_counts);
+    while (profile.moving) {
+        if (!test_tick(name, PROFILE_MODE_POSITION)) return;
+        if (profile.position_counts > passed) passed = profile.position_counts;
+    }
+
+    if (profile.position_counts != profile.target_counts || passed <= profile.target_counts) {
+        printf("%s: settled at %d for %d, furthest %d\n", name, profile.position_counts,
+               profile.target_counts, passed);
+        failures++;
+    }
+}
+
+/**
+ * @brief Random targets taken before the previous one is reached, then settle
+ *
+ * @param name Scenario printed on a failure
+ * @param counts_per_rev Encoder resolution
+ * @param mode Position or speed targets
+ */
+static void test_random_retargets(const char *name, uint16_t counts_per_rev, Profile_ModeTypeDef mode)
+{
+    int32_t speed_limit = (int32_t)(((int64_t)profile.v_max * profile.to_mrpm_q8) >> (profile.fraction_bits + 8));
+
+    for (uint32_t i = 0; i < PROFILE_TEST_RETARGETS; i++) {
+        uint32_t ticks = test_random() % 400;
+
+        if (mode == PROFILE_MODE_POSITION) {
+            profile_set_position_target(&profile, (int32_t)(test_random() % (10U * counts_per_rev + 1)) -
+                                                  5 * (int32_t)counts_per_rev);
+        } else {
+            profile_set_speed_target(&profile, (int32_t)(test_random() % (2U * speed_limit + 1)) - speed_limit);
+        }
+
+        for (uint32_t tick = 0; tick < ticks; tick++) {
+            if (!test_tick(name, mode)) return;
+        }
+    }
+
+    test_settle(name, mode);
+}
+
+/**
+ * @brief All scenarios for one encoder resolution
+ *
+ * @param counts_per_rev Encoder resolution
+ */
+static void test_encoder_resolution(uint16_t counts_per_rev)
+{
+    Profile_InitTypeDef init = {
+        .rate_hz = SPEED_LOOP_RATE_HZ,
+        .counts_per_rev = counts_per_rev,
+        .max_speed_mrpm = SPEED_MAX_MRPM,
+        .max_accel_rpm_s = PROFILE_MAX_ACCEL_RPM_S,
+        .max_jerk_rpm_s2 = PROFILE_MAX_JERK_RPM_S2,
+    };
+    char name[48];
+    int before = failures;
+
+    snprintf(name, sizeof(name), "%u CPR", counts_per_rev);
+    if (profile_init(&profile, &init)) {
+        printf("%s: profile_init failed\n", name);
+        failures++;
+        return;
+    }
+    profile_last_accel = 0;
+
+    test_long_move(name, counts_per_rev);
+    test_retarget_closer(name, counts_per_rev);
+    test_random_retargets(name, counts_per_rev, PROFILE_MODE_POSITION);
+    profile_set_speed_target(&profile, 0);
+    test_random_retargets(name, counts_per_rev, PROFILE_MODE_SPEED);
+
+    if (failures == before) {
+        printf("%s: %u fraction bits, v %d a %d j %d, %u moves\n", name, profile.fraction_bits,
+               profile.v_max, profile.a_max, profile.j_max, profile.moves);
+    }
+}
+
+int main(void)
+{
+    static const uint16_t resolutions[] = { 16, 100, 400, 1000, 2048, 2500, 3000, 4000, 4096,
+                                            8192, 10000, 16384, 40000, 65535 };
+
+    for (uint32_t i = 0; i < sizeof(resolutions) / sizeof(resolutions[0]); i++) {
+        test_encoder_resolution(resolutions[i]);
+    }
+
+    return failures ? 1 : 0;
+}
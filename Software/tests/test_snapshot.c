@@ -0,0 +1,121 @@
+/**
+ ******************************************************************************
+ * @file           : test_snapshot.c
+ * @author         : Haoyi Chen
+ * @date           : 2025-09-02
+ * @brief          : Host stress test of the encoder observer snapshot
+ ******************************************************************************
+ * @details
+ * This file runs the observer update from a SIGALRM handler, which stands in
+ * for the timer interrupt. The main loop plays the lower-priority reader and
+ * calls encoder_get_snapshot() as fast as it can. The handler interrupts the
+ * reader at arbitrary points and runs to completion, just like an interrupt.
+ *
+ * Each update moves the fake counter by ENCODER_TEST_STEP and sets the fake
+ * timestamp timer to the update number. A consistent tuple therefore has
+ * Timestamp == Updates and Count == Updates * ENCODER_TEST_STEP. The same
+ * check on plain structure copies shows that the handler really lands inside
+ * the copy; that count is printed but not judged.
+ *
+ * This file is part of a bare-metal STM32F407VGT6 project.
+ ******************************************************************************
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include "encoder.h"
+
+#define ENCODER_TEST_STEP       3       /**< Counts per observer update */
+#define ENCODER_TEST_UPDATES    50000   /**< Updates before the test ends */
+#define ENCODER_TEST_PERIOD_US  20      /**< Timer signal period */
+
+static TIM_TypeDef encoder_tim;
+static TIM_TypeDef timestamp_tim;
+static Encoder_HandleTypeDef encoder;
+static volatile uint32_t updates = 0;
+
+/**
+ * @brief Timer signal: one observer update, like the control interrupt
+ */
+static void test_alarm(int signal)
+{
+    updates++;
+    encoder_tim.CNT = (encoder_tim.CNT + ENCODER_TEST_STEP) & 0xFFFF;
+    timestamp_tim.CNT = updates;
+    encoder_observer_update(&encoder);
+}
+
+/**
+ * @brief Check one copied tuple
+ *
+ * @param snapshot Copy to check
+ * @return uint8_t 1 if the fields belong to the same update
+ */
+static uint8_t test_consistent(const Encoder_SnapshotTypeDef *snapshot)
+{
+    return snapshot->Timestamp == snapshot->Updates &&
+           snapshot->Count == (int32_t)(snapshot->Updates * ENCODER_TEST_STEP);
+}
+
+int main(void)
+{
+    struct sigaction action;
+    struct itimerval timer;
+    Encoder_SnapshotTypeDef snapshot;
+    uint32_t reads = 0;
+    uint32_t busy = 0;
+    uint32_t torn = 0;
+    uint32_t raw_torn = 0;
+    uint32_t last = 0;
+
+    memset(&encoder, 0, sizeof(encoder));
+    encoder_tim.ARR = 0xFFFF;
+    encoder.TIMx = &encoder_tim;
+    encoder.TimestampTIMx = &timestamp_tim;
+    encoder.CountsPerRevolution = 4000;
+    encoder.IndexChannel = ENCODER_INDEX_NONE;
+    encoder.HomeState = ENCODER_HOME_IDLE;
+    if (encoder_observer_init(&encoder, 10000, 200)) {
+        printf("encoder_observer_init failed\n");
+        return 1;
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = test_alarm;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGALRM, &action, NULL);
+
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = ENCODER_TEST_PERIOD_US;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_REAL, &timer, NULL);
+
+    while (updates < ENCODER_TEST_UPDATES) {
+        if (!encoder_get_snapshot(&encoder, &snapshot)) {
+            busy++;     /* Only possible from inside the update */
+            continue;
+        }
+        reads++;
+        if (!test_consistent(&snapshot) || snapshot.Updates < last) {
+            torn++;
+        }
+        last = snapshot.Updates;
+
+        /* Unprotected copy of the same data, for comparison only */
+        snapshot = *(volatile Encoder_SnapshotTypeDef *)&encoder.Snapshot;
+        if (!test_consistent(&snapshot)) {
+            raw_torn++;
+        }
+    }
+
+    timer.it_value.tv_usec = 0;
+    timer.it_interval.tv_usec = 0;
+    setitimer(ITIMER_REAL, &timer, NULL);
+
+    printf("%u updates, %u snapshot reads, %u torn, %u busy; %u torn plain copies\n",
+           updates, reads, torn, busy, raw_torn);
+
+    return (torn == 0 && busy == 0 && reads > 0) ? 0 : 1;
+}